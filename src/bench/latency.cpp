@@ -0,0 +1,505 @@
+#include "../controller/ps4.hpp"
+#include "../helper.hpp"
+#include "../timing/clock.hpp"
+#include "../timing/histogram.hpp"
+#include "../timing/scheduler.hpp"
+#include "../types.hpp"
+#include "../uinput/sink.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * End to end latency from a sync to a reader of the device.
+ *
+ * Usage: vc_latency [--format csv|json] [--duration-ms N] [--rates 125,...]
+ *                   [--batches 1,...] [--devices 1,...] [--fallback]
+ *
+ * Creates the devices, opens their /dev/input/eventN with CLOCK_MONOTONIC
+ * timestamps and reads them back from another thread. Every frame carries
+ * its sequence number in LEFT_X, the reader matches it with the time the
+ * frame was synced at. Reported are the time until the kernel stamped the
+ * frame, the time until the reader got it and the frames never seen.
+ *
+ * Rates are frames per second per device, batches the number of buttons
+ * changed in each frame. The devices inject real input but are grabbed, the
+ * session doesn't see it. Without /dev/uinput, or with --fallback, the
+ * devices write into pipes instead and only the read latency is measured.
+ */
+
+namespace {
+
+using namespace vc;
+
+// LEFT_X values, the sequence number of a frame wraps around at it
+constexpr usize TAGS = 256U;
+constexpr u32 BUTTONS = PS4Button::R3 + 1U;
+constexpr u32 DEVICES_MAX = 64U;
+constexpr i32 READY_TIMEOUT_MS = 5'000;
+// How long the reader keeps going after the last frame
+constexpr i64 DRAIN_NS = 100 * timing::NS_PER_MS;
+
+struct Config {
+  u32 hz;
+  u32 batch;
+  u32 devices;
+};
+
+struct Result {
+  Config config;
+  const c8* sink;
+  u64 sent;
+  u64 received;
+  // SYN_DROPPED seen, the reader fell behind and the kernel discarded events
+  u64 dropped;
+  u64 overruns;
+  // sync to the read returning
+  timing::Histogram read;
+  // sync to the time the kernel stamped on the SYN_REPORT
+  timing::Histogram kernel;
+};
+
+struct Options {
+  i64 duration_ms = 1'000;
+  std::vector<u32> rates{125U, 250U, 500U, 1'000U};
+  std::vector<u32> batches{1U, 4U, BUTTONS};
+  std::vector<u32> devices{1U, 4U, 16U};
+  bool json = false;
+  bool fallback = false;
+};
+
+// Reading end of one device
+struct Endpoint {
+  // Time each frame in flight was synced at by its LEFT_X value, 0 once
+  // matched. The write and read syscalls order the relaxed accesses
+  std::array<std::atomic<i64>, TAGS> sent{};
+  i32 fd = -1;
+  // Write end of the pipe of the fallback
+  i32 writer = -1;
+
+  // Tag of the frame being read, -1 if it didn't carry one yet
+  i32 tag = -1;
+  // Events up to the next SYN_REPORT are incomplete after a SYN_DROPPED
+  bool dropping = false;
+
+  Endpoint() noexcept = default;
+  Endpoint(const Endpoint&) = delete;
+  Endpoint& operator=(const Endpoint&) = delete;
+  Endpoint(Endpoint&&) = delete;
+  Endpoint& operator=(Endpoint&&) = delete;
+
+  ~Endpoint() noexcept {
+    if (this->fd != -1) {
+      close(this->fd);
+    }
+    if (this->writer != -1) {
+      close(this->writer);
+    }
+  }
+};
+
+template <typename Sink> struct Harness {
+  const c8* sink;
+  // Whether the events carry the time the kernel got them
+  bool kernel_time;
+  std::vector<Endpoint> endpoints;
+  // Declared last so the devices go away before their readers
+  std::vector<BasicPS4Controller<Sink>> controllers;
+};
+
+std::vector<Result> results{}; // NOLINT
+
+[[nodiscard]] i64 to_ns(const input_event& event) noexcept {
+  return static_cast<i64>(event.input_event_sec) * timing::NS_PER_S +
+         static_cast<i64>(event.input_event_usec) * timing::NS_PER_US;
+}
+
+[[nodiscard]] error_code
+open_node(Endpoint& endpoint, const c8* node) noexcept {
+  endpoint.fd = open(node, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (endpoint.fd == -1) {
+    return error::PASSTHROUGH_OPEN;
+  }
+
+  i32 clock = CLOCK_MONOTONIC;
+  if (ioctl(endpoint.fd, EVIOCSCLOCKID, &clock) == -1 ||
+      ioctl(endpoint.fd, EVIOCGRAB, 1) == -1) {
+    return error::PASSTHROUGH_OPEN;
+  }
+  return error::OK;
+}
+
+[[nodiscard]] error_code
+open_devices(Harness<uinput::UinputSink>& harness, u32 count) noexcept {
+  harness.sink = "uinput";
+  harness.kernel_time = true;
+  harness.endpoints = std::vector<Endpoint>(count);
+  harness.controllers.resize(count);
+
+  for (u32 i = 0U; i < count; ++i) {
+    auto& controller = harness.controllers[i];
+    TRY_CODE(controller.init("Latency PS4 Controller", true));
+    TRY_CODE(controller.wait_ready(READY_TIMEOUT_MS));
+    TRY_CODE(open_node(harness.endpoints[i], controller.get_sink().get_node()));
+  }
+  return error::OK;
+}
+
+[[nodiscard]] error_code
+open_devices(Harness<uinput::FileSink>& harness, u32 count) noexcept {
+  harness.sink = "pipe";
+  harness.kernel_time = false;
+  harness.endpoints = std::vector<Endpoint>(count);
+  harness.controllers.resize(count);
+
+  for (u32 i = 0U; i < count; ++i) {
+    auto& endpoint = harness.endpoints[i];
+    std::array<i32, 2> fds{};
+    if (pipe2(fds.data(), O_CLOEXEC) == -1) {
+      return error::CONTROLLER_OPEN;
+    }
+    endpoint.fd = fds[0];
+    endpoint.writer = fds[1];
+    // Only the reader is non-blocking, a full pipe makes the writer wait
+    // instead of failing the frame
+    if (fcntl(endpoint.fd, F_SETFL, O_NONBLOCK) == -1) {
+      return error::CONTROLLER_OPEN;
+    }
+
+    auto& controller = harness.controllers[i];
+    controller.get_sink().set_fd(endpoint.writer);
+    TRY_CODE(controller.init("Latency PS4 Controller", true));
+  }
+  return error::OK;
+}
+
+// Frames left over from the previous configuration would be matched
+void drain(std::vector<Endpoint>& endpoints, u32 count) noexcept {
+  std::array<input_event, 64> events{};
+  for (u32 i = 0U; i < count; ++i) {
+    auto& endpoint = endpoints[i];
+    while (read(endpoint.fd, events.data(), sizeof(events)) > 0) {
+    }
+    for (auto& sent : endpoint.sent) {
+      sent.store(0, std::memory_order_relaxed);
+    }
+    endpoint.tag = -1;
+    endpoint.dropping = false;
+  }
+}
+
+void handle_event(
+    Endpoint& endpoint, const input_event& event, i64 now, bool kernel_time,
+    Result& result
+) noexcept {
+  if (event.type == EV_ABS && event.code == PS4Stick::LEFT_X) {
+    endpoint.tag = event.value;
+    return;
+  }
+  if (event.type != EV_SYN) {
+    return;
+  }
+
+  if (event.code == SYN_DROPPED) {
+    ++result.dropped;
+    endpoint.dropping = true;
+    endpoint.tag = -1;
+    return;
+  }
+  if (event.code != SYN_REPORT) {
+    return;
+  }
+
+  i32 tag = endpoint.tag;
+  endpoint.tag = -1;
+  if (endpoint.dropping) {
+    endpoint.dropping = false;
+    return;
+  }
+  if (tag < 0 || tag >= static_cast<i32>(TAGS)) {
+    return;
+  }
+
+  i64 sent = endpoint.sent[tag].exchange(0, std::memory_order_relaxed);
+  if (sent == 0) {
+    return;
+  }
+  ++result.received;
+  result.read.record(now - sent);
+  if (kernel_time) {
+    result.kernel.record(to_ns(event) - sent);
+  }
+}
+
+void read_frames(
+    std::vector<Endpoint>& endpoints, u32 count, bool kernel_time,
+    const std::atomic<bool>& running, Result& result
+) noexcept {
+  i32 epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll == -1) {
+    return;
+  }
+  for (u32 i = 0U; i < count; ++i) {
+    epoll_event event{.events = EPOLLIN, .data = {.u32 = i}};
+    (void)epoll_ctl(epoll, EPOLL_CTL_ADD, endpoints[i].fd, &event);
+  }
+
+  std::array<epoll_event, DEVICES_MAX> ready{};
+  std::array<input_event, 64> events{};
+  while (running.load(std::memory_order_relaxed)) {
+    i32 n = epoll_wait(epoll, ready.data(), ready.size(), 10);
+    for (i32 i = 0; i < n; ++i) {
+      auto& endpoint = endpoints[ready[i].data.u32];
+      isize bytes = 0;
+      while ((bytes = read(endpoint.fd, events.data(), sizeof(events))) > 0) {
+        i64 now = timing::now_ns();
+        usize read_events = static_cast<usize>(bytes) / sizeof(input_event);
+        for (usize j = 0U; j < read_events; ++j) {
+          handle_event(endpoint, events[j], now, kernel_time, result);
+        }
+      }
+    }
+  }
+
+  close(epoll);
+}
+
+template <typename Sink>
+void run_config(
+    Harness<Sink>& harness, const Config& config, i64 duration_ms
+) noexcept {
+  FrameScheduler scheduler{};
+  if (scheduler.init(config.hz) != error::OK) {
+    fprintf(stderr, "Skipping %u Hz, rate out of range\n", config.hz);
+    return;
+  }
+  u64 frames = std::max<u64>(config.hz * duration_ms / 1'000, 1U);
+
+  Result result{
+      .config = config,
+      .sink = harness.sink,
+      .sent = frames * config.devices,
+      .received = 0U,
+      .dropped = 0U,
+      .overruns = 0U,
+      .read = {},
+      .kernel = {},
+  };
+
+  drain(harness.endpoints, config.devices);
+  std::atomic<bool> running{true};
+  std::thread reader{[&] {
+    read_frames(
+        harness.endpoints, config.devices, harness.kernel_time, running,
+        result
+    );
+  }};
+
+  scheduler.start();
+  for (u64 frame = 0U; frame < frames; ++frame) {
+    auto tag = static_cast<u8>(frame % TAGS);
+    bool press = (frame & 1U) == 0U;
+
+    for (u32 i = 0U; i < config.devices; ++i) {
+      auto& controller = harness.controllers[i];
+      for (u32 button = 0U; button < config.batch; ++button) {
+        if (press) {
+          controller.press_button(static_cast<PS4Button>(button));
+        } else {
+          controller.release_button(static_cast<PS4Button>(button));
+        }
+      }
+      controller.move_stick(PS4Stick::LEFT_X, tag);
+
+      harness.endpoints[i].sent[tag].store(
+          timing::now_ns(), std::memory_order_relaxed
+      );
+      controller.sync();
+    }
+    scheduler.wait();
+  }
+
+  FrameScheduler{}.wait_until(timing::now_ns() + DRAIN_NS);
+  running.store(false, std::memory_order_relaxed);
+  reader.join();
+
+  result.overruns = scheduler.get_stats().overruns;
+  results.push_back(result);
+}
+
+template <typename Sink>
+void run_all(Harness<Sink>& harness, const Options& options) noexcept {
+  for (u32 devices : options.devices) {
+    for (u32 hz : options.rates) {
+      for (u32 batch : options.batches) {
+        run_config(
+            harness, Config{.hz = hz, .batch = batch, .devices = devices},
+            options.duration_ms
+        );
+      }
+    }
+  }
+}
+
+[[nodiscard]] f64 to_us(u64 ns) noexcept {
+  return static_cast<f64>(ns) / timing::NS_PER_US;
+}
+
+[[nodiscard]] f64 get_loss(const Result& result) noexcept {
+  return static_cast<f64>(result.sent - result.received) * 100.0 /
+         result.sent;
+}
+
+void print_csv() noexcept {
+  printf("sink,hz,batch,devices,sent,received,loss_pct,dropped,overruns,"
+         "read_p50_us,read_p99_us,read_p999_us,"
+         "kernel_p50_us,kernel_p99_us,kernel_p999_us\n");
+  for (const auto& result : results) {
+    printf(
+        "%s,%u,%u,%u,%lu,%lu,%.3f,%lu,%lu,%.3f,%.3f,%.3f", result.sink,
+        result.config.hz, result.config.batch, result.config.devices,
+        result.sent, result.received, get_loss(result), result.dropped,
+        result.overruns, to_us(result.read.percentile(50.0)),
+        to_us(result.read.percentile(99.0)),
+        to_us(result.read.percentile(99.9))
+    );
+    if (result.kernel.get_count() == 0U) {
+      printf(",,,\n");
+      continue;
+    }
+    printf(
+        ",%.3f,%.3f,%.3f\n", to_us(result.kernel.percentile(50.0)),
+        to_us(result.kernel.percentile(99.0)),
+        to_us(result.kernel.percentile(99.9))
+    );
+  }
+}
+
+void print_json() noexcept {
+  printf("[\n");
+  for (usize i = 0U; i < results.size(); ++i) {
+    const auto& result = results[i];
+    printf(
+        "  {\"sink\": \"%s\", \"hz\": %u, \"batch\": %u, \"devices\": %u, "
+        "\"sent\": %lu, \"received\": %lu, \"loss_pct\": %.3f, "
+        "\"dropped\": %lu, \"overruns\": %lu, \"read_p50_us\": %.3f, "
+        "\"read_p99_us\": %.3f, \"read_p999_us\": %.3f",
+        result.sink, result.config.hz, result.config.batch,
+        result.config.devices, result.sent, result.received, get_loss(result),
+        result.dropped, result.overruns, to_us(result.read.percentile(50.0)),
+        to_us(result.read.percentile(99.0)),
+        to_us(result.read.percentile(99.9))
+    );
+    if (result.kernel.get_count() == 0U) {
+      printf(
+          ", \"kernel_p50_us\": null, \"kernel_p99_us\": null, "
+          "\"kernel_p999_us\": null}"
+      );
+    } else {
+      printf(
+          ", \"kernel_p50_us\": %.3f, \"kernel_p99_us\": %.3f, "
+          "\"kernel_p999_us\": %.3f}",
+          to_us(result.kernel.percentile(50.0)),
+          to_us(result.kernel.percentile(99.0)),
+          to_us(result.kernel.percentile(99.9))
+      );
+    }
+    printf("%s\n", i + 1U == results.size() ? "" : ",");
+  }
+  printf("]\n");
+}
+
+// Comma separated values in [min, max], false if any is not
+[[nodiscard]] bool
+parse_list(const c8* arg, u32 min, u32 max, std::vector<u32>& out) noexcept {
+  out.clear();
+  const c8* cursor = arg;
+  while (*cursor != '\0') {
+    c8* end = nullptr;
+    u64 value = std::strtoul(cursor, &end, 10);
+    if (end == cursor || value < min || value > max) {
+      return false;
+    }
+    if (*end != ',' && *end != '\0') {
+      return false;
+    }
+    out.push_back(static_cast<u32>(value));
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  return !out.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) noexcept {
+  Options options{};
+  bool valid = true;
+  for (int i = 1; valid && i < argc; ++i) {
+    if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      options.json = std::strcmp(argv[++i], "json") == 0;
+    } else if (std::strcmp(argv[i], "--duration-ms") == 0 && i + 1 < argc) {
+      options.duration_ms = std::strtoll(argv[++i], nullptr, 10);
+      valid = options.duration_ms > 0;
+    } else if (std::strcmp(argv[i], "--rates") == 0 && i + 1 < argc) {
+      valid = parse_list(argv[++i], 1U, 1'000U, options.rates);
+    } else if (std::strcmp(argv[i], "--batches") == 0 && i + 1 < argc) {
+      valid = parse_list(argv[++i], 1U, BUTTONS, options.batches);
+    } else if (std::strcmp(argv[i], "--devices") == 0 && i + 1 < argc) {
+      valid = parse_list(argv[++i], 1U, DEVICES_MAX, options.devices);
+    } else if (std::strcmp(argv[i], "--fallback") == 0) {
+      options.fallback = true;
+    } else {
+      valid = false;
+    }
+  }
+
+  if (!valid) {
+    fprintf(
+        stderr,
+        "Usage: %s [--format csv|json] [--duration-ms N] [--rates 1-1000,...]\n"
+        "  [--batches 1-%u,...] [--devices 1-%u,...] [--fallback]\n",
+        argv[0], BUTTONS, DEVICES_MAX
+    );
+    return 1;
+  }
+
+  u32 count = *std::max_element(options.devices.begin(), options.devices.end());
+  error_code code = error::UNKNOWN;
+  if (!options.fallback) {
+    Harness<uinput::UinputSink> harness{};
+    code = open_devices(harness, count);
+    if (code == error::OK) {
+      run_all(harness, options);
+    } else {
+      fprintf(stderr, "Could not open uinput devices, using pipes instead\n");
+    }
+  }
+
+  if (code != error::OK) {
+    Harness<uinput::FileSink> harness{};
+    if (open_devices(harness, count) != error::OK) {
+      fprintf(stderr, "Could not open the pipes\n");
+      return 1;
+    }
+    run_all(harness, options);
+  }
+
+  if (options.json) {
+    print_json();
+  } else {
+    print_csv();
+  }
+
+  return 0;
+}
@@ -0,0 +1,578 @@
+#include "../controller/keyboard.hpp"
+#include "../controller/mouse.hpp"
+#include "../controller/pool.hpp"
+#include "../controller/ps4.hpp"
+#include "../controller/touchpad.hpp"
+#include "../ipc/client.hpp"
+#include "../ipc/daemon.hpp"
+#include "../motion/engine.hpp"
+#include "../script/executor.hpp"
+#include "../timing/clock.hpp"
+#include "../turbo/engine.hpp"
+#include "../types.hpp"
+#include "../uinput/sink.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Microbenchmarks of the controller hot paths.
+ *
+ * Usage: vc_bench [--format csv|json] [--iterations N] [--uinput]
+ *
+ * Every case runs against the null and ring sinks. With --uinput the cases
+ * also run against real devices, these inject real input into the session.
+ */
+
+namespace {
+
+using namespace vc;
+
+struct Result {
+  const c8* name;
+  const c8* sink;
+  u64 frames;
+  u64 events;
+  u64 writes;
+  i64 elapsed_ns;
+};
+
+struct Options {
+  u64 iterations = 200'000U;
+  bool json = false;
+  bool uinput = false;
+};
+
+std::vector<Result> results{}; // NOLINT
+
+template <typename Device, typename Fn>
+void run(
+    const c8* name, const c8* sink, Device& device, u64 iterations,
+    u64 frames_per_iteration, u64 events_per_iteration, Fn&& fn
+) noexcept {
+  u64 writes = device.get_sink().get_writes();
+
+  i64 start = timing::now_ns();
+  for (u64 i = 0U; i < iterations; ++i) {
+    fn(device, i);
+  }
+  i64 elapsed = timing::now_ns() - start;
+
+  results.push_back(Result{
+      .name = name,
+      .sink = sink,
+      .frames = iterations * frames_per_iteration,
+      .events = iterations * events_per_iteration,
+      .writes = device.get_sink().get_writes() - writes,
+      .elapsed_ns = elapsed,
+  });
+}
+
+template <typename Sink>
+void bench_ps4(const c8* sink, const Options& options) noexcept {
+  BasicPS4Controller<Sink> controller{};
+  if (controller.init("Benchmark PS4 Controller", true) != error::OK) {
+    fprintf(stderr, "Skipping ps4 on %s sink, could not init\n", sink);
+    return;
+  }
+  controller.sync();
+
+  // press + sync + release + sync
+  run("press_button", sink, controller, options.iterations, 2U, 4U,
+      [](auto& c, u64 i) {
+        c.press_button(PS4Button::CROSS);
+        c.sync();
+        c.release_button(PS4Button::CROSS);
+        c.sync();
+      });
+
+  // 4 sticks + sync, alternating between both ends so every call emits
+  run("move_stick", sink, controller, options.iterations, 1U, 5U,
+      [](auto& c, u64 i) {
+        u8 value = (i & 1U) ? 0x00 : 0xff;
+        c.move_stick(PS4Stick::LEFT_X, value);
+        c.move_stick(PS4Stick::LEFT_Y, value);
+        c.move_stick(PS4Stick::RIGHT_X, value);
+        c.move_stick(PS4Stick::RIGHT_Y, value);
+        c.sync();
+      });
+
+  run("move_stickf", sink, controller, options.iterations, 1U, 5U,
+      [](auto& c, u64 i) {
+        f32 value = (i & 1U) ? 0.0F : 1.0F;
+        c.move_stickf(PS4Stick::LEFT_X, value);
+        c.move_stickf(PS4Stick::LEFT_Y, value);
+        c.move_stickf(PS4Stick::RIGHT_X, value);
+        c.move_stickf(PS4Stick::RIGHT_Y, value);
+        c.sync();
+      });
+
+  // Full state frame: 13 buttons + 4 sticks + 2 dpad axes + sync
+  auto full_frame = [](auto& c, u64 i) {
+    bool press = (i & 1U) == 0U;
+    for (u16 button = PS4Button::CROSS; button <= PS4Button::R3; ++button) {
+      if (press) {
+        c.press_button(static_cast<PS4Button>(button));
+      } else {
+        c.release_button(static_cast<PS4Button>(button));
+      }
+    }
+
+    u8 value = press ? 0x00 : 0xff;
+    c.move_stick(PS4Stick::LEFT_X, value);
+    c.move_stick(PS4Stick::LEFT_Y, value);
+    c.move_stick(PS4Stick::RIGHT_X, value);
+    c.move_stick(PS4Stick::RIGHT_Y, value);
+
+    if (press) {
+      c.press_up();
+      c.press_left();
+    } else {
+      c.release_up();
+      c.release_left();
+    }
+    c.sync();
+  };
+  run("sync", sink, controller, options.iterations, 1U, 20U, full_frame);
+
+  controller.set_immediate(true);
+  run("sync_immediate", sink, controller, options.iterations, 1U, 20U,
+      full_frame);
+  controller.set_immediate(false);
+
+  // Diff based, only one button and one stick changes per frame
+  run("apply", sink, controller, options.iterations, 1U, 3U,
+      [](auto& c, u64 i) {
+        PS4State state = c.get_state();
+        state.set_button(PS4Button::CROSS, (i & 1U) == 0U);
+        state.set_stick(PS4Stick::LEFT_X, (i & 1U) ? 0x00 : 0xff);
+        c.apply(state);
+      });
+}
+
+template <typename Sink>
+void bench_keyboard(const c8* sink, const Options& options) noexcept {
+  BasicKeyboard<Sink> keyboard{};
+  if (keyboard.init() != error::OK) {
+    fprintf(stderr, "Skipping keyboard on %s sink, could not init\n", sink);
+    return;
+  }
+  keyboard.set_delay(0U);
+  // Don't type into whatever window has the focus when running on uinput
+  keyboard.remap('a', KEY_SCROLLLOCK);
+
+  // press + sync + release + sync
+  run("key_press", sink, keyboard, options.iterations, 2U, 4U,
+      [](auto& k, u64 i) { k.key_press('a'); });
+}
+
+template <typename Sink>
+u64 count_writes(BasicControllerPool<Sink>& pool) noexcept {
+  u64 writes = 0U;
+  for (usize i = 0U; i < pool.get_controller_count(); ++i) {
+    writes += pool.get_controller(i).get_sink().get_writes();
+  }
+  return writes;
+}
+
+template <typename Sink>
+u64 count_sensor_writes(BasicControllerPool<Sink>& pool) noexcept {
+  u64 writes = 0U;
+  for (usize i = 0U; i < pool.get_controller_count(); ++i) {
+    auto* sensors = pool.get_controller(i).get_motion_sensors();
+    writes += sensors != nullptr ? sensors->get_sink().get_writes() : 0U;
+  }
+  return writes;
+}
+
+template <typename Sink>
+void bench_pool(const c8* sink, const Options& options) noexcept {
+  constexpr usize DEVICES = 256U;
+
+  BasicControllerPool<Sink> pool{};
+  if (pool.init(DEVICES, 0U, "Benchmark PS4 Controller", true) != error::OK) {
+    fprintf(stderr, "Skipping pool on %s sink, could not init\n", sink);
+    return;
+  }
+  pool.flush();
+
+  // Every device toggles a button each tick: button + sync per device
+  u64 iterations = std::max<u64>(options.iterations / DEVICES, 1U);
+  u64 writes = count_writes(pool);
+  i64 start = timing::now_ns();
+  for (u64 i = 0U; i < iterations; ++i) {
+    for (usize d = 0U; d < DEVICES; ++d) {
+      auto& controller = pool.get_controller(d);
+      if (i & 1U) {
+        controller.release_button(PS4Button::CROSS);
+      } else {
+        controller.press_button(PS4Button::CROSS);
+      }
+    }
+    pool.flush();
+  }
+  i64 elapsed = timing::now_ns() - start;
+
+  results.push_back(Result{
+      .name = "pool_flush_256",
+      .sink = sink,
+      .frames = iterations * DEVICES,
+      .events = iterations * DEVICES * 2U,
+      .writes = count_writes(pool) - writes,
+      .elapsed_ns = elapsed,
+  });
+}
+
+template <typename Sink>
+void bench_motion(const c8* sink, const Options& options) noexcept {
+  constexpr usize DEVICES = 2048U;
+
+  BasicControllerPool<Sink> pool{};
+  if (pool.init(DEVICES, 0U, "Benchmark PS4 Controller", true) != error::OK) {
+    fprintf(stderr, "Skipping motion on %s sink, could not init\n", sink);
+    return;
+  }
+  pool.flush();
+
+  // Both sticks of every device run a 10s trajectory
+  constexpr i64 DURATION = 10 * timing::NS_PER_S;
+  BasicMotionEngine<Sink> engine{};
+  for (u32 d = 0U; d < DEVICES; ++d) {
+    engine.move(
+        d, StickPair::LEFT, Point{.x = 0.0F, .y = 0.0F},
+        Point{.x = 1.0F, .y = 1.0F}, DURATION, Curve::EASE_IN_OUT
+    );
+    engine.circle(
+        d, StickPair::RIGHT, Point{.x = 0.5F, .y = 0.5F}, 0.5F, 0.0F, 1.0F,
+        DURATION
+    );
+  }
+
+  // Ticks are 1ms apart like a 1kHz loop, only some sticks change per tick
+  u64 iterations = std::max<u64>(options.iterations / DEVICES, 1U);
+  u64 writes = count_writes(pool);
+  i64 now = timing::now_ns();
+  i64 start = timing::now_ns();
+  for (u64 i = 0U; i < iterations; ++i) {
+    now += timing::NS_PER_MS;
+    engine.update(now, pool);
+    pool.flush();
+  }
+  i64 elapsed = timing::now_ns() - start;
+
+  results.push_back(Result{
+      .name = "motion_4096",
+      .sink = sink,
+      .frames = iterations * DEVICES,
+      // Trajectories evaluated
+      .events = iterations * DEVICES * 2U,
+      .writes = count_writes(pool) - writes,
+      .elapsed_ns = elapsed,
+  });
+}
+
+template <typename Sink>
+void bench_turbo(const c8* sink, const Options& options) noexcept {
+  constexpr usize DEVICES = 64U;
+  constexpr u32 BUTTONS = 8U;
+  // 250Hz flush, the wheel advances 4 ticks per flush
+  constexpr i64 TICK = 4 * timing::NS_PER_MS;
+
+  BasicControllerPool<Sink> pool{};
+  if (pool.init(DEVICES, 0U, "Benchmark PS4 Controller", true) != error::OK) {
+    fprintf(stderr, "Skipping turbo on %s sink, could not init\n", sink);
+    return;
+  }
+  pool.flush();
+
+  // 512 patterns from 5 to 20 presses per second
+  BasicTurboEngine<Sink> turbo{};
+  i64 now = timing::now_ns();
+  for (u32 d = 0U; d < DEVICES; ++d) {
+    for (u32 button = 0U; button < BUTTONS; ++button) {
+      turbo.set(
+          d, static_cast<PS4Button>(button),
+          TurboPattern{.rate = 5.0F + static_cast<f32>((d + button) % 16U)},
+          now
+      );
+    }
+  }
+
+  u64 iterations = std::max<u64>(options.iterations / DEVICES, 1U);
+  u64 toggles = 0U;
+  u64 writes = count_writes(pool);
+  i64 start = timing::now_ns();
+  for (u64 i = 0U; i < iterations; ++i) {
+    toggles += turbo.update(now + static_cast<i64>(i) * TICK, pool);
+    pool.flush();
+  }
+  i64 elapsed = timing::now_ns() - start;
+
+  results.push_back(Result{
+      .name = "turbo_512",
+      .sink = sink,
+      .frames = iterations * DEVICES,
+      .events = std::max<u64>(toggles, 1U),
+      .writes = count_writes(pool) - writes,
+      .elapsed_ns = elapsed,
+  });
+}
+
+template <typename Sink>
+void bench_script(const c8* sink, const Options& options) noexcept {
+  BasicPS4Controller<Sink> controller{};
+  if (controller.init("Benchmark PS4 Controller", true) != error::OK) {
+    fprintf(stderr, "Skipping script on %s sink, could not init\n", sink);
+    return;
+  }
+  controller.sync();
+
+  // Same frames as press_button, one plan loop per iteration
+  PlanSlot slot{PlanTarget::GAMEPAD};
+  if (slot.load("CROSS down; wait 1ms; CROSS up; wait 1ms") != error::OK) {
+    return;
+  }
+
+  PlanExecutor<BasicPS4Controller<Sink>> executor{};
+  (void)executor.start(slot, true, 1);
+  i64 now = 1;
+  run("plan_execute", sink, controller, options.iterations, 2U, 4U,
+      [&executor, &now](auto& c, u64 i) {
+        executor.update(c, now);
+        executor.update(c, now + timing::NS_PER_MS);
+        now += 2 * timing::NS_PER_MS;
+      });
+}
+
+template <typename Sink>
+void bench_pointer(const c8* sink, const Options& options) noexcept {
+  // Updates of a high DPI mouse per 1kHz tick
+  constexpr u64 UPDATES = 8U;
+
+  BasicMouse<Sink> mouse{};
+  if (mouse.init("Benchmark Mouse") != error::OK) {
+    fprintf(stderr, "Skipping mouse on %s sink, could not init\n", sink);
+    return;
+  }
+
+  run("mouse_move_8", sink, mouse, options.iterations, 1U, UPDATES,
+      [](auto& m, u64 i) {
+        for (u64 u = 0U; u < UPDATES; ++u) {
+          m.move(0.4F, -0.3F);
+        }
+        m.sync();
+      });
+
+  BasicTouchpad<Sink> touchpad{};
+  if (touchpad.init("Benchmark Touchpad") != error::OK) {
+    fprintf(stderr, "Skipping touchpad on %s sink, could not init\n", sink);
+    return;
+  }
+
+  // Two fingers dragging apart
+  touchpad.touch(0U, 900.0F, 400.0F);
+  touchpad.touch(1U, 1000.0F, 400.0F);
+  touchpad.sync();
+  run("touchpad_drag_8", sink, touchpad, options.iterations, 1U, UPDATES,
+      [](auto& t, u64 i) {
+        f32 direction = (i / 1024U) & 1U ? 1.0F : -1.0F;
+        for (u64 u = 0U; u < UPDATES; u += 2U) {
+          t.move(0U, -0.25F * direction, 0.0F);
+          t.move(1U, 0.25F * direction, 0.0F);
+        }
+        t.sync();
+      });
+}
+
+template <typename Sink>
+void bench_sensors(const c8* sink, const Options& options) noexcept {
+  constexpr usize DEVICES = 16U;
+  // 1kHz samples flushed by a 250Hz tick
+  constexpr i64 TICK = 4 * timing::NS_PER_MS;
+  constexpr u64 SAMPLES_PER_TICK = 4U;
+
+  BasicControllerPool<Sink> pool{};
+  if (pool.init(DEVICES, 0U, "Benchmark PS4 Controller", true, true) !=
+      error::OK) {
+    fprintf(stderr, "Skipping sensors on %s sink, could not init\n", sink);
+    return;
+  }
+  pool.flush();
+
+  MotionWaveform waveform{};
+  waveform.accel[1].offset = 1.0F;
+  waveform.gyro[0] = AxisWave{.amplitude = 90.0F, .hz = 2.0F};
+  for (usize d = 0U; d < DEVICES; ++d) {
+    auto* sensors = pool.get_controller(d).get_motion_sensors();
+    sensors->set_waveform(waveform, 0);
+    (void)sensors->update(0);
+  }
+
+  u64 iterations =
+      std::max<u64>(options.iterations / (DEVICES * SAMPLES_PER_TICK), 1U);
+  u64 writes = count_sensor_writes(pool);
+  i64 now = 0;
+  i64 start = timing::now_ns();
+  for (u64 i = 0U; i < iterations; ++i) {
+    now += TICK;
+    for (usize d = 0U; d < DEVICES; ++d) {
+      (void)pool.get_controller(d).get_motion_sensors()->update(now);
+    }
+  }
+  i64 elapsed = timing::now_ns() - start;
+
+  results.push_back(Result{
+      .name = "sensors_1khz_16",
+      .sink = sink,
+      .frames = iterations * DEVICES * SAMPLES_PER_TICK,
+      // Samples, each one MSC_TIMESTAMP and 6 axes
+      .events = iterations * DEVICES * SAMPLES_PER_TICK,
+      .writes = count_sensor_writes(pool) - writes,
+      .elapsed_ns = elapsed,
+  });
+}
+
+template <typename Sink>
+void bench_daemon(const c8* sink, const Options& options) noexcept {
+  constexpr usize DEVICES = 64U;
+  constexpr usize BATCH = 1024U;
+
+  BasicControllerPool<Sink> pool{};
+  if (pool.init(DEVICES, 0U, "Benchmark PS4 Controller", true) != error::OK) {
+    fprintf(stderr, "Skipping daemon on %s sink, could not init\n", sink);
+    return;
+  }
+  pool.flush();
+
+  std::array<c8, 64> path{};
+  snprintf(path.data(), path.size(), "/tmp/vc_bench_%d.sock", getpid());
+  ipc::BasicDaemon<Sink> daemon{};
+  ipc::Client client{};
+  if (daemon.listen(path.data(), pool) != error::OK ||
+      client.connect(path.data()) != error::OK) {
+    fprintf(stderr, "Skipping daemon on %s sink, no socket\n", sink);
+    return;
+  }
+  (void)daemon.poll(0);
+
+  // A batch moves a stick of every device over and over, so the records of
+  // a device fold into one frame per batch
+  u64 iterations = std::max<u64>(options.iterations / BATCH, 1U);
+  u64 writes = count_writes(pool);
+  i64 start = timing::now_ns();
+  for (u64 i = 0U; i < iterations; ++i) {
+    for (usize r = 0U; r < BATCH; ++r) {
+      client.move_stick(
+          static_cast<u16>(r % DEVICES), PS4Stick::LEFT_X,
+          static_cast<u8>((i + r / DEVICES) & 0xffU)
+      );
+    }
+    (void)client.flush();
+
+    u64 total = daemon.get_stats().records + BATCH;
+    while (daemon.get_stats().records < total) {
+      (void)daemon.poll(-1);
+    }
+  }
+  i64 elapsed = timing::now_ns() - start;
+
+  results.push_back(Result{
+      .name = "daemon_records_1024",
+      .sink = sink,
+      .frames = iterations * DEVICES,
+      // Records sent through the socket
+      .events = iterations * BATCH,
+      .writes = count_writes(pool) - writes,
+      .elapsed_ns = elapsed,
+  });
+}
+
+template <typename Sink>
+void bench_all(const c8* sink, const Options& options) noexcept {
+  bench_ps4<Sink>(sink, options);
+  bench_keyboard<Sink>(sink, options);
+  bench_pool<Sink>(sink, options);
+  bench_motion<Sink>(sink, options);
+  bench_turbo<Sink>(sink, options);
+  bench_script<Sink>(sink, options);
+  bench_pointer<Sink>(sink, options);
+  bench_sensors<Sink>(sink, options);
+  bench_daemon<Sink>(sink, options);
+}
+
+void print_csv() noexcept {
+  printf("case,sink,frames,events,writes,ns_per_event,events_per_sec,"
+         "writes_per_frame\n");
+  for (const auto& result : results) {
+    printf(
+        "%s,%s,%lu,%lu,%lu,%.3f,%.0f,%.3f\n", result.name, result.sink,
+        result.frames, result.events, result.writes,
+        static_cast<f64>(result.elapsed_ns) / result.events,
+        result.events * 1e9 / result.elapsed_ns,
+        static_cast<f64>(result.writes) / result.frames
+    );
+  }
+}
+
+void print_json() noexcept {
+  printf("[\n");
+  for (usize i = 0U; i < results.size(); ++i) {
+    const auto& result = results[i];
+    printf(
+        "  {\"case\": \"%s\", \"sink\": \"%s\", \"frames\": %lu, "
+        "\"events\": %lu, \"writes\": %lu, \"ns_per_event\": %.3f, "
+        "\"events_per_sec\": %.0f, \"writes_per_frame\": %.3f}%s\n",
+        result.name, result.sink, result.frames, result.events, result.writes,
+        static_cast<f64>(result.elapsed_ns) / result.events,
+        result.events * 1e9 / result.elapsed_ns,
+        static_cast<f64>(result.writes) / result.frames,
+        i + 1U == results.size() ? "" : ","
+    );
+  }
+  printf("]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) noexcept {
+  Options options{};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      options.json = std::strcmp(argv[++i], "json") == 0;
+    } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      options.iterations = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--uinput") == 0) {
+      options.uinput = true;
+    } else {
+      fprintf(
+          stderr,
+          "Usage: %s [--format csv|json] [--iterations N] [--uinput]\n",
+          argv[0]
+      );
+      return 1;
+    }
+  }
+
+  if (options.iterations == 0U) {
+    fprintf(stderr, "Iterations should be greater than 0\n");
+    return 1;
+  }
+
+  bench_all<uinput::NullSink>("null", options);
+  bench_all<uinput::RingSink>("ring", options);
+  if (options.uinput) {
+    bench_all<uinput::UinputSink>("uinput", options);
+  }
+
+  if (options.json) {
+    print_json();
+  } else {
+    print_csv();
+  }
+
+  return 0;
+}
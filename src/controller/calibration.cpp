@@ -0,0 +1,390 @@
+#include "./calibration.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace vc {
+
+namespace {
+
+// Key press as the consumer reads it, with the state of shift at the time
+struct Typed {
+  u16 code;
+  bool shift;
+
+  bool operator==(const Typed& rhs) const noexcept {
+    return this->code == rhs.code && this->shift == rhs.shift;
+  }
+};
+
+// Reads the typed text back and compares it to what key_press writes
+template <typename Sink> class Trial {
+public:
+  Trial(
+      BasicKeyboard<Sink>& keyboard, i32 fd, const CalibrationOptions& options,
+      CalibrationReport& report
+  ) noexcept
+      : keyboard(keyboard), fd(fd), options(options), report(report) {
+    this->expected.reserve(options.text.size());
+    this->sampled.reserve(options.text.size());
+
+    for (const c8 key : options.text) {
+      u16 code = keyboard.get_code(key);
+      if (code == 0U) {
+        continue;
+      }
+
+      bool shift = code & Modifiers::SHIFT;
+      this->expected.push_back(Typed{
+          .code = static_cast<u16>(code & ~Modifiers::SHIFT),
+          .shift = shift,
+      });
+      // A press and a release, with those of shift
+      this->events += shift ? 4U : 2U;
+    }
+    this->received.reserve(this->events);
+  }
+
+  // Every trial of the timing has to pass
+  [[nodiscard]] bool passes(const KeyboardTiming& timing) noexcept {
+    this->keyboard.set_timing(timing);
+    for (u32 i = 0U; i < this->options.trials; ++i) {
+      if (!this->run()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  struct Received {
+    u16 code;
+    i32 value;
+    i64 time;
+  };
+
+  BasicKeyboard<Sink>& keyboard;
+  i32 fd;
+  const CalibrationOptions& options;
+  CalibrationReport& report;
+
+  std::vector<Typed> expected{};
+  // Key events key_press writes for the text
+  usize events = 0U;
+  std::vector<Received> received{};
+  std::vector<Typed> sampled{};
+  bool overflowed = false;
+
+  [[nodiscard]] bool run() noexcept {
+    ++this->report.trials;
+    this->drain();
+    this->received.clear();
+    this->overflowed = false;
+
+    // Typed from its own thread so events are read as they come, the ones
+    // stamped when read keep their spacing
+    std::atomic<bool> typed{false};
+    std::thread typist{[this, &typed] {
+      for (const c8 key : this->options.text) {
+        this->keyboard.key_press(key);
+      }
+      this->keyboard.wait(this->keyboard.fence());
+      typed.store(true);
+    }};
+
+    i64 deadline = INT64_MAX;
+    while (this->received.size() < this->events) {
+      i64 now = timing::now_ns();
+      if (deadline == INT64_MAX && typed.load()) {
+        deadline = now + this->options.timeout_ms * timing::NS_PER_MS;
+      }
+      if (now >= deadline) {
+        break;
+      }
+
+      // Wakes up every ms to see if the typing is done
+      pollfd request{.fd = this->fd, .events = POLLIN, .revents = 0};
+      if (poll(&request, 1U, 1) == -1 && errno != EINTR) {
+        break;
+      }
+      this->drain();
+    }
+    typist.join();
+
+    if (this->overflowed) {
+      ++this->report.dropped;
+      return false;
+    }
+    this->sample();
+    if (this->sampled.size() < this->expected.size()) {
+      ++this->report.lost;
+      return false;
+    }
+    if (this->sampled != this->expected) {
+      ++this->report.reordered;
+      return false;
+    }
+    return true;
+  }
+
+  void drain() noexcept {
+    std::array<input_event, 64> buffer{};
+    while (true) {
+      isize bytes = read(this->fd, buffer.data(), sizeof(buffer));
+      if (bytes <= 0) {
+        return;
+      }
+
+      i64 now = timing::now_ns();
+      usize count = bytes / sizeof(input_event);
+      for (usize i = 0U; i < count; ++i) {
+        const auto& event = buffer[i];
+        if (event.type == EV_KEY) {
+          i64 time = event.input_event_sec * timing::NS_PER_S +
+                     event.input_event_usec * timing::NS_PER_US;
+          this->received.push_back(Received{
+              .code = event.code,
+              .value = event.value,
+              .time = time == 0 ? now : time,
+          });
+        } else if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+          this->overflowed = true;
+        }
+      }
+    }
+  }
+
+  /**
+   * Turns the received events into the keys the consumer sees pressed.
+   * Events less than a poll apart may be sampled together, a sample only
+   * shows the keys that went down since the last one (in no particular
+   * order, by code here) along with the shift state of the sample. A key
+   * pressed and released within a sample is never seen
+   */
+  void sample() noexcept {
+    this->sampled.clear();
+    i64 interval = this->options.poll_interval * timing::NS_PER_US;
+
+    std::bitset<KEY_CNT> state{};
+    std::bitset<KEY_CNT> before{};
+    usize begin = 0U;
+    while (begin < this->received.size()) {
+      usize end = begin + 1U;
+      while (end < this->received.size() &&
+             this->received[end].time - this->received[end - 1U].time <
+                 interval) {
+        ++end;
+      }
+
+      before = state;
+      for (usize i = begin; i < end; ++i) {
+        const auto& event = this->received[i];
+        if (event.code < KEY_CNT) {
+          state[event.code] = event.value != 0;
+        }
+      }
+
+      for (u16 code = 0U; code < KEY_CNT; ++code) {
+        if (code != KEY_LEFTSHIFT && state[code] && !before[code]) {
+          this->sampled.push_back(Typed{
+              .code = code,
+              .shift = state[KEY_LEFTSHIFT],
+          });
+        }
+      }
+      begin = end;
+    }
+  }
+};
+
+/**
+ * Smallest value of the delay that passes with the others at max_delay,
+ * timing is left at the max
+ */
+template <typename Sink>
+[[nodiscard]] u32 search(
+    Trial<Sink>& trial, u32 KeyboardTiming::*delay,
+    const CalibrationOptions& options
+) noexcept {
+  KeyboardTiming timing{
+      .modifier = options.max_delay,
+      .press = options.max_delay,
+      .release = options.max_delay,
+  };
+  timing.*delay = 0U;
+  if (trial.passes(timing)) {
+    return 0U;
+  }
+
+  // max_delay is known to pass
+  u32 low = 0U;
+  u32 high = options.max_delay;
+  while (high - low > std::max(options.resolution, 1U)) {
+    u32 middle = low + (high - low) / 2U;
+    timing.*delay = middle;
+    if (trial.passes(timing)) {
+      high = middle;
+    } else {
+      low = middle;
+    }
+  }
+  return high;
+}
+
+[[nodiscard]] u32 with_margin(u32 delay, const CalibrationOptions& options) {
+  f32 value = static_cast<f32>(delay) * std::max(options.margin, 1.0F);
+  return std::min(static_cast<u32>(value), options.max_delay);
+}
+
+} // namespace
+
+template <typename Sink>
+error_code calibrate_keyboard(
+    BasicKeyboard<Sink>& keyboard, i32 reader_fd,
+    const CalibrationOptions& options, CalibrationReport& report
+) noexcept {
+  report = CalibrationReport{};
+  KeyboardTiming previous = keyboard.get_timing();
+  Trial<Sink> trial{keyboard, reader_fd, options, report};
+
+  KeyboardTiming timing{
+      .modifier = options.max_delay,
+      .press = options.max_delay,
+      .release = options.max_delay,
+  };
+  if (!trial.passes(timing)) {
+    keyboard.set_timing(previous);
+    return error::CALIBRATION_FAILED;
+  }
+
+  u32 modifier = search(trial, &KeyboardTiming::modifier, options);
+  u32 press = search(trial, &KeyboardTiming::press, options);
+  u32 release = search(trial, &KeyboardTiming::release, options);
+  timing = KeyboardTiming{
+      .modifier = with_margin(modifier, options),
+      .press = with_margin(press, options),
+      .release = with_margin(release, options),
+  };
+
+  // Each delay was found with the others at the max, check them together
+  bool passed = trial.passes(timing);
+  keyboard.set_timing(previous);
+  if (!passed) {
+    return error::CALIBRATION_FAILED;
+  }
+  report.timing = timing;
+  return error::OK;
+}
+
+error_code calibrate_keyboard(
+    Keyboard& keyboard, const CalibrationOptions& options,
+    CalibrationReport& report
+) noexcept {
+  const c8* node = keyboard.get_sink().get_node();
+  if (node[0] == '\0') {
+    return error::CALIBRATION_OPEN;
+  }
+
+  i32 fd = open(node, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd == -1) {
+    return error::CALIBRATION_OPEN;
+  }
+
+  // Keeps the text out of the focused window
+  if (ioctl(fd, EVIOCGRAB, 1) == -1) {
+    close(fd);
+    return error::CALIBRATION_OPEN;
+  }
+
+  error_code code = calibrate_keyboard(keyboard, fd, options, report);
+  (void)ioctl(fd, EVIOCGRAB, 0);
+  close(fd);
+  return code;
+}
+
+error_code
+save_keyboard_timing(const c8* path, const KeyboardTiming& timing) noexcept {
+  FILE* file = fopen(path, "we");
+  if (file == nullptr) {
+    return error::PROFILE_OPEN;
+  }
+
+  i32 written = fprintf(
+      file, "modifier %u\npress %u\nrelease %u\n", timing.modifier,
+      timing.press, timing.release
+  );
+  bool failed = written < 0;
+  failed = fclose(file) != 0 || failed;
+  return failed ? error::PROFILE_OPEN : error::OK;
+}
+
+error_code
+load_keyboard_timing(const c8* path, KeyboardTiming& timing) noexcept {
+  FILE* file = fopen(path, "re");
+  if (file == nullptr) {
+    return error::PROFILE_OPEN;
+  }
+
+  KeyboardTiming loaded = timing;
+  std::array<c8, 16> name{};
+  u32 value = 0U;
+  error_code code = error::OK;
+  while (true) {
+    i32 matched = fscanf(file, "%15s %u", name.data(), &value);
+    if (matched == EOF) {
+      break;
+    }
+    if (matched != 2) {
+      code = error::PROFILE_FORMAT;
+      break;
+    }
+
+    if (strcmp(name.data(), "modifier") == 0) {
+      loaded.modifier = value;
+    } else if (strcmp(name.data(), "press") == 0) {
+      loaded.press = value;
+    } else if (strcmp(name.data(), "release") == 0) {
+      loaded.release = value;
+    } else {
+      code = error::PROFILE_FORMAT;
+      break;
+    }
+  }
+  fclose(file);
+
+  if (code == error::OK) {
+    timing = loaded;
+  }
+  return code;
+}
+
+template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::UinputSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::NullSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::RingSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::FileSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+
+} // namespace vc
@@ -0,0 +1,102 @@
+#ifndef VC_CONTROLLER_CALIBRATION_HPP
+#define VC_CONTROLLER_CALIBRATION_HPP
+
+#include "../types.hpp"
+#include "./keyboard.hpp"
+#include <string_view>
+
+namespace vc {
+
+struct CalibrationOptions {
+  // Typed every trial, mixes shifted characters and repeated keys
+  std::string_view text = "The QUICK, brown fox jumps off 1234 lazy dogs!";
+  // Search range in us, the max has to pass for the calibration to succeed
+  u32 max_delay = 50'000;
+  // Interval in us the consumer samples the key state at, once per frame of
+  // a game at 60 FPS by default. 0 for readers taking every event as is
+  u32 poll_interval = 16'667;
+  // The search stops once the bounds are this close, in us
+  u32 resolution = 25;
+  // Every trial of a delay has to pass for it to be accepted
+  u32 trials = 3;
+  // Applied to the smallest delays that passed
+  f32 margin = 1.5F;
+  // How long the read back waits for the last events
+  i32 timeout_ms = 100;
+};
+
+struct CalibrationReport {
+  KeyboardTiming timing{};
+  u64 trials = 0U;
+  // Trials that failed, a trial can count in more than one
+  u64 lost = 0U;
+  u64 reordered = 0U;
+  // The reader saw a SYN_DROPPED, its buffer overflowed
+  u64 dropped = 0U;
+};
+
+/**
+ * Finds the smallest delays of each kind of frame a consumer sampling the
+ * key state every poll_interval keeps up with. A known text is typed and
+ * read back from the event node of the keyboard as that consumer would see
+ * it: events less than an interval apart may fall in the same sample, which
+ * only tells the keys that went down and whether shift is held. A trial
+ * fails if a key is missed, typed out of order or with the wrong shift, or
+ * if the reader dropped events. Each delay is binary searched on its own
+ * with the others at the max, then the margin is applied and the result
+ * has to pass as a whole.
+ *
+ * The node is grabbed while calibrating so the text doesn't reach the
+ * focused window. Events without a timestamp, ie. from a pipe, are stamped
+ * when read
+ *
+ * CalibrationReport report{};
+ * if (calibrate_keyboard(keyboard, {}, report) == error::OK) {
+ *   keyboard.set_timing(report.timing);
+ *   (void)save_keyboard_timing("keyboard.profile", report.timing);
+ * }
+ *
+ * Needs wait_ready to have found the node, the worker may be running
+ */
+[[nodiscard]] error_code calibrate_keyboard(
+    Keyboard& keyboard, const CalibrationOptions& options,
+    CalibrationReport& report
+) noexcept;
+
+/**
+ * Same as calibrate_keyboard but reads the events back from an fd owned by
+ * the caller, ie. the read end of a pipe fed by a FileSink
+ */
+template <typename Sink>
+[[nodiscard]] error_code calibrate_keyboard(
+    BasicKeyboard<Sink>& keyboard, i32 reader_fd,
+    const CalibrationOptions& options, CalibrationReport& report
+) noexcept;
+
+// Text file of "modifier <us>", "press <us>" and "release <us>" lines
+[[nodiscard]] error_code
+save_keyboard_timing(const c8* path, const KeyboardTiming& timing) noexcept;
+// Keys missing from the file keep their current value
+[[nodiscard]] error_code
+load_keyboard_timing(const c8* path, KeyboardTiming& timing) noexcept;
+
+extern template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::UinputSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+extern template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::NullSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+extern template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::RingSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+extern template error_code calibrate_keyboard(
+    BasicKeyboard<uinput::FileSink>&, i32, const CalibrationOptions&,
+    CalibrationReport&
+) noexcept;
+
+} // namespace vc
+
+#endif
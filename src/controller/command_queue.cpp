@@ -0,0 +1,212 @@
+#include "./command_queue.hpp"
+#include "../timing/scheduler.hpp"
+#include <algorithm>
+
+namespace vc {
+
+namespace {
+
+// Bits 0-12 are the buttons, the d-pad axes come after them
+constexpr u32 DPAD_X_BIT = 1U << 16U;
+constexpr u32 DPAD_Y_BIT = 1U << 17U;
+
+/**
+ * Folds a command into the state of the current tick.
+ * @param touched - bits of the buttons and d-pad axes changed this tick
+ * @return false if the command would undo a change of this tick
+ */
+[[nodiscard]] bool
+fold(PS4State& state, const PS4Command& command, u32& touched) noexcept {
+  switch (command.type) {
+  case PS4CommandType::PRESS:
+  case PS4CommandType::RELEASE: {
+    auto button = static_cast<PS4Button>(command.target);
+    bool press = command.type == PS4CommandType::PRESS;
+    if (state.is_button_pressed(button) == press) {
+      return true;
+    }
+
+    u32 bit = 1U << button;
+    if (touched & bit) {
+      return false;
+    }
+    touched |= bit;
+    state.set_button(button, press);
+    return true;
+  }
+
+  case PS4CommandType::STICK:
+    state.set_stick(
+        static_cast<PS4Stick>(command.target), static_cast<u8>(command.value)
+    );
+    return true;
+
+  case PS4CommandType::DPAD: {
+    auto dpad = static_cast<PS4DPad>(command.target);
+    auto value = static_cast<i8>(command.value);
+    if (state.get_dpad(dpad) == value) {
+      return true;
+    }
+
+    u32 bit = dpad == PS4DPad::X ? DPAD_X_BIT : DPAD_Y_BIT;
+    if (touched & bit) {
+      return false;
+    }
+    touched |= bit;
+    state.set_dpad(dpad, value);
+    return true;
+  }
+  }
+
+  return true;
+}
+
+} // namespace
+
+template <typename Sink>
+BasicPS4CommandQueue<Sink>::~BasicPS4CommandQueue() noexcept {
+  this->stop();
+}
+
+template <typename Sink>
+bool BasicPS4CommandQueue<Sink>::press_button(PS4Button button) noexcept {
+  return this->push(PS4Command{
+      .type = PS4CommandType::PRESS,
+      .target = static_cast<u8>(button),
+      .value = 1,
+  });
+}
+
+template <typename Sink>
+bool BasicPS4CommandQueue<Sink>::release_button(PS4Button button) noexcept {
+  return this->push(PS4Command{
+      .type = PS4CommandType::RELEASE,
+      .target = static_cast<u8>(button),
+      .value = 0,
+  });
+}
+
+template <typename Sink>
+bool BasicPS4CommandQueue<Sink>::move_stick(PS4Stick stick, u8 value) noexcept {
+  return this->push(PS4Command{
+      .type = PS4CommandType::STICK,
+      .target = stick,
+      .value = value,
+  });
+}
+
+template <typename Sink>
+bool BasicPS4CommandQueue<Sink>::move_stickf(
+    PS4Stick stick, f32 value
+) noexcept {
+  // Same conversion as BasicGamepad::move_stickf, clamped before the cast
+  const AxisRange& range = PS4Profile::STICKS[PS4State::stick_index(stick)];
+  f32 position = std::clamp(value, 0.0F, 1.0F);
+  return this->move_stick(
+      stick, static_cast<u8>(
+                 range.min +
+                 static_cast<i32>((range.max - range.min) * position)
+             )
+  );
+}
+
+template <typename Sink>
+bool BasicPS4CommandQueue<Sink>::set_dpad(PS4DPad dpad, i8 value) noexcept {
+  return this->push(PS4Command{
+      .type = PS4CommandType::DPAD,
+      .target = dpad,
+      .value = std::clamp<i8>(value, -1, 1),
+  });
+}
+
+template <typename Sink>
+bool BasicPS4CommandQueue<Sink>::push(const PS4Command& command) noexcept {
+  if (this->commands.push(command)) {
+    return true;
+  }
+
+  this->dropped.fetch_add(1U, std::memory_order_relaxed);
+  return false;
+}
+
+template <typename Sink>
+usize BasicPS4CommandQueue<Sink>::drain(BasicPS4Controller<Sink>& controller
+) noexcept {
+  PS4State state = controller.get_state();
+  u32 touched = 0U;
+  usize count = 0U;
+
+  if (this->has_carry) {
+    (void)fold(state, this->carry, touched);
+    this->has_carry = false;
+    ++count;
+  }
+
+  PS4Command command{};
+  while (this->commands.pop(command)) {
+    if (!fold(state, command, touched)) {
+      // Shown on the next tick so the change of this one is not lost
+      this->carry = command;
+      this->has_carry = true;
+      break;
+    }
+    ++count;
+  }
+
+  controller.apply(state);
+  return count;
+}
+
+template <typename Sink>
+error_code BasicPS4CommandQueue<Sink>::start(
+    BasicPS4Controller<Sink>& controller, u32 hz
+) noexcept {
+  if (hz == 0U || hz > 1000U) {
+    return error::SCHEDULER_RATE;
+  }
+
+  this->stop();
+  this->controller = &controller;
+  this->running.store(true);
+  this->thread = std::thread{[this, hz] { this->run(hz); }};
+  return error::OK;
+}
+
+template <typename Sink> void BasicPS4CommandQueue<Sink>::stop() noexcept {
+  if (!this->thread.joinable()) {
+    return;
+  }
+
+  this->running.store(false);
+  this->thread.join();
+
+  // Anything pushed before stop still reaches the controller
+  while (this->drain(*this->controller) != 0U) {
+  }
+  this->controller = nullptr;
+}
+
+template <typename Sink>
+u64 BasicPS4CommandQueue<Sink>::get_dropped() const noexcept {
+  return this->dropped.load(std::memory_order_relaxed);
+}
+
+template <typename Sink>
+void BasicPS4CommandQueue<Sink>::run(u32 hz) noexcept {
+  FrameScheduler scheduler{};
+  // Rate was already checked by start
+  (void)scheduler.init(hz);
+  scheduler.start();
+
+  while (this->running.load(std::memory_order_relaxed)) {
+    this->drain(*this->controller);
+    scheduler.wait();
+  }
+}
+
+template class BasicPS4CommandQueue<uinput::UinputSink>;
+template class BasicPS4CommandQueue<uinput::NullSink>;
+template class BasicPS4CommandQueue<uinput::RingSink>;
+template class BasicPS4CommandQueue<uinput::FileSink>;
+
+} // namespace vc
@@ -0,0 +1,112 @@
+#ifndef VC_CONTROLLER_COMMAND_QUEUE_HPP
+#define VC_CONTROLLER_COMMAND_QUEUE_HPP
+
+#include "../queue/mpsc.hpp"
+#include "../types.hpp"
+#include "./ps4.hpp"
+#include <atomic>
+#include <thread>
+
+namespace vc {
+
+enum class PS4CommandType : u8 {
+  PRESS,
+  RELEASE,
+  STICK,
+  DPAD,
+};
+
+// Packed in 4 bytes, a slot of the ring is 16 with its sequence so a cache
+// line holds 4 of them
+struct PS4Command {
+  PS4CommandType type = PS4CommandType::PRESS;
+  // PS4Button, PS4Stick or PS4DPad depending on the type
+  u8 target = 0U;
+  i16 value = 0;
+};
+
+/**
+ * Lets several threads drive the same controller.
+ * Producers push commands from any thread without locks, a single emitter
+ * drains them every tick and folds them into one frame, so the controller
+ * itself is only ever touched by the emitter.
+ *
+ * A button that is pressed and released within the same tick would cancel
+ * out, so the command that undoes a change of the current tick is carried
+ * over to the next one instead. Sticks only keep their latest value.
+ *
+ * queue.start(controller, 250U);
+ * // from any thread
+ * (void)queue.press_button(PS4Button::CROSS);
+ *
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicPS4CommandQueue {
+public:
+  BasicPS4CommandQueue() noexcept = default;
+  BasicPS4CommandQueue(const BasicPS4CommandQueue&) = delete;
+  BasicPS4CommandQueue& operator=(const BasicPS4CommandQueue&) = delete;
+  BasicPS4CommandQueue(BasicPS4CommandQueue&&) = delete;
+  BasicPS4CommandQueue& operator=(BasicPS4CommandQueue&&) = delete;
+
+  ~BasicPS4CommandQueue() noexcept;
+
+  // Producers, can be called from any thread. False if the queue is full
+
+  [[nodiscard]] bool press_button(PS4Button button) noexcept;
+  [[nodiscard]] bool release_button(PS4Button button) noexcept;
+  [[nodiscard]] bool move_stick(PS4Stick stick, u8 value = 0x7f) noexcept;
+  [[nodiscard]] bool move_stickf(PS4Stick stick, f32 value) noexcept;
+  // -1, 0 or 1 like the d-pad axes of the controller
+  [[nodiscard]] bool set_dpad(PS4DPad dpad, i8 value) noexcept;
+  [[nodiscard]] bool push(const PS4Command& command) noexcept;
+
+  // Consumer
+
+  /**
+   * Drains the queued commands into one frame of the controller. Only one
+   * thread may drain, use it instead of start to drive the controller from
+   * an existing loop
+   * @return number of commands applied
+   */
+  usize drain(BasicPS4Controller<Sink>& controller) noexcept;
+
+  /**
+   * Starts the emitter thread draining into the controller at a fixed rate.
+   * The controller needs to outlive the queue or the call to stop
+   * @param hz - ticks per second, [1, 1000]
+   */
+  [[nodiscard]] error_code
+  start(BasicPS4Controller<Sink>& controller, u32 hz) noexcept;
+  // Drains the remaining commands and joins the emitter thread
+  void stop() noexcept;
+
+  // Number of commands rejected because the queue was full
+  [[nodiscard]] u64 get_dropped() const noexcept;
+
+private:
+  static constexpr usize QUEUE_CAPACITY = 4096U;
+
+  MpscRing<PS4Command, QUEUE_CAPACITY> commands{};
+  // Written by the producers, kept away from the consumer state
+  alignas(64) std::atomic<u64> dropped{0U};
+
+  alignas(64) std::atomic<bool> running{false};
+  PS4Command carry{};
+  bool has_carry = false;
+  BasicPS4Controller<Sink>* controller = nullptr;
+  std::thread thread{};
+
+  void run(u32 hz) noexcept;
+};
+
+using PS4CommandQueue = BasicPS4CommandQueue<uinput::UinputSink>;
+
+extern template class BasicPS4CommandQueue<uinput::UinputSink>;
+extern template class BasicPS4CommandQueue<uinput::NullSink>;
+extern template class BasicPS4CommandQueue<uinput::RingSink>;
+extern template class BasicPS4CommandQueue<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
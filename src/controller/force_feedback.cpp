@@ -0,0 +1,162 @@
+#include "./force_feedback.hpp"
+#include <array>
+#include <linux/uinput.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace vc {
+
+ForceFeedback::~ForceFeedback() noexcept {
+  this->stop();
+}
+
+void ForceFeedback::set_callback(FFCallback callback, void* data) noexcept {
+  // The reader thread reads them without synchronization
+  if (this->thread.joinable()) {
+    return;
+  }
+  this->callback = callback;
+  this->data = data;
+}
+
+error_code ForceFeedback::start(i32 fd) noexcept {
+  if (this->thread.joinable()) {
+    return error::OK;
+  }
+
+  this->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (this->event_fd == -1) {
+    return error::WORKER_CREATE;
+  }
+
+  this->fd = fd;
+  this->thread = std::thread{[this] { this->run(); }};
+  return error::OK;
+}
+
+void ForceFeedback::stop() noexcept {
+  if (this->thread.joinable()) {
+    u64 one = 1U;
+    (void)write(this->event_fd, &one, sizeof(one));
+    this->thread.join();
+  }
+
+  if (this->event_fd != -1) {
+    close(this->event_fd);
+    this->event_fd = -1;
+  }
+  this->fd = -1;
+}
+
+bool ForceFeedback::poll(FFEvent& event) noexcept {
+  return this->events.pop(event);
+}
+
+u64 ForceFeedback::get_dropped() const noexcept {
+  return this->dropped.load(std::memory_order_relaxed);
+}
+
+void ForceFeedback::run() noexcept {
+  std::array<pollfd, 2> fds{
+      pollfd{.fd = this->fd, .events = POLLIN, .revents = 0},
+      pollfd{.fd = this->event_fd, .events = POLLIN, .revents = 0},
+  };
+  std::array<input_event, 16> buffer{};
+
+  while (true) {
+    if (::poll(fds.data(), fds.size(), -1) == -1) {
+      continue;
+    }
+
+    if (fds[1].revents != 0) {
+      return;
+    }
+
+    if ((fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+      return;
+    }
+
+    isize bytes = 0;
+    while ((bytes = read(
+                this->fd, buffer.data(), buffer.size() * sizeof(input_event)
+            )) > 0) {
+      usize count = bytes / sizeof(input_event);
+      for (usize i = 0U; i < count; ++i) {
+        this->handle_event(buffer[i]);
+      }
+    }
+  }
+}
+
+void ForceFeedback::handle_event(const input_event& event) noexcept {
+  if (event.type == EV_FF) {
+    if (event.code == FF_GAIN) {
+      this->publish(FFEvent{
+          .type = FFEventType::GAIN,
+          .id = -1,
+          .value = event.value,
+          .effect = {},
+      });
+    } else {
+      this->publish(FFEvent{
+          .type = event.value > 0 ? FFEventType::PLAY : FFEventType::STOP,
+          .id = static_cast<i16>(event.code),
+          .value = event.value,
+          .effect = {},
+      });
+    }
+    return;
+  }
+
+  if (event.type != EV_UINPUT) {
+    return;
+  }
+
+  // The game is blocked until the END ioctl, acknowledge before publishing
+  if (event.code == UI_FF_UPLOAD) {
+    uinput_ff_upload upload{};
+    upload.request_id = event.value;
+    if (ioctl(this->fd, UI_BEGIN_FF_UPLOAD, &upload) == -1) {
+      return;
+    }
+    upload.retval = 0;
+    (void)ioctl(this->fd, UI_END_FF_UPLOAD, &upload);
+
+    this->publish(FFEvent{
+        .type = FFEventType::UPLOAD,
+        .id = upload.effect.id,
+        .value = 0,
+        .effect = upload.effect,
+    });
+  } else if (event.code == UI_FF_ERASE) {
+    uinput_ff_erase erase{};
+    erase.request_id = event.value;
+    if (ioctl(this->fd, UI_BEGIN_FF_ERASE, &erase) == -1) {
+      return;
+    }
+    erase.retval = 0;
+    (void)ioctl(this->fd, UI_END_FF_ERASE, &erase);
+
+    this->publish(FFEvent{
+        .type = FFEventType::ERASE,
+        .id = static_cast<i16>(erase.effect_id),
+        .value = 0,
+        .effect = {},
+    });
+  }
+}
+
+void ForceFeedback::publish(const FFEvent& event) noexcept {
+  if (this->callback != nullptr) {
+    this->callback(event, this->data);
+    return;
+  }
+
+  if (!this->events.push(event)) {
+    this->dropped.fetch_add(1U, std::memory_order_relaxed);
+  }
+}
+
+} // namespace vc
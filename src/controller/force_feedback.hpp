@@ -0,0 +1,94 @@
+#ifndef VC_CONTROLLER_FORCE_FEEDBACK_HPP
+#define VC_CONTROLLER_FORCE_FEEDBACK_HPP
+
+#include "../queue/spsc.hpp"
+#include "../types.hpp"
+#include <atomic>
+#include <linux/input.h>
+#include <thread>
+
+namespace vc {
+
+// Number of effects games can upload at once
+constexpr u32 FF_EFFECTS_MAX = 16U;
+
+enum class FFEventType : u8 {
+  // A game uploaded a new effect or updated an existing one
+  UPLOAD,
+  // A game removed an effect, the id can be reused afterwards
+  ERASE,
+  // value is the number of times the effect should be played
+  PLAY,
+  STOP,
+  // value is the new gain, [0, 0xffff]
+  GAIN,
+};
+
+struct FFEvent {
+  FFEventType type;
+  i16 id;
+  i32 value;
+  // Only set for UPLOAD
+  ff_effect effect;
+};
+
+using FFCallback = void (*)(const FFEvent& event, void* data);
+
+/**
+ * Answers the force feedback requests of a uinput device on its own thread.
+ * Uploads of games block in the kernel until they are acknowledged, so they
+ * are accepted right away and the effect is handed over afterwards. The
+ * emitting thread is never involved, writes to the same fd don't wait for
+ * the reader.
+ *
+ * Effects are received either through poll() or a callback, the callback
+ * runs on the reader thread and needs to be quick.
+ */
+class ForceFeedback {
+public:
+  ForceFeedback() noexcept = default;
+  ForceFeedback(const ForceFeedback&) = delete;
+  ForceFeedback& operator=(const ForceFeedback&) = delete;
+  ForceFeedback(ForceFeedback&&) = delete;
+  ForceFeedback& operator=(ForceFeedback&&) = delete;
+
+  ~ForceFeedback() noexcept;
+
+  // Ignored once started, nullptr to use poll() instead. Gamepads start it
+  // in init, see BasicGamepad::set_ff_callback
+  void set_callback(FFCallback callback, void* data) noexcept;
+
+  /**
+   * Starts reading the requests of the device
+   * @param fd - uinput fd opened read/write and non blocking, not owned
+   */
+  [[nodiscard]] error_code start(i32 fd) noexcept;
+  void stop() noexcept;
+
+  // Returns false if there are no events left
+  [[nodiscard]] bool poll(FFEvent& event) noexcept;
+
+  // Number of events lost because poll() was not called often enough
+  [[nodiscard]] u64 get_dropped() const noexcept;
+
+private:
+  static constexpr usize QUEUE_CAPACITY = 256U;
+
+  SpscRing<FFEvent, QUEUE_CAPACITY> events{};
+  std::atomic<u64> dropped{0U};
+
+  FFCallback callback = nullptr;
+  void* data = nullptr;
+
+  i32 fd = -1;
+  i32 event_fd = -1;
+  std::thread thread{};
+
+  void run() noexcept;
+  void handle_event(const input_event& event) noexcept;
+  void publish(const FFEvent& event) noexcept;
+};
+
+} // namespace vc
+
+#endif
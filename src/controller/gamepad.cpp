@@ -0,0 +1,496 @@
+#include "./gamepad.hpp"
+#include "../helper.hpp"
+#include "../record/recorder.hpp"
+#include "./ps4.hpp"
+#include "./xbox.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/input-event-codes.h>
+#include <linux/uinput.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+namespace vc {
+
+namespace {
+
+[[nodiscard]] uinput_abs_setup to_abs_setup(const AxisRange& range) noexcept {
+  return uinput_abs_setup{
+      .code = range.code,
+      .absinfo =
+          {
+              .value = range.neutral,
+              .minimum = range.min,
+              .maximum = range.max,
+              .fuzz = 0,
+              .flat = 0,
+              .resolution = 0,
+          },
+  };
+}
+
+} // namespace
+
+template <typename Profile, typename Sink>
+BasicGamepad<Profile, Sink>::BasicGamepad(BasicGamepad&& other) noexcept
+    : sink(std::move(other.sink)),
+      immediate(other.immediate),
+      frame(other.frame),
+      mapping(other.mapping),
+      state(other.state),
+      committed(other.committed),
+      backpressure(other.backpressure),
+      recorder(other.recorder),
+      device(other.device),
+      stats(other.stats),
+      ff_callback(other.ff_callback),
+      ff_data(other.ff_data),
+      force_feedback(std::move(other.force_feedback)),
+      motion_sensors(std::move(other.motion_sensors)) {
+  other.frame.clear();
+}
+
+template <typename Profile, typename Sink>
+BasicGamepad<Profile, Sink>&
+BasicGamepad<Profile, Sink>::operator=(BasicGamepad&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  // Stops the reader of the current device before its fd is replaced
+  this->force_feedback = std::move(rhs.force_feedback);
+  this->motion_sensors = std::move(rhs.motion_sensors);
+  this->sink = std::move(rhs.sink);
+  this->immediate = rhs.immediate;
+  this->frame = rhs.frame;
+  this->mapping = rhs.mapping;
+  this->state = rhs.state;
+  this->committed = rhs.committed;
+  this->backpressure = rhs.backpressure;
+  this->recorder = rhs.recorder;
+  this->device = rhs.device;
+  this->stats = rhs.stats;
+  this->ff_callback = rhs.ff_callback;
+  this->ff_data = rhs.ff_data;
+  rhs.frame.clear();
+
+  return *this;
+}
+
+template <typename Profile, typename Sink>
+error_code BasicGamepad<Profile, Sink>::init(
+    const c8* name, bool is_pro, bool force_feedback, bool motion_sensors
+) noexcept {
+  TRY_CODE(this->sink.open());
+
+  // Setup the buttons
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_KEY));
+  for (const auto& code : this->mapping) {
+    TRY_CODE(this->sink.enable(UI_SET_KEYBIT, code));
+  }
+
+  // Setup the sticks and d-pads along with their limits
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_ABS));
+  for (const auto& range : Profile::STICKS) {
+    TRY_CODE(this->sink.enable(UI_SET_ABSBIT, range.code));
+    TRY_CODE(this->sink.setup_abs(to_abs_setup(range)));
+  }
+  for (const auto& range : Profile::HATS) {
+    TRY_CODE(this->sink.enable(UI_SET_ABSBIT, range.code));
+    TRY_CODE(this->sink.setup_abs(to_abs_setup(range)));
+  }
+
+  uinput_setup setup{
+      .id =
+          {
+              .bustype = BUS_USB,
+              .vendor = Profile::VENDOR,
+              .product = is_pro ? Profile::PRO_PRODUCT : Profile::PRODUCT,
+              .version = 1,
+          },
+      .name = {},
+      .ff_effects_max = 0U,
+  };
+  std::strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1U);
+
+  if (force_feedback) {
+    TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_FF));
+    for (const auto& effect : Profile::FF_EFFECTS) {
+      TRY_CODE(this->sink.enable(UI_SET_FFBIT, effect));
+    }
+    setup.ff_effects_max = FF_EFFECTS_MAX;
+  }
+
+  TRY_CODE(this->sink.create(setup));
+
+  if (force_feedback) {
+    this->force_feedback = std::make_unique<ForceFeedback>();
+    this->force_feedback->set_callback(this->ff_callback, this->ff_data);
+    // Only real devices receive requests
+    if constexpr (std::is_same_v<Sink, uinput::UinputSink>) {
+      TRY_CODE(this->force_feedback->start(this->sink.get_fd()));
+    }
+  }
+
+  if (motion_sensors) {
+    this->motion_sensors = std::make_unique<BasicMotionSensor<Sink>>();
+    auto& sensors = *this->motion_sensors;
+    TRY_CODE(sensors.init(name, setup.id.vendor, setup.id.product));
+  }
+
+  // Initialize sticks to neutral position
+  for (usize i = 0U; i < Profile::STICKS.size(); ++i) {
+    this->handle_analog(Profile::STICKS[i].code, this->state.sticks[i]);
+  }
+
+  return error::OK;
+}
+
+template <typename Profile, typename Sink>
+error_code BasicGamepad<Profile, Sink>::wait_ready(i32 timeout_ms) noexcept {
+  // Both nodes were created by init, so they come up in parallel
+  TRY_CODE(this->sink.wait_ready(timeout_ms));
+  if (this->motion_sensors) {
+    TRY_CODE(this->motion_sensors->wait_ready(timeout_ms));
+  }
+  return error::OK;
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::sync() noexcept {
+  this->stats.record_frame();
+  this->queue_event(EV_SYN, SYN_REPORT, 0);
+  if (this->flush_frame() == uinput::FlushResult::WRITTEN) {
+    this->committed = this->state;
+  }
+}
+
+template <typename Profile, typename Sink>
+bool BasicGamepad<Profile, Sink>::has_pending() const noexcept {
+  return !this->frame.empty();
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::apply(const State& state) noexcept {
+  if (this->state == state && this->frame.empty()) {
+    return;
+  }
+
+  u64 changed = this->state.buttons ^ state.buttons;
+  while (changed != 0U) {
+    auto button = static_cast<Button>(__builtin_ctzll(changed));
+    changed &= changed - 1U;
+    this->handle_button(this->mapping[button], state.is_button_pressed(button));
+  }
+
+  // Codes are known at compile time, these unroll into plain compares
+  for (usize i = 0U; i < Profile::STICKS.size(); ++i) {
+    if (this->state.sticks[i] != state.sticks[i]) {
+      this->handle_analog(Profile::STICKS[i].code, state.sticks[i]);
+    }
+  }
+
+  for (usize i = 0U; i < Profile::HATS.size(); ++i) {
+    if (this->state.hats[i] != state.hats[i]) {
+      this->handle_analog(Profile::HATS[i].code, state.hats[i]);
+    }
+  }
+
+  this->state = state;
+  this->sync();
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::set_immediate(bool immediate) noexcept {
+  // Don't leave events of the previous mode behind
+  this->flush_frame();
+  this->immediate = immediate;
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::set_backpressure(
+    const uinput::BackpressurePolicy& policy
+) noexcept {
+  this->backpressure = policy;
+  this->stats.set_policy(policy.mode);
+}
+
+template <typename Profile, typename Sink>
+const uinput::BackpressurePolicy&
+BasicGamepad<Profile, Sink>::get_backpressure() const noexcept {
+  return this->backpressure;
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::remap(Button button, u16 code) noexcept {
+  this->mapping[button] = code;
+}
+
+template <typename Profile, typename Sink>
+u16 BasicGamepad<Profile, Sink>::get_mapping(Button button) const noexcept {
+  return this->mapping[button];
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::press_button(Button button) noexcept {
+  if (this->state.is_button_pressed(button)) {
+    return;
+  }
+
+  this->state.set_button(button, true);
+  this->handle_button(this->mapping[button], true);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::release_button(Button button) noexcept {
+  if (!this->state.is_button_pressed(button)) {
+    return;
+  }
+
+  this->state.set_button(button, false);
+  this->handle_button(this->mapping[button], false);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::set_dpad(Hat hat, i8 value) noexcept {
+  if (this->state.get_dpad(hat) == value) {
+    return;
+  }
+
+  this->state.set_dpad(hat, value);
+  this->handle_analog(hat, value);
+}
+
+// The first two hats of a profile are the X and Y of its d-pad
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::press_up() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[1].code), -1);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::press_down() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[1].code), 1);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::press_left() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[0].code), -1);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::press_right() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[0].code), 1);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::release_up() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[1].code), 0);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::release_down() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[1].code), 0);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::release_left() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[0].code), 0);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::release_right() noexcept {
+  this->set_dpad(static_cast<Hat>(Profile::HATS[0].code), 0);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::move_stick(Stick stick, Axis value) noexcept {
+  if (this->state.get_stick(stick) == value) {
+    return;
+  }
+
+  this->state.set_stick(stick, value);
+  this->handle_analog(stick, value);
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::move_stick(Stick stick) noexcept {
+  const AxisRange& range = Profile::STICKS[State::stick_index(stick)];
+  this->move_stick(stick, static_cast<Axis>(range.neutral));
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::move_stickf(Stick stick, f32 value) noexcept {
+  const AxisRange& range = Profile::STICKS[State::stick_index(stick)];
+  this->move_stick(
+      stick, static_cast<Axis>(std::clamp(
+                 range.min + static_cast<i32>((range.max - range.min) * value),
+                 range.min, range.max
+             ))
+  );
+}
+
+template <typename Profile, typename Sink>
+bool BasicGamepad<Profile, Sink>::is_button_pressed(Button button
+) const noexcept {
+  return this->state.is_button_pressed(button);
+}
+
+template <typename Profile, typename Sink>
+typename BasicGamepad<Profile, Sink>::Axis
+BasicGamepad<Profile, Sink>::get_stick(Stick stick) const noexcept {
+  return this->state.get_stick(stick);
+}
+
+// TODO: Check if fast division is needed
+template <typename Profile, typename Sink>
+f32 BasicGamepad<Profile, Sink>::get_stick_f32(Stick stick) const noexcept {
+  const AxisRange& range = Profile::STICKS[State::stick_index(stick)];
+  return static_cast<f32>(this->state.get_stick(stick) - range.min) /
+         static_cast<f32>(range.max - range.min);
+}
+
+template <typename Profile, typename Sink>
+u8 BasicGamepad<Profile, Sink>::get_stick_u8(Stick stick) const noexcept {
+  if constexpr (std::is_same_v<Axis, u8>) {
+    return this->state.get_stick(stick);
+  } else {
+    return static_cast<u8>(std::lround(this->get_stick_f32(stick) * 255.0F));
+  }
+}
+
+template <typename Profile, typename Sink>
+i8 BasicGamepad<Profile, Sink>::get_dpad(Hat hat) const noexcept {
+  return this->state.get_dpad(hat);
+}
+
+template <typename Profile, typename Sink>
+const typename BasicGamepad<Profile, Sink>::State&
+BasicGamepad<Profile, Sink>::get_state() const noexcept {
+  return this->state;
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::print() const noexcept {
+  printf("Buttons: 0x%lx ; Sticks:", static_cast<u64>(this->state.buttons));
+  for (const auto& range : Profile::STICKS) {
+    printf(" %.06f", this->get_stick_f32(static_cast<Stick>(range.code)));
+  }
+  printf(" ; DPad:");
+  for (const auto& hat : this->state.hats) {
+    printf(" %d", hat);
+  }
+  printf("\n");
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::queue_event(
+    u16 type, u16 code, i32 value
+) noexcept {
+  if (!this->frame.push(type, code, value)) {
+    // Frame is full, evdev readers still only see it after the SYN_REPORT
+    this->flush_frame();
+    (void)this->frame.push(type, code, value);
+  }
+
+  if (this->immediate) {
+    this->flush_frame();
+  }
+}
+
+template <typename Profile, typename Sink>
+uinput::FlushResult BasicGamepad<Profile, Sink>::flush_frame() noexcept {
+  uinput::FlushResult result{};
+  if (this->recorder == nullptr) {
+    result = this->frame.flush(this->sink, this->stats, this->backpressure);
+  } else {
+    // Only what the sink took is recorded, carried events with the frame
+    // writing them. The flush moves those over the sent ones, hence the copy
+    auto sent = this->frame;
+    result = this->frame.flush(this->sink, this->stats, this->backpressure);
+    if (this->frame.get_written() != 0U) {
+      this->recorder->record(
+          this->device, sent.data(), this->frame.get_written()
+      );
+    }
+  }
+  if (result == uinput::FlushResult::DROPPED) {
+    // Readers never saw the frame, the next changes are diffed against this
+    this->state = this->committed;
+  }
+  return result;
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::set_recorder(
+    Recorder* recorder, u8 device
+) noexcept {
+  this->recorder = recorder;
+  this->device = device;
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::handle_button(
+    u16 button, bool press
+) noexcept {
+  this->queue_event(EV_KEY, button, press); // 1 for press, 0 for release
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::handle_analog(u16 type, i32 value) noexcept {
+  this->queue_event(EV_ABS, type, value);
+}
+
+template <typename Profile, typename Sink>
+uinput::StatsSnapshot BasicGamepad<Profile, Sink>::get_stats() const noexcept {
+  return this->stats.snapshot();
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::reset_stats() noexcept {
+  this->stats.reset();
+}
+
+template <typename Profile, typename Sink>
+void BasicGamepad<Profile, Sink>::set_ff_callback(
+    FFCallback callback, void* data
+) noexcept {
+  this->ff_callback = callback;
+  this->ff_data = data;
+}
+
+template <typename Profile, typename Sink>
+ForceFeedback* BasicGamepad<Profile, Sink>::get_force_feedback() noexcept {
+  return this->force_feedback.get();
+}
+
+template <typename Profile, typename Sink>
+BasicMotionSensor<Sink>*
+BasicGamepad<Profile, Sink>::get_motion_sensors() noexcept {
+  return this->motion_sensors.get();
+}
+
+template <typename Profile, typename Sink>
+Sink& BasicGamepad<Profile, Sink>::get_sink() noexcept {
+  return this->sink;
+}
+
+template <typename Profile, typename Sink>
+const Sink& BasicGamepad<Profile, Sink>::get_sink() const noexcept {
+  return this->sink;
+}
+
+template class BasicGamepad<PS4Profile, uinput::UinputSink>;
+template class BasicGamepad<PS4Profile, uinput::NullSink>;
+template class BasicGamepad<PS4Profile, uinput::RingSink>;
+template class BasicGamepad<PS4Profile, uinput::FileSink>;
+
+template class BasicGamepad<XboxProfile, uinput::UinputSink>;
+template class BasicGamepad<XboxProfile, uinput::NullSink>;
+template class BasicGamepad<XboxProfile, uinput::RingSink>;
+template class BasicGamepad<XboxProfile, uinput::FileSink>;
+
+} // namespace vc
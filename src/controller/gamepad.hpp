@@ -0,0 +1,211 @@
+#ifndef VC_CONTROLLER_GAMEPAD_HPP
+#define VC_CONTROLLER_GAMEPAD_HPP
+
+#include "../types.hpp"
+#include "../uinput/frame.hpp"
+#include "../uinput/sink.hpp"
+#include "../uinput/stats.hpp"
+#include "./force_feedback.hpp"
+#include "./motion_sensor.hpp"
+#include "./profile.hpp"
+#include <array>
+#include <memory>
+
+namespace vc {
+
+class Recorder;
+
+/**
+ * Gamepad generated from a device profile, see profile.hpp.
+ * Sink is where the events are written to, see uinput/sink.hpp.
+ * Instantiated for all profiles and sinks in gamepad.cpp
+ */
+template <typename Profile, typename Sink> class BasicGamepad {
+public:
+  using State = PadState<Profile>;
+  using Button = typename State::Button;
+  using Stick = typename State::Stick;
+  using Hat = typename State::Hat;
+  using Axis = typename State::Axis;
+
+  BasicGamepad() noexcept = default;
+  BasicGamepad(const BasicGamepad&) = delete;
+  BasicGamepad& operator=(const BasicGamepad&) = delete;
+
+  BasicGamepad(BasicGamepad&& other) noexcept;
+  BasicGamepad& operator=(BasicGamepad&& rhs) noexcept;
+
+  ~BasicGamepad() noexcept = default;
+
+  /**
+   * @param is_pro - uses the PRO_PRODUCT id of the profile
+   * @param force_feedback - advertises the effects of the profile and
+   *   answers the uploads of games on a reader thread, see get_force_feedback
+   * @param motion_sensors - also creates the motion sensor node of the pad,
+   *   named "<name> Motion Sensors", see get_motion_sensors
+   */
+  [[nodiscard]] error_code init(
+      const c8* name, bool is_pro, bool force_feedback = false,
+      bool motion_sensors = false
+  ) noexcept;
+
+  /**
+   * Blocks until games can open the device, instead of sleeping after init.
+   * Init every device first then wait on them to bring them up in parallel
+   */
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+
+  /**
+   * Needs to be called everytime an action is called.
+   * Writes every buffered event of the frame along with the SYN_REPORT in a
+   * single syscall
+   */
+  void sync() noexcept;
+
+  // Whether there are events waiting for a sync
+  [[nodiscard]] bool has_pending() const noexcept;
+
+  /**
+   * Emits only the codes that differ from the current state then syncs.
+   * Nothing is written if there is no change and no pending event.
+   * Useful for callers that send their whole desired state every tick
+   */
+  void apply(const State& state) noexcept;
+
+  /**
+   * Immediate mode writes every event as soon as it is called (one syscall
+   * per event) instead of buffering them until the next sync
+   */
+  void set_immediate(bool immediate) noexcept;
+
+  /**
+   * What sync does when the device doesn't take a frame in time, see
+   * uinput/backpressure.hpp. Frames are coalesced by default, a dropped
+   * frame rolls the state back to the last frame that was written
+   */
+  void set_backpressure(const uinput::BackpressurePolicy& policy) noexcept;
+  [[nodiscard]] const uinput::BackpressurePolicy&
+  get_backpressure() const noexcept;
+
+  void remap(Button button, u16 code) noexcept;
+  [[nodiscard]] u16 get_mapping(Button button) const noexcept;
+
+  // Call sync to register the button press, no-op if already pressed
+  void press_button(Button button) noexcept;
+  // Call sync to register the button release, no-op if already released
+  void release_button(Button button) noexcept;
+
+  // Call sync to register the d-pad change, value is -1, 0 or 1
+  void set_dpad(Hat hat, i8 value) noexcept;
+
+  // Shorthands for the first d-pad of the profile
+
+  // Call sync to register the button press
+  void press_up() noexcept;
+  // Call sync to register the button press
+  void press_down() noexcept;
+  // Call sync to register the button press
+  void press_left() noexcept;
+  // Call sync to register the button press
+  void press_right() noexcept;
+
+  // Call sync to register the button release
+  void release_up() noexcept;
+  // Call sync to register the button release
+  void release_down() noexcept;
+  // Call sync to register the button release
+  void release_left() noexcept;
+  // Call sync to register the button release
+  void release_right() noexcept;
+
+  /**
+   * Call sync to register the move stick action
+   * @param stick
+   * @param value - within the range of the stick in the profile
+   */
+  void move_stick(Stick stick, Axis value) noexcept;
+
+  // Call sync to register the move stick action, back to its neutral value
+  void move_stick(Stick stick) noexcept;
+
+  /**
+   * Call sync to register the move stick action
+   * @param stick
+   * @param value - [0.0F, 1.0F] from the min to the max of the stick, will
+   *   clamp the value if it exceeds the value
+   */
+  void move_stickf(Stick stick, f32 value) noexcept;
+
+  [[nodiscard]] bool is_button_pressed(Button button) const noexcept;
+  [[nodiscard]] Axis get_stick(Stick stick) const noexcept;
+  // [0.0F, 1.0F] from the min to the max of the stick
+  [[nodiscard]] f32 get_stick_f32(Stick stick) const noexcept;
+  // [0x00, 0xff] from the min to the max of the stick, the value itself on
+  // sticks of 8 bits like the PS4 ones
+  [[nodiscard]] u8 get_stick_u8(Stick stick) const noexcept;
+  [[nodiscard]] i8 get_dpad(Hat hat) const noexcept;
+  // State after all the calls so far, including the ones not yet synced
+  [[nodiscard]] const State& get_state() const noexcept;
+
+  // Prints the button bits, the sticks as get_stick_f32 and the hats
+  void print() const noexcept;
+
+  /**
+   * Every frame written after this is also recorded, nullptr to stop.
+   * @param device - index written along the frames, used by the player to
+   *   route the frames back to the right device
+   */
+  void set_recorder(Recorder* recorder, u8 device) noexcept;
+
+  // Counters of the writes so far, can be called from any thread
+  [[nodiscard]] uinput::StatsSnapshot get_stats() const noexcept;
+  void reset_stats() noexcept;
+
+  /**
+   * Effects are handed to the callback instead of ForceFeedback::poll,
+   * needs to be called before init which starts the reader thread
+   */
+  void set_ff_callback(FFCallback callback, void* data) noexcept;
+  // nullptr if the gamepad was not initialized with force feedback
+  [[nodiscard]] ForceFeedback* get_force_feedback() noexcept;
+  // nullptr if the gamepad was not initialized with motion sensors
+  [[nodiscard]] BasicMotionSensor<Sink>* get_motion_sensors() noexcept;
+
+  // Sinks may need to be configured before init
+  [[nodiscard]] Sink& get_sink() noexcept;
+  [[nodiscard]] const Sink& get_sink() const noexcept;
+
+private:
+  static_assert(Profile::HATS.size() >= 2U, "Profiles need a d-pad");
+
+  Sink sink{};
+  bool immediate = false;
+  uinput::Frame<> frame{};
+
+  std::array<u16, Profile::BUTTONS.size()> mapping = Profile::BUTTONS;
+  State state{};
+  // State of the last frame the sink fully took
+  State committed{};
+  uinput::BackpressurePolicy backpressure{};
+
+  Recorder* recorder = nullptr;
+  u8 device = 0U;
+
+  uinput::DeviceStats stats{};
+
+  // Handed to the force feedback before its reader starts
+  FFCallback ff_callback = nullptr;
+  void* ff_data = nullptr;
+  // Declared after the sink so the reader stops before the fd is closed
+  std::unique_ptr<ForceFeedback> force_feedback{};
+  std::unique_ptr<BasicMotionSensor<Sink>> motion_sensors{};
+
+  void queue_event(u16 type, u16 code, i32 value) noexcept;
+  uinput::FlushResult flush_frame() noexcept;
+  void handle_button(u16 button, bool press) noexcept;
+  void handle_analog(u16 type, i32 value) noexcept;
+};
+
+} // namespace vc
+
+#endif
@@ -5,102 +5,568 @@
 
 #include "./keyboard.hpp"
 #include "../helper.hpp"
+#include "../record/recorder.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <utility>
 
 namespace vc {
 
-Keyboard::Keyboard(Keyboard&& other) noexcept : fd(other.fd) {
-  other.fd = -1;
+constexpr usize WORKER_QUEUE_CAPACITY = 1024;
+
+/**
+ * Single producer (the typing thread) single consumer (the worker thread)
+ * ring of frames sorted by their deadlines
+ */
+template <typename Sink> struct BasicKeyboard<Sink>::Worker {
+  // Holds a whole frame of the keyboard
+  struct TimedFrame {
+    i64 deadline;
+    usize count;
+    std::array<input_event, FRAME_CAPACITY> events;
+  };
+
+  std::array<TimedFrame, WORKER_QUEUE_CAPACITY> frames{};
+  std::atomic<u64> head{0U};
+  std::atomic<u64> tail{0U};
+  std::atomic<bool> running{true};
+  // Asks the worker, the only writer of the stats while it runs, to reset
+  std::atomic<bool> reset_stats{false};
+
+  // Only touched by the producer
+  i64 next_deadline = 0;
+
+  // Used by the waiters of fences and a producer waiting for space
+  mutable std::mutex mutex{};
+  mutable std::condition_variable written{};
+
+  i32 epoll_fd = -1;
+  i32 timer_fd = -1;
+  i32 event_fd = -1;
+  std::thread thread{};
+
+  Worker() noexcept = default;
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+  Worker(Worker&&) = delete;
+  Worker& operator=(Worker&&) = delete;
+
+  ~Worker() noexcept {
+    for (i32 fd : {this->epoll_fd, this->timer_fd, this->event_fd}) {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+  }
+
+  void wake() const noexcept {
+    u64 one = 1U;
+    (void)write(this->event_fd, &one, sizeof(one));
+  }
+};
+
+template <typename Sink>
+BasicKeyboard<Sink>::BasicKeyboard() noexcept = default;
+
+template <typename Sink>
+BasicKeyboard<Sink>::BasicKeyboard(BasicKeyboard&& other) noexcept {
+  other.stop_worker();
+
+  this->sink = std::move(other.sink);
+  this->delays = other.delays;
+  this->immediate = other.immediate;
+  this->frame = other.frame;
+  this->backpressure = other.backpressure;
+  this->key_map = other.key_map;
+  this->recorder = other.recorder;
+  this->device = other.device;
+  this->stats = other.stats;
+  other.frame.clear();
 }
 
-Keyboard& Keyboard::operator=(Keyboard&& rhs) noexcept {
+template <typename Sink>
+BasicKeyboard<Sink>& BasicKeyboard<Sink>::operator=(BasicKeyboard&& rhs
+) noexcept {
   if (this == &rhs) {
     return *this;
   }
 
-  this->fd = rhs.fd;
-  rhs.fd = -1;
+  this->stop_worker();
+  rhs.stop_worker();
+
+  this->sink = std::move(rhs.sink);
+  this->delays = rhs.delays;
+  this->immediate = rhs.immediate;
+  this->frame = rhs.frame;
+  this->backpressure = rhs.backpressure;
+  this->key_map = rhs.key_map;
+  this->recorder = rhs.recorder;
+  this->device = rhs.device;
+  this->stats = rhs.stats;
+  rhs.frame.clear();
 
   return *this;
 }
 
-Keyboard::~Keyboard() noexcept {
-  if (this->fd == -1) {
-    return;
-  }
-
-  ioctl(this->fd, UI_DEV_DESTROY);
-  close(this->fd);
-  this->fd = -1;
+template <typename Sink> BasicKeyboard<Sink>::~BasicKeyboard() noexcept {
+  this->stop_worker();
 }
 
-[[nodiscard]] error_code Keyboard::init() noexcept {
-  this->fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
-  if (this->fd == -1) {
-    return error::CONTROLLER_OPEN;
+template <typename Sink>
+error_code BasicKeyboard<Sink>::init() noexcept {
+  TRY_CODE(this->sink.open());
+
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_KEY));
+  for (int key = KEY_ESC; key <= KEY_KPDOT; ++key) {
+    TRY_CODE(this->sink.enable(UI_SET_KEYBIT, key));
   }
 
-  uinput_user_dev setup{
+  uinput_setup setup{
       .id =
           {
               .bustype = BUS_USB,
               .vendor = 0x1111,
               .product = 0x1111,
               .version = 1,
-          }
+          },
+      .name = "Simulated keyboard",
+      .ff_effects_max = 0U,
   };
-  std::strcpy(setup.name, "Simulated keyboard");
 
-  TRY_IOCTL(this->fd, UI_SET_EVBIT, EV_KEY);
-  for (int key = KEY_ESC; key <= KEY_KPDOT; ++key) {
-    TRY_IOCTL(this->fd, UI_SET_KEYBIT, key);
+  TRY_CODE(this->sink.create(setup));
+
+  return error::OK;
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::set_delay(u32 delay) noexcept {
+  this->delays = KeyboardTiming{
+      .modifier = delay,
+      .press = delay,
+      .release = delay,
+  };
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::set_timing(const KeyboardTiming& timing) noexcept {
+  this->delays = timing;
+}
+
+template <typename Sink>
+const KeyboardTiming& BasicKeyboard<Sink>::get_timing() const noexcept {
+  return this->delays;
+}
+
+template <typename Sink>
+error_code BasicKeyboard<Sink>::start_worker() noexcept {
+  if (this->worker) {
+    return error::OK;
   }
 
-  if (write(this->fd, &setup, sizeof(setup)) == -1) {
-    return error::CONTROLLER_CREATE;
+  auto worker = std::make_unique<Worker>();
+  worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  worker->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  worker->event_fd = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (worker->epoll_fd == -1 || worker->timer_fd == -1 ||
+      worker->event_fd == -1) {
+    return error::WORKER_CREATE;
   }
 
-  if (ioctl(this->fd, UI_DEV_CREATE) == -1) {
-    return error::CONTROLLER_CREATE;
+  for (i32 fd : {worker->timer_fd, worker->event_fd}) {
+    epoll_event event{.events = EPOLLIN, .data = {.fd = fd}};
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      return error::WORKER_CREATE;
+    }
   }
 
+  // Frames synced before the worker starts are written right away
+  this->flush_frame();
+
+  this->worker = std::move(worker);
+  this->worker->thread = std::thread([this] { this->run_worker(); });
   return error::OK;
 }
 
-void Keyboard::set_delay(u32 delay) noexcept {
-  this->delay = delay;
+template <typename Sink> void BasicKeyboard<Sink>::stop_worker() noexcept {
+  if (!this->worker) {
+    return;
+  }
+
+  this->worker->running.store(false);
+  this->worker->wake();
+  this->worker->thread.join();
+  this->worker.reset();
+}
+
+template <typename Sink> u64 BasicKeyboard<Sink>::fence() const noexcept {
+  return this->worker ? this->worker->head.load() : 0U;
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::wait(u64 ticket) const noexcept {
+  if (!this->worker) {
+    return;
+  }
+
+  std::unique_lock lock{this->worker->mutex};
+  this->worker->written.wait(lock, [this, ticket] {
+    return this->worker->tail.load() >= ticket;
+  });
+}
+
+template <typename Sink>
+bool BasicKeyboard<Sink>::is_done(u64 ticket) const noexcept {
+  return !this->worker || this->worker->tail.load() >= ticket;
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::set_immediate(bool immediate) noexcept {
+  this->flush_frame();
+  this->immediate = immediate;
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::set_backpressure(
+    const uinput::BackpressurePolicy& policy
+) noexcept {
+  // The worker reads the policy, only change it while it is stopped
+  this->backpressure = policy;
+  this->stats.set_policy(policy.mode);
+}
+
+template <typename Sink>
+const uinput::BackpressurePolicy&
+BasicKeyboard<Sink>::get_backpressure() const noexcept {
+  return this->backpressure;
 }
 
-void Keyboard::remap(u8 key, u16 code) noexcept {
+template <typename Sink>
+void BasicKeyboard<Sink>::remap(u8 key, u16 code) noexcept {
   assert(key < this->key_map.size());
   this->key_map[key] = code;
 }
 
-void Keyboard::key_press(c8 key) const noexcept {
-  if (key >= this->key_map.size()) {
+template <typename Sink>
+void BasicKeyboard<Sink>::key_press(c8 key) noexcept {
+  u16 code = this->get_code(key);
+  if (code == 0) {
     return;
   }
-  key = this->key_map[key];
-  if (key == 0) {
+
+  if (code & Modifiers::SHIFT) {
+    this->queue_event(EV_KEY, KEY_LEFTSHIFT, 1);
+    this->step(this->delays.modifier);
+  }
+
+  this->queue_event(EV_KEY, code & ~Modifiers::SHIFT, 1);
+  this->step(this->delays.press);
+
+  if (code & Modifiers::SHIFT) {
+    this->queue_event(EV_KEY, KEY_LEFTSHIFT, 0);
+  }
+  this->queue_event(EV_KEY, code & ~Modifiers::SHIFT, 0);
+  this->step(this->delays.release);
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::type_string(std::string_view text) noexcept {
+  u16 held = 0U; // Key that is still pressed from the previous step
+  bool shift = false;
+
+  for (const c8 key : text) {
+    u16 code = this->get_code(key);
+    if (code == 0) {
+      continue;
+    }
+
+    u16 next = code & ~Modifiers::SHIFT;
+    bool next_shift = code & Modifiers::SHIFT;
+
+    // Pressing a key that is already down would not register
+    if (held == next) {
+      this->queue_event(EV_KEY, held, 0);
+      this->step(this->delays.release);
+      held = 0U;
+    }
+
+    if (held != 0U) {
+      this->queue_event(EV_KEY, held, 0);
+    }
+    if (shift != next_shift) {
+      this->queue_event(EV_KEY, KEY_LEFTSHIFT, next_shift);
+      shift = next_shift;
+    }
+    this->queue_event(EV_KEY, next, 1);
+    this->step(this->delays.press);
+    held = next;
+  }
+
+  if (held == 0U) {
     return;
   }
 
-  if (key & Modifiers::SHIFT) {
-    uinput::emit(this->fd, EV_KEY, KEY_LEFTSHIFT, 1);
-    uinput::emit(this->fd, EV_SYN, SYN_REPORT, 0);
-    usleep(this->delay);
+  this->queue_event(EV_KEY, held, 0);
+  if (shift) {
+    this->queue_event(EV_KEY, KEY_LEFTSHIFT, 0);
   }
+  this->step(this->delays.release);
+}
+
+template <typename Sink>
+u16 BasicKeyboard<Sink>::get_code(c8 key) const noexcept {
+  auto index = static_cast<u8>(key);
+  return index < this->key_map.size() ? this->key_map[index] : 0U;
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::queue_event(
+    u16 type, u16 code, i32 value
+) noexcept {
+  // Past the last free slot the events so far go out as their own write,
+  // the kernel still shows them with the SYN_REPORT that ends the frame
+  bool reserved = this->frame.size() + 1U >= FRAME_CAPACITY;
+  if (reserved && (type != EV_SYN || code != SYN_REPORT)) {
+    this->flush_frame();
+  }
+  (void)this->frame.push(type, code, value);
+
+  if (this->immediate && !this->worker) {
+    this->flush_frame();
+  }
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::flush_frame() noexcept {
+  // The worker is the only one writing to the sink while it runs
+  if (this->worker) {
+    this->enqueue(0U);
+    return;
+  }
+
+  if (this->recorder == nullptr) {
+    (void)this->frame.flush(this->sink, this->stats, this->backpressure);
+    return;
+  }
+
+  // Same as the gamepad, only the events the sink took are recorded
+  auto sent = this->frame;
+  (void)this->frame.flush(this->sink, this->stats, this->backpressure);
+  if (this->frame.get_written() != 0U) {
+    this->recorder->record(
+        this->device, sent.data(), this->frame.get_written()
+    );
+  }
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::set_recorder(
+    Recorder* recorder, u8 device
+) noexcept {
+  this->recorder = recorder;
+  this->device = device;
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::press_key(u16 code) noexcept {
+  this->queue_event(EV_KEY, code, 1);
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::release_key(u16 code) noexcept {
+  this->queue_event(EV_KEY, code, 0);
+}
+
+template <typename Sink>
+void BasicKeyboard<Sink>::sync() noexcept {
+  // The worker counts the frames it writes
+  if (!this->worker) {
+    this->stats.record_frame();
+  }
+  this->queue_event(EV_SYN, SYN_REPORT, 0);
+  this->flush_frame();
+}
 
-  uinput::emit(this->fd, EV_KEY, key & ~Modifiers::SHIFT, 1);
-  uinput::emit(this->fd, EV_SYN, SYN_REPORT, 0);
-  usleep(this->delay);
+template <typename Sink>
+bool BasicKeyboard<Sink>::has_pending() const noexcept {
+  return !this->frame.empty();
+}
 
-  if (key & Modifiers::SHIFT) {
-    uinput::emit(this->fd, EV_KEY, KEY_LEFTSHIFT, 0);
+template <typename Sink>
+void BasicKeyboard<Sink>::step(u32 delay) noexcept {
+  if (!this->worker) {
+    this->sync();
+    if (delay != 0U) {
+      usleep(delay);
+    }
+    return;
   }
-  uinput::emit(this->fd, EV_KEY, key & ~Modifiers::SHIFT, 0);
-  uinput::emit(this->fd, EV_SYN, SYN_REPORT, 0);
-  usleep(this->delay);
+
+  (void)this->frame.push(EV_SYN, SYN_REPORT, 0);
+  this->enqueue(delay);
 }
 
+template <typename Sink>
+void BasicKeyboard<Sink>::enqueue(u32 delay) noexcept {
+  if (this->frame.empty()) {
+    return;
+  }
+
+  Worker& worker = *this->worker;
+  u64 head = worker.head.load(std::memory_order_relaxed);
+  if (head - worker.tail.load() == WORKER_QUEUE_CAPACITY) {
+    std::unique_lock lock{worker.mutex};
+    worker.written.wait(lock, [&worker, head] {
+      return head - worker.tail.load() < WORKER_QUEUE_CAPACITY;
+    });
+  }
+
+  auto& timed = worker.frames[head % WORKER_QUEUE_CAPACITY];
+  timed.deadline = std::max(timing::now_ns(), worker.next_deadline);
+  timed.count = this->frame.size();
+  std::copy_n(this->frame.data(), timed.count, timed.events.begin());
+  this->frame.clear();
+  // Recorded here since the recorder belongs to this thread, stamped with
+  // the time the worker writes the frame at
+  if (this->recorder != nullptr) {
+    this->recorder->record(
+        this->device, timed.deadline, timed.events.data(), timed.count
+    );
+  }
+  worker.next_deadline = timed.deadline + delay * timing::NS_PER_US;
+
+  worker.head.store(head + 1U);
+  // The worker only sleeps without a timer when the queue is empty
+  if (worker.tail.load() == head) {
+    worker.wake();
+  }
+}
+
+template <typename Sink>
+error_code BasicKeyboard<Sink>::wait_ready(i32 timeout_ms) noexcept {
+  return this->sink.wait_ready(timeout_ms);
+}
+
+template <typename Sink> void BasicKeyboard<Sink>::run_worker() noexcept {
+  Worker& worker = *this->worker;
+  std::array<epoll_event, 2> events{};
+  u64 buffer = 0U;
+  // Holds the events a flush carried until the next frame
+  uinput::Frame<FRAME_CAPACITY * 2U> pending{};
+  auto push = [this, &pending](u16 type, u16 code, i32 value) {
+    if (pending.push(type, code, value)) {
+      return;
+    }
+    // Carried codes filled it, finish them whatever the policy so the rest
+    // of the frame and its SYN_REPORT still fit
+    (void)pending.flush(
+        this->sink, this->stats,
+        uinput::BackpressurePolicy{.mode = uinput::Backpressure::BLOCK}
+    );
+    if (!pending.push(type, code, value)) {
+      // Sinks without an fd to wait on may still hold them
+      this->stats.record_drop();
+      pending.clear();
+      (void)pending.push(type, code, value);
+    }
+  };
+
+  while (true) {
+    i32 count = epoll_wait(worker.epoll_fd, events.data(), events.size(), -1);
+    for (i32 i = 0; i < count; ++i) {
+      // Both are counters that only need to be drained
+      (void)read(events[i].data.fd, &buffer, sizeof(buffer));
+    }
+
+    if (worker.reset_stats.exchange(false)) {
+      this->stats.reset();
+    }
+
+    u64 tail = worker.tail.load(std::memory_order_relaxed);
+    bool stopping = !worker.running.load();
+    i64 now = timing::now_ns();
+    while (tail != worker.head.load()) {
+      const auto& timed = worker.frames[tail % WORKER_QUEUE_CAPACITY];
+      if (timed.deadline > now && !stopping) {
+        break;
+      }
+      // Events past the capacity of a frame come without a SYN_REPORT
+      const auto& last = timed.events[timed.count - 1U];
+      if (last.type == EV_SYN && last.code == SYN_REPORT) {
+        this->stats.record_frame();
+      }
+      for (usize i = 0U; i < timed.count; ++i) {
+        const auto& event = timed.events[i];
+        push(event.type, event.code, event.value);
+      }
+      (void)pending.flush(this->sink, this->stats, this->backpressure);
+      ++tail;
+    }
+
+    if (tail != worker.tail.load(std::memory_order_relaxed)) {
+      std::lock_guard lock{worker.mutex};
+      worker.tail.store(tail);
+      worker.written.notify_all();
+    }
+
+    if (stopping) {
+      // Nothing follows to carry the rest, finish it whatever the policy
+      if (!pending.empty()) {
+        push(EV_SYN, SYN_REPORT, 0);
+        (void)pending.flush(
+            this->sink, this->stats,
+            uinput::BackpressurePolicy{.mode = uinput::Backpressure::BLOCK}
+        );
+      }
+      return;
+    }
+
+    if (tail != worker.head.load()) {
+      itimerspec timer{
+          .it_interval = {},
+          .it_value = timing::to_timespec(
+              worker.frames[tail % WORKER_QUEUE_CAPACITY].deadline
+          ),
+      };
+      timerfd_settime(worker.timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr);
+    }
+  }
+}
+
+template <typename Sink>
+uinput::StatsSnapshot BasicKeyboard<Sink>::get_stats() const noexcept {
+  return this->stats.snapshot();
+}
+
+template <typename Sink> void BasicKeyboard<Sink>::reset_stats() noexcept {
+  if (!this->worker) {
+    this->stats.reset();
+    return;
+  }
+
+  this->worker->reset_stats.store(true);
+  this->worker->wake();
+}
+
+template <typename Sink> Sink& BasicKeyboard<Sink>::get_sink() noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+const Sink& BasicKeyboard<Sink>::get_sink() const noexcept {
+  return this->sink;
+}
+
+template class BasicKeyboard<uinput::UinputSink>;
+template class BasicKeyboard<uinput::NullSink>;
+template class BasicKeyboard<uinput::RingSink>;
+template class BasicKeyboard<uinput::FileSink>;
+
 } // namespace vc
@@ -7,16 +7,23 @@
 #define KP_KEYBOARD_HPP
 
 #include "../types.hpp"
+#include "../uinput/frame.hpp"
+#include "../uinput/sink.hpp"
+#include "../uinput/stats.hpp"
 #include <array>
 #include <cstring>
 #include <fcntl.h>
 #include <linux/input-event-codes.h>
 #include <linux/input.h>
 #include <linux/uinput.h>
+#include <memory>
+#include <string_view>
 #include <unistd.h>
 
 namespace vc {
 
+class Recorder;
+
 namespace Modifiers {
 enum Modifiers : u16 {
   SHIFT = 0x8000,
@@ -25,19 +32,71 @@ enum Modifiers : u16 {
 };
 } // namespace Modifiers
 
-class Keyboard {
+// Sleep after each kind of frame in us, the receiver needs time to see them
+struct KeyboardTiming {
+  // After a frame that only presses a modifier
+  u32 modifier = 1'000;
+  // After a frame that presses a key
+  u32 press = 1'000;
+  // After a frame that releases keys
+  u32 release = 1'000;
+};
+
+/**
+ * Sink is where the events are written to, see uinput/sink.hpp.
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicKeyboard {
 public:
-  Keyboard() noexcept = default;
-  Keyboard(const Keyboard&) noexcept = delete;
-  Keyboard& operator=(const Keyboard&) noexcept = delete;
+  BasicKeyboard() noexcept;
+  BasicKeyboard(const BasicKeyboard&) noexcept = delete;
+  BasicKeyboard& operator=(const BasicKeyboard&) noexcept = delete;
 
-  Keyboard(Keyboard&& other) noexcept;
-  Keyboard& operator=(Keyboard&& rhs) noexcept;
+  // Stops the worker of the moved keyboard, start it again after the move
+  BasicKeyboard(BasicKeyboard&& other) noexcept;
+  BasicKeyboard& operator=(BasicKeyboard&& rhs) noexcept;
 
-  ~Keyboard() noexcept;
+  ~BasicKeyboard() noexcept;
 
   [[nodiscard]] error_code init() noexcept;
+  // Blocks until readers can open the device, see UinputSink::wait_ready
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+  // Same delay for every kind of frame, in us
   void set_delay(u32 delay) noexcept;
+  // See calibration.hpp to measure them for the machine
+  void set_timing(const KeyboardTiming& timing) noexcept;
+  [[nodiscard]] const KeyboardTiming& get_timing() const noexcept;
+
+  /**
+   * Starts a thread that writes the frames at their deadlines, after this
+   * key_press and type_string queue their frames and return right away.
+   * Use fence and wait to know when the queued frames were written.
+   * Immediate mode is ignored while the worker runs
+   */
+  [[nodiscard]] error_code start_worker() noexcept;
+  // Writes the remaining queued frames then stops the thread
+  void stop_worker() noexcept;
+
+  // Ticket of the last queued frame
+  [[nodiscard]] u64 fence() const noexcept;
+  // Blocks until the frame of the ticket and every frame before it are written
+  void wait(u64 ticket) const noexcept;
+  [[nodiscard]] bool is_done(u64 ticket) const noexcept;
+
+  /**
+   * Immediate mode writes every event as soon as it is called (one syscall
+   * per event) instead of batching each step of a key press into one write
+   */
+  void set_immediate(bool immediate) noexcept;
+
+  /**
+   * What a write does when the device doesn't take a frame in time, see
+   * uinput/backpressure.hpp. Keyboards block by default since coalescing
+   * or dropping frames loses keystrokes
+   */
+  void set_backpressure(const uinput::BackpressurePolicy& policy) noexcept;
+  [[nodiscard]] const uinput::BackpressurePolicy&
+  get_backpressure() const noexcept;
 
   /**
    * Tries to remap a character into a new codes
@@ -46,11 +105,70 @@ public:
   void remap(u8 key, u16 code) noexcept;
 
   // Converts a charater into a key press
-  void key_press(c8 key) const noexcept;
+  void key_press(c8 key) noexcept;
+
+  /**
+   * Types the whole text, faster than calling key_press per character.
+   * - SHIFT is held across runs of shifted characters
+   * - the release of a key shares its frame with the press of the next one
+   *   unless both are the same key
+   * - every frame is a single write followed by the delay of its kind
+   * Characters without a mapping are skipped
+   */
+  void type_string(std::string_view text) noexcept;
+
+  // Call sync to register the key press, code is a KEY_* code
+  void press_key(u16 code) noexcept;
+  // Call sync to register the key release, code is a KEY_* code
+  void release_key(u16 code) noexcept;
+
+  // Writes the buffered events along with a SYN_REPORT, through the queue
+  // of the worker while it runs
+  void sync() noexcept;
+
+  // KEY_* code of the character with its Modifiers, 0 if it has no mapping
+  [[nodiscard]] u16 get_code(c8 key) const noexcept;
+  // Whether there are events waiting for a sync
+  [[nodiscard]] bool has_pending() const noexcept;
+
+  /**
+   * Every frame written after this is also recorded, nullptr to stop. Only
+   * the events the sink took are recorded. While the worker runs the frames
+   * are recorded whole as they are queued, from the thread typing, with the
+   * time the worker writes them at.
+   * @param device - index written along the frames, used by the player to
+   *   route the frames back to the right device
+   */
+  void set_recorder(Recorder* recorder, u8 device) noexcept;
+
+  // Counters of the writes so far, can be called from any thread
+  [[nodiscard]] uinput::StatsSnapshot get_stats() const noexcept;
+  // Done by the worker on its next wake up while it runs
+  void reset_stats() noexcept;
+
+  // Sinks may need to be configured before init
+  [[nodiscard]] Sink& get_sink() noexcept;
+  [[nodiscard]] const Sink& get_sink() const noexcept;
 
 private:
-  i32 fd = -1;
-  u32 delay = 1'000; // 1ms
+  // Events of a frame, the last one is kept for its SYN_REPORT
+  static constexpr usize FRAME_CAPACITY = 8U;
+
+  struct Worker;
+
+  Sink sink{};
+  KeyboardTiming delays{};
+  bool immediate = false;
+  std::unique_ptr<Worker> worker{};
+
+  Recorder* recorder = nullptr;
+  u8 device = 0U;
+  uinput::Frame<FRAME_CAPACITY> frame{};
+  uinput::BackpressurePolicy backpressure{
+      .mode = uinput::Backpressure::BLOCK,
+  };
+  // Single writer, only the worker thread writes it while it runs
+  uinput::DeviceStats stats{uinput::Backpressure::BLOCK};
 
   std::array<u16, 127> key_map{
       // Special key codes
@@ -119,8 +237,25 @@ private:
       KEY_RIGHTBRACE | Modifiers::SHIFT, // }
       KEY_GRAVE | Modifiers::SHIFT,      // ~
   };
+
+  void queue_event(u16 type, u16 code, i32 value) noexcept;
+  // Writes the frame, or hands it to the worker while it runs
+  void flush_frame() noexcept;
+  // Syncs then waits for the delay so the receiver registers the frame
+  void step(u32 delay) noexcept;
+  // Queues the frame for the worker, the next one is due delay us later
+  void enqueue(u32 delay) noexcept;
+
+  void run_worker() noexcept;
 };
 
+using Keyboard = BasicKeyboard<uinput::UinputSink>;
+
+extern template class BasicKeyboard<uinput::UinputSink>;
+extern template class BasicKeyboard<uinput::NullSink>;
+extern template class BasicKeyboard<uinput::RingSink>;
+extern template class BasicKeyboard<uinput::FileSink>;
+
 } // namespace vc
 
 #endif
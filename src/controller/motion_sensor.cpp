@@ -0,0 +1,298 @@
+#include "./motion_sensor.hpp"
+#include "../helper.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <linux/input-event-codes.h>
+#include <linux/uinput.h>
+
+namespace vc {
+
+namespace {
+
+[[nodiscard]] uinput_abs_setup
+to_abs_setup(u16 code, i32 range, i32 resolution) noexcept {
+  return uinput_abs_setup{
+      .code = code,
+      .absinfo =
+          {
+              .value = 0,
+              .minimum = -range,
+              .maximum = range,
+              // The kernel would smooth the samples otherwise
+              .fuzz = 0,
+              .flat = 0,
+              .resolution = resolution,
+          },
+  };
+}
+
+[[nodiscard]] i32 to_units(f32 value, i32 resolution, i32 range) noexcept {
+  auto units = std::lround(value * static_cast<f32>(resolution));
+  return static_cast<i32>(std::clamp<long>(units, -range, range));
+}
+
+[[nodiscard]] f32 evaluate(const AxisWave& wave, f64 seconds) noexcept {
+  constexpr f64 TAU = 6.283185307179586;
+  return wave.offset +
+         wave.amplitude *
+             static_cast<f32>(std::sin(TAU * wave.hz * seconds + wave.phase));
+}
+
+} // namespace
+
+template <typename Sink>
+error_code BasicMotionSensor<Sink>::init(
+    const c8* name, u16 vendor, u16 product
+) noexcept {
+  TRY_CODE(this->sink.open());
+
+  const std::array<uinput_abs_setup, 6> axes{
+      to_abs_setup(ABS_X, ACCEL_RANGE, ACCEL_RESOLUTION),
+      to_abs_setup(ABS_Y, ACCEL_RANGE, ACCEL_RESOLUTION),
+      to_abs_setup(ABS_Z, ACCEL_RANGE, ACCEL_RESOLUTION),
+      to_abs_setup(ABS_RX, GYRO_RANGE, GYRO_RESOLUTION),
+      to_abs_setup(ABS_RY, GYRO_RANGE, GYRO_RESOLUTION),
+      to_abs_setup(ABS_RZ, GYRO_RANGE, GYRO_RESOLUTION),
+  };
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_ABS));
+  for (const auto& axis : axes) {
+    TRY_CODE(this->sink.enable(UI_SET_ABSBIT, axis.code));
+    TRY_CODE(this->sink.setup_abs(axis));
+  }
+
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_MSC));
+  TRY_CODE(this->sink.enable(UI_SET_MSCBIT, MSC_TIMESTAMP));
+  TRY_CODE(this->sink.enable(UI_SET_PROPBIT, INPUT_PROP_ACCELEROMETER));
+
+  uinput_setup setup{
+      .id =
+          {
+              .bustype = BUS_USB,
+              .vendor = vendor,
+              .product = product,
+              .version = 1,
+          },
+      .name = {},
+      .ff_effects_max = 0U,
+  };
+  snprintf(setup.name, UINPUT_MAX_NAME_SIZE, "%s Motion Sensors", name);
+
+  TRY_CODE(this->sink.create(setup));
+
+  return error::OK;
+}
+
+template <typename Sink>
+error_code BasicMotionSensor<Sink>::wait_ready(i32 timeout_ms) noexcept {
+  return this->sink.wait_ready(timeout_ms);
+}
+
+template <typename Sink>
+usize BasicMotionSensor<Sink>::push(
+    const MotionSample* samples, usize count
+) noexcept {
+  for (usize i = 0U; i < count; ++i) {
+    if (!this->samples.push(samples[i])) {
+      return i;
+    }
+  }
+  return count;
+}
+
+template <typename Sink>
+void BasicMotionSensor<Sink>::set_waveform(
+    const MotionWaveform& waveform, i64 start_ns
+) noexcept {
+  this->waveform = waveform;
+  this->waveform.rate = std::clamp(waveform.rate, 1U, 1'000U);
+  this->generating = true;
+  this->wave_start = start_ns;
+  this->wave_next = start_ns;
+}
+
+template <typename Sink>
+void BasicMotionSensor<Sink>::clear_waveform() noexcept {
+  this->generating = false;
+}
+
+template <typename Sink>
+usize BasicMotionSensor<Sink>::update(i64 now) noexcept {
+  i64 period = timing::NS_PER_S / this->waveform.rate;
+  usize written = 0U;
+
+  while (true) {
+    if (const MotionSample* next = this->samples.peek(); next != nullptr) {
+      if (next->time > now) {
+        break;
+      }
+
+      MotionSample sample{};
+      (void)this->samples.pop(sample);
+      this->queue_sample(sample);
+      // The waveform resumes after the pushed samples
+      this->wave_next = std::max(this->wave_next, sample.time + period);
+      ++written;
+      continue;
+    }
+
+    if (!this->generating || this->wave_next > now) {
+      break;
+    }
+
+    // After a long stall only the last queue worth of samples is caught up
+    i64 behind = (now - this->wave_next) / period;
+    if (behind > static_cast<i64>(QUEUE_CAPACITY)) {
+      this->wave_next += (behind - QUEUE_CAPACITY) * period;
+    }
+
+    this->queue_sample(this->generate(this->wave_next));
+    this->wave_next += period;
+    ++written;
+  }
+
+  if (this->batched != 0U) {
+    this->flush_batch();
+  }
+  return written;
+}
+
+template <typename Sink>
+void BasicMotionSensor<Sink>::set_backpressure(
+    const uinput::BackpressurePolicy& policy
+) noexcept {
+  this->backpressure = policy;
+  this->stats.set_policy(policy.mode);
+}
+
+template <typename Sink>
+const uinput::BackpressurePolicy&
+BasicMotionSensor<Sink>::get_backpressure() const noexcept {
+  return this->backpressure;
+}
+
+template <typename Sink>
+uinput::StatsSnapshot BasicMotionSensor<Sink>::get_stats() const noexcept {
+  return this->stats.snapshot();
+}
+
+template <typename Sink> void BasicMotionSensor<Sink>::reset_stats() noexcept {
+  this->stats.reset();
+  this->lost = 0U;
+}
+
+template <typename Sink>
+u64 BasicMotionSensor<Sink>::get_lost() const noexcept {
+  return this->lost;
+}
+
+template <typename Sink> Sink& BasicMotionSensor<Sink>::get_sink() noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+const Sink& BasicMotionSensor<Sink>::get_sink() const noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+void BasicMotionSensor<Sink>::queue_sample(const MotionSample& sample
+) noexcept {
+  if (this->epoch == -1) {
+    this->epoch = sample.time;
+  }
+
+  // Wraps around every ~71 minutes like the one of a real pad
+  auto timestamp = static_cast<u32>(
+      static_cast<u64>(sample.time - this->epoch) / timing::NS_PER_US
+  );
+  (void)this->frame.push(EV_MSC, MSC_TIMESTAMP, static_cast<i32>(timestamp));
+
+  const std::array<i32, 6> values{
+      to_units(sample.accel.x, ACCEL_RESOLUTION, ACCEL_RANGE),
+      to_units(sample.accel.y, ACCEL_RESOLUTION, ACCEL_RANGE),
+      to_units(sample.accel.z, ACCEL_RESOLUTION, ACCEL_RANGE),
+      to_units(sample.gyro.x, GYRO_RESOLUTION, GYRO_RANGE),
+      to_units(sample.gyro.y, GYRO_RESOLUTION, GYRO_RANGE),
+      to_units(sample.gyro.z, GYRO_RESOLUTION, GYRO_RANGE),
+  };
+  constexpr std::array<u16, 6> CODES{
+      ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ,
+  };
+  for (usize i = 0U; i < CODES.size(); ++i) {
+    (void)this->frame.push(EV_ABS, CODES[i], values[i]);
+  }
+
+  this->stats.record_frame();
+  (void)this->frame.push(EV_SYN, SYN_REPORT, 0);
+  if (++this->batched == BATCH_MAX) {
+    this->flush_batch();
+  }
+}
+
+template <typename Sink>
+void BasicMotionSensor<Sink>::flush_batch() noexcept {
+  auto result = this->frame.flush(this->sink, this->stats, this->backpressure);
+  if (result == uinput::FlushResult::WRITTEN) {
+    this->batched = 0U;
+    return;
+  }
+
+  // Carrying would merge the frames of the batch, only the samples the sink
+  // took whole are kept
+  usize written = result == uinput::FlushResult::CARRIED
+                      ? this->frame.get_written()
+                      : 0U;
+  usize done = written / SAMPLE_EVENTS;
+  usize torn = written % SAMPLE_EVENTS;
+  if (torn != 0U) {
+    // The kernel holds part of a sample, the carried events start with the
+    // rest of it (without its SYN_REPORT). Ending it keeps it from merging
+    // into the first frame of the next batch, if even that fails the next
+    // frame written completes it and overwrites its axes
+    uinput::Frame<SAMPLE_EVENTS> rest{};
+    for (usize i = 0U; i < SAMPLE_EVENTS - 1U - torn; ++i) {
+      const auto& event = this->frame.data()[i];
+      (void)rest.push(event.type, event.code, event.value);
+    }
+    (void)rest.push(EV_SYN, SYN_REPORT, 0);
+    if (rest.flush(this->sink, this->stats, this->backpressure) ==
+        uinput::FlushResult::WRITTEN) {
+      ++done;
+    }
+  }
+
+  this->frame.reset();
+  this->lost += this->batched - done;
+  this->batched = 0U;
+}
+
+template <typename Sink>
+MotionSample BasicMotionSensor<Sink>::generate(i64 time) const noexcept {
+  f64 seconds = static_cast<f64>(time - this->wave_start) / timing::NS_PER_S;
+  const auto& accel = this->waveform.accel;
+  const auto& gyro = this->waveform.gyro;
+  return MotionSample{
+      .time = time,
+      .accel =
+          {
+              .x = evaluate(accel[0], seconds),
+              .y = evaluate(accel[1], seconds),
+              .z = evaluate(accel[2], seconds),
+          },
+      .gyro =
+          {
+              .x = evaluate(gyro[0], seconds),
+              .y = evaluate(gyro[1], seconds),
+              .z = evaluate(gyro[2], seconds),
+          },
+  };
+}
+
+template class BasicMotionSensor<uinput::UinputSink>;
+template class BasicMotionSensor<uinput::NullSink>;
+template class BasicMotionSensor<uinput::RingSink>;
+template class BasicMotionSensor<uinput::FileSink>;
+
+} // namespace vc
@@ -0,0 +1,158 @@
+#ifndef VC_CONTROLLER_MOTION_SENSOR_HPP
+#define VC_CONTROLLER_MOTION_SENSOR_HPP
+
+#include "../queue/spsc.hpp"
+#include "../types.hpp"
+#include "../uinput/frame.hpp"
+#include "../uinput/sink.hpp"
+#include "../uinput/stats.hpp"
+#include <array>
+
+namespace vc {
+
+struct Vec3 {
+  f32 x = 0.0F;
+  f32 y = 0.0F;
+  f32 z = 0.0F;
+};
+
+struct MotionSample {
+  // CLOCK_MONOTONIC time the sample was taken at in ns, also decides when
+  // it is written and its MSC_TIMESTAMP
+  i64 time;
+  // In g, [-4, 4]
+  Vec3 accel;
+  // In degrees per second, [-2048, 2048]
+  Vec3 gyro;
+};
+
+// offset + amplitude * sin(2 * pi * hz * t + phase), t in seconds
+struct AxisWave {
+  f32 offset = 0.0F;
+  f32 amplitude = 0.0F;
+  f32 hz = 0.0F;
+  f32 phase = 0.0F;
+};
+
+// Generated when no pushed samples are left, ie. a pad at rest or shaking
+struct MotionWaveform {
+  // x, y and z, in g
+  std::array<AxisWave, 3> accel{};
+  // x, y and z, in degrees per second
+  std::array<AxisWave, 3> gyro{};
+  // Samples per second, [1, 1000]
+  u32 rate = 1'000U;
+};
+
+/**
+ * Motion sensor node of a pad, the accelerometer on ABS_X/Y/Z and the
+ * gyroscope on ABS_RX/RY/RZ with the ranges and resolutions of a DualShock
+ * 4, every sample is its own frame carrying an MSC_TIMESTAMP in us.
+ *
+ * Samples are pushed from any one producer thread and written by update,
+ * called once per tick. Everything due is written with a single write, so
+ * a 1kHz stream flushed at 250Hz costs 250 writes per second per pad.
+ * Samples that don't fit in the queue are rejected, push returns how many
+ * were taken.
+ *
+ * (void)controller.init("Simulated PS4 Controller", true, false, true);
+ * auto* sensors = controller.get_motion_sensors();
+ * sensors->push(samples, count);           // producer thread
+ * sensors->update(timing::now_ns());       // tick thread
+ *
+ * Sink is where the events are written to, see uinput/sink.hpp.
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicMotionSensor {
+public:
+  // Samples waiting to be written, a second of a 1kHz stream
+  static constexpr usize QUEUE_CAPACITY = 1024U;
+  // Samples written per write call at most
+  static constexpr usize BATCH_MAX = 32U;
+
+  // Units per g and per degree per second
+  static constexpr i32 ACCEL_RESOLUTION = 8192;
+  static constexpr i32 GYRO_RESOLUTION = 1024;
+  static constexpr i32 ACCEL_RANGE = 4 * ACCEL_RESOLUTION;
+  static constexpr i32 GYRO_RANGE = 2048 * GYRO_RESOLUTION;
+
+  BasicMotionSensor() noexcept = default;
+  BasicMotionSensor(const BasicMotionSensor&) = delete;
+  BasicMotionSensor& operator=(const BasicMotionSensor&) = delete;
+  BasicMotionSensor(BasicMotionSensor&&) = delete;
+  BasicMotionSensor& operator=(BasicMotionSensor&&) = delete;
+
+  ~BasicMotionSensor() noexcept = default;
+
+  [[nodiscard]] error_code
+  init(const c8* name, u16 vendor, u16 product) noexcept;
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+
+  /**
+   * Queues samples sorted by time, only one thread may push
+   * @return number of samples queued
+   */
+  usize push(const MotionSample* samples, usize count) noexcept;
+
+  /**
+   * Generates samples at the rate of the waveform whenever the queue runs
+   * dry, starting at start_ns. Called from the thread calling update
+   */
+  void set_waveform(const MotionWaveform& waveform, i64 start_ns) noexcept;
+  void clear_waveform() noexcept;
+
+  /**
+   * Writes every sample up to now in batches of BATCH_MAX
+   * @return number of samples written
+   */
+  usize update(i64 now) noexcept;
+
+  void set_backpressure(const uinput::BackpressurePolicy& policy) noexcept;
+  [[nodiscard]] const uinput::BackpressurePolicy&
+  get_backpressure() const noexcept;
+
+  // Counters of the writes so far, can be called from any thread
+  [[nodiscard]] uinput::StatsSnapshot get_stats() const noexcept;
+  void reset_stats() noexcept;
+  // Samples discarded because the sink could not take them
+  [[nodiscard]] u64 get_lost() const noexcept;
+
+  [[nodiscard]] Sink& get_sink() noexcept;
+  [[nodiscard]] const Sink& get_sink() const noexcept;
+
+private:
+  // MSC_TIMESTAMP, the 6 axes and the SYN_REPORT
+  static constexpr usize SAMPLE_EVENTS = 8U;
+
+  Sink sink{};
+  uinput::Frame<BATCH_MAX * SAMPLE_EVENTS> frame{};
+  usize batched = 0U;
+  SpscRing<MotionSample, QUEUE_CAPACITY> samples{};
+
+  MotionWaveform waveform{};
+  bool generating = false;
+  i64 wave_start = 0;
+  i64 wave_next = 0;
+
+  // Time of the first sample written, MSC_TIMESTAMP counts from it
+  i64 epoch = -1;
+  u64 lost = 0U;
+
+  uinput::BackpressurePolicy backpressure{};
+  uinput::DeviceStats stats{};
+
+  void queue_sample(const MotionSample& sample) noexcept;
+  void flush_batch() noexcept;
+  [[nodiscard]] MotionSample generate(i64 time) const noexcept;
+};
+
+using MotionSensor = BasicMotionSensor<uinput::UinputSink>;
+
+extern template class BasicMotionSensor<uinput::UinputSink>;
+extern template class BasicMotionSensor<uinput::NullSink>;
+extern template class BasicMotionSensor<uinput::RingSink>;
+extern template class BasicMotionSensor<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
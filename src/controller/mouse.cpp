@@ -0,0 +1,254 @@
+#include "./mouse.hpp"
+#include "../helper.hpp"
+#include <cmath>
+#include <cstring>
+#include <linux/uinput.h>
+#include <utility>
+
+namespace vc {
+
+namespace {
+
+constexpr std::array<u16, 5> BUTTONS{
+    BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, BTN_SIDE, BTN_EXTRA,
+};
+
+constexpr std::array<u16, 6> AXES{
+    REL_X, REL_Y, REL_WHEEL, REL_HWHEEL, REL_WHEEL_HI_RES, REL_HWHEEL_HI_RES,
+};
+
+// Removes the whole part from the value, the fraction stays for later
+[[nodiscard]] i32 take_whole(f32& value) noexcept {
+  auto whole = static_cast<i32>(std::trunc(value));
+  value -= static_cast<f32>(whole);
+  return whole;
+}
+
+[[nodiscard]] u8 button_bit(MouseButton button) noexcept {
+  return static_cast<u8>(1U << (button - BTN_LEFT));
+}
+
+} // namespace
+
+template <typename Sink>
+BasicMouse<Sink>::BasicMouse(BasicMouse&& other) noexcept
+    : sink(std::move(other.sink)),
+      frame(other.frame),
+      x(other.x),
+      y(other.y),
+      wheel(other.wheel),
+      hwheel(other.hwheel),
+      wheel_notch(other.wheel_notch),
+      hwheel_notch(other.hwheel_notch),
+      buttons(other.buttons),
+      committed(other.committed),
+      backpressure(other.backpressure),
+      stats(other.stats) {
+  other.frame.clear();
+}
+
+template <typename Sink>
+BasicMouse<Sink>& BasicMouse<Sink>::operator=(BasicMouse&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->sink = std::move(rhs.sink);
+  this->frame = rhs.frame;
+  this->x = rhs.x;
+  this->y = rhs.y;
+  this->wheel = rhs.wheel;
+  this->hwheel = rhs.hwheel;
+  this->wheel_notch = rhs.wheel_notch;
+  this->hwheel_notch = rhs.hwheel_notch;
+  this->buttons = rhs.buttons;
+  this->committed = rhs.committed;
+  this->backpressure = rhs.backpressure;
+  this->stats = rhs.stats;
+  rhs.frame.clear();
+
+  return *this;
+}
+
+template <typename Sink>
+error_code BasicMouse<Sink>::init(const c8* name) noexcept {
+  TRY_CODE(this->sink.open());
+
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_KEY));
+  for (u16 button : BUTTONS) {
+    TRY_CODE(this->sink.enable(UI_SET_KEYBIT, button));
+  }
+
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_REL));
+  for (u16 axis : AXES) {
+    TRY_CODE(this->sink.enable(UI_SET_RELBIT, axis));
+  }
+  TRY_CODE(this->sink.enable(UI_SET_PROPBIT, INPUT_PROP_POINTER));
+
+  uinput_setup setup{
+      .id =
+          {
+              .bustype = BUS_USB,
+              .vendor = 0x1111,
+              .product = 0x2222,
+              .version = 1,
+          },
+      .name = {},
+      .ff_effects_max = 0U,
+  };
+  std::strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1U);
+
+  TRY_CODE(this->sink.create(setup));
+
+  return error::OK;
+}
+
+template <typename Sink>
+error_code BasicMouse<Sink>::wait_ready(i32 timeout_ms) noexcept {
+  return this->sink.wait_ready(timeout_ms);
+}
+
+template <typename Sink> void BasicMouse<Sink>::move(f32 x, f32 y) noexcept {
+  this->x += x;
+  this->y += y;
+}
+
+template <typename Sink>
+void BasicMouse<Sink>::scroll(f32 vertical, f32 horizontal) noexcept {
+  this->wheel += vertical * static_cast<f32>(HI_RES_PER_NOTCH);
+  this->hwheel += horizontal * static_cast<f32>(HI_RES_PER_NOTCH);
+}
+
+template <typename Sink>
+void BasicMouse<Sink>::press_button(MouseButton button) noexcept {
+  this->buttons |= button_bit(button);
+  this->queue_event(EV_KEY, button, 1);
+}
+
+template <typename Sink>
+void BasicMouse<Sink>::release_button(MouseButton button) noexcept {
+  this->buttons &= ~button_bit(button);
+  this->queue_event(EV_KEY, button, 0);
+}
+
+template <typename Sink>
+bool BasicMouse<Sink>::is_button_pressed(MouseButton button) const noexcept {
+  return this->buttons & button_bit(button);
+}
+
+template <typename Sink> void BasicMouse<Sink>::sync() noexcept {
+  i32 x = this->queue_delta(REL_X, take_whole(this->x));
+  i32 y = this->queue_delta(REL_Y, take_whole(this->y));
+
+  // Notches follow the hi res units written so far
+  i32 units = take_whole(this->wheel);
+  i32 wheel = this->queue_delta(REL_WHEEL_HI_RES, units);
+  i32 notches = this->queue_notches(REL_WHEEL, this->wheel_notch, units);
+  units = take_whole(this->hwheel);
+  i32 hwheel = this->queue_delta(REL_HWHEEL_HI_RES, units);
+  i32 hnotches = this->queue_notches(REL_HWHEEL, this->hwheel_notch, units);
+
+  this->stats.record_frame();
+  this->queue_event(EV_SYN, SYN_REPORT, 0);
+  auto result = this->frame.flush(this->sink, this->stats, this->backpressure);
+  if (result == uinput::FlushResult::WRITTEN) {
+    this->committed = this->buttons;
+  } else if (result == uinput::FlushResult::DROPPED) {
+    // None of it reached the kernel, the motion goes to the next frame
+    this->buttons = this->committed;
+    this->x += static_cast<f32>(x);
+    this->y += static_cast<f32>(y);
+    this->wheel += static_cast<f32>(wheel);
+    this->wheel_notch -= wheel - notches * HI_RES_PER_NOTCH;
+    this->hwheel += static_cast<f32>(hwheel);
+    this->hwheel_notch -= hwheel - hnotches * HI_RES_PER_NOTCH;
+  }
+}
+
+template <typename Sink> bool BasicMouse<Sink>::has_pending() const noexcept {
+  return !this->frame.empty() || std::fabs(this->x) >= 1.0F ||
+         std::fabs(this->y) >= 1.0F || std::fabs(this->wheel) >= 1.0F ||
+         std::fabs(this->hwheel) >= 1.0F;
+}
+
+template <typename Sink>
+void BasicMouse<Sink>::set_backpressure(
+    const uinput::BackpressurePolicy& policy
+) noexcept {
+  this->backpressure = policy;
+  this->stats.set_policy(policy.mode);
+}
+
+template <typename Sink>
+const uinput::BackpressurePolicy&
+BasicMouse<Sink>::get_backpressure() const noexcept {
+  return this->backpressure;
+}
+
+template <typename Sink>
+uinput::StatsSnapshot BasicMouse<Sink>::get_stats() const noexcept {
+  return this->stats.snapshot();
+}
+
+template <typename Sink> void BasicMouse<Sink>::reset_stats() noexcept {
+  this->stats.reset();
+}
+
+template <typename Sink> Sink& BasicMouse<Sink>::get_sink() noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+const Sink& BasicMouse<Sink>::get_sink() const noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+void BasicMouse<Sink>::queue_event(u16 type, u16 code, i32 value) noexcept {
+  // The last slot is kept for the SYN_REPORT. Only buttons can fill the
+  // rest, they are written as their own frame
+  bool reserved = this->frame.size() + 1U >= this->frame.capacity();
+  if (reserved && (type != EV_SYN || code != SYN_REPORT)) {
+    this->stats.record_frame();
+    (void)this->frame.push(EV_SYN, SYN_REPORT, 0);
+    (void)this->frame.flush(this->sink, this->stats, this->backpressure);
+  }
+  (void)this->frame.push(type, code, value);
+}
+
+template <typename Sink>
+i32 BasicMouse<Sink>::queue_notches(
+    u16 code, i32& remainder, i32 hi_res
+) noexcept {
+  remainder += hi_res;
+  i32 notches = remainder / HI_RES_PER_NOTCH;
+  remainder -= notches * HI_RES_PER_NOTCH;
+  return this->queue_delta(code, notches);
+}
+
+template <typename Sink>
+i32 BasicMouse<Sink>::queue_delta(u16 code, i32 delta) noexcept {
+  // A carried event of the code takes the sum instead of the new value
+  i32 total = delta;
+  bool carried = false;
+  for (usize i = 0U; i < this->frame.size(); ++i) {
+    const auto& event = this->frame.data()[i];
+    if (event.type == EV_REL && event.code == code) {
+      total += event.value;
+      carried = true;
+      break;
+    }
+  }
+
+  if (total != 0 || carried) {
+    this->queue_event(EV_REL, code, total);
+  }
+  return total;
+}
+
+template class BasicMouse<uinput::UinputSink>;
+template class BasicMouse<uinput::NullSink>;
+template class BasicMouse<uinput::RingSink>;
+template class BasicMouse<uinput::FileSink>;
+
+} // namespace vc
@@ -0,0 +1,118 @@
+#ifndef VC_CONTROLLER_MOUSE_HPP
+#define VC_CONTROLLER_MOUSE_HPP
+
+#include "../types.hpp"
+#include "../uinput/frame.hpp"
+#include "../uinput/sink.hpp"
+#include "../uinput/stats.hpp"
+#include <linux/input-event-codes.h>
+
+namespace vc {
+
+enum MouseButton : u16 {
+  LEFT = BTN_LEFT,
+  RIGHT = BTN_RIGHT,
+  MIDDLE = BTN_MIDDLE,
+  SIDE = BTN_SIDE,
+  EXTRA = BTN_EXTRA,
+};
+
+/**
+ * Relative mouse with a high resolution wheel.
+ * Motion is accumulated between syncs, however many updates come in only
+ * the whole counts are written as one REL_X/REL_Y pair per sync and the
+ * fractions carry over. Call sync once per tick, ie. from the loop of a
+ * ControllerPool, instead of after every update.
+ *
+ * mouse.move(0.4F, -0.25F); // 1000 times from a high DPI script
+ * mouse.sync();             // one frame with REL_X 400, REL_Y -250
+ *
+ * Sink is where the events are written to, see uinput/sink.hpp.
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicMouse {
+public:
+  BasicMouse() noexcept = default;
+  BasicMouse(const BasicMouse&) = delete;
+  BasicMouse& operator=(const BasicMouse&) = delete;
+
+  BasicMouse(BasicMouse&& other) noexcept;
+  BasicMouse& operator=(BasicMouse&& rhs) noexcept;
+
+  ~BasicMouse() noexcept = default;
+
+  [[nodiscard]] error_code init(const c8* name) noexcept;
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+
+  // In counts, the fractions are kept for the next frames
+  void move(f32 x, f32 y) noexcept;
+  // In notches, fractions are written as REL_*_HI_RES (120 per notch)
+  void scroll(f32 vertical, f32 horizontal) noexcept;
+
+  void press_button(MouseButton button) noexcept;
+  void release_button(MouseButton button) noexcept;
+  [[nodiscard]] bool is_button_pressed(MouseButton button) const noexcept;
+
+  /**
+   * Writes the buttons and the whole part of the accumulated motion in a
+   * single frame. Motion of a dropped frame is added back
+   */
+  void sync() noexcept;
+
+  // Whether a sync would write something
+  [[nodiscard]] bool has_pending() const noexcept;
+
+  // DROP and BLOCK keep their meaning, COALESCE adds up the carried motion
+  void set_backpressure(const uinput::BackpressurePolicy& policy) noexcept;
+  [[nodiscard]] const uinput::BackpressurePolicy&
+  get_backpressure() const noexcept;
+
+  // Counters of the writes so far, can be called from any thread
+  [[nodiscard]] uinput::StatsSnapshot get_stats() const noexcept;
+  void reset_stats() noexcept;
+
+  // Sinks may need to be configured before init
+  [[nodiscard]] Sink& get_sink() noexcept;
+  [[nodiscard]] const Sink& get_sink() const noexcept;
+
+private:
+  static constexpr i32 HI_RES_PER_NOTCH = 120;
+
+  Sink sink{};
+  uinput::Frame<16> frame{};
+
+  f32 x = 0.0F;
+  f32 y = 0.0F;
+  // In 1/120 of a notch
+  f32 wheel = 0.0F;
+  f32 hwheel = 0.0F;
+  // Hi res units written that don't add up to a notch yet
+  i32 wheel_notch = 0;
+  i32 hwheel_notch = 0;
+
+  // Bit per button code from BTN_LEFT
+  u8 buttons = 0U;
+  // Buttons of the last frame the sink fully took
+  u8 committed = 0U;
+  uinput::BackpressurePolicy backpressure{};
+  uinput::DeviceStats stats{};
+
+  void queue_event(u16 type, u16 code, i32 value) noexcept;
+  // Queues the notches the hi res units add up to
+  [[nodiscard]] i32
+  queue_notches(u16 code, i32& remainder, i32 hi_res) noexcept;
+  // Queues the delta on top of what a flush carried of the code, returns
+  // what the frame holds for it
+  [[nodiscard]] i32 queue_delta(u16 code, i32 delta) noexcept;
+};
+
+using Mouse = BasicMouse<uinput::UinputSink>;
+
+extern template class BasicMouse<uinput::UinputSink>;
+extern template class BasicMouse<uinput::NullSink>;
+extern template class BasicMouse<uinput::RingSink>;
+extern template class BasicMouse<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,301 @@
+#include "./passthrough.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace vc {
+
+namespace {
+
+constexpr u8 NO_BUTTON = 0xff;
+
+// Physical BTN_* codes of the default layout back to their PS4Button
+constexpr std::array<u8, BTN_THUMBR - BTN_SOUTH + 1> BUTTONS = [] {
+  std::array<u8, BTN_THUMBR - BTN_SOUTH + 1> buttons{};
+  for (auto& button : buttons) {
+    button = NO_BUTTON;
+  }
+  for (u8 button = 0U; button < PS4Profile::BUTTONS.size(); ++button) {
+    buttons[PS4Profile::BUTTONS[button] - BTN_SOUTH] = button;
+  }
+  return buttons;
+}();
+
+[[nodiscard]] u8 to_button(u16 code) noexcept {
+  return code >= BTN_SOUTH && code <= BTN_THUMBR ? BUTTONS[code - BTN_SOUTH]
+                                                 : NO_BUTTON;
+}
+
+[[nodiscard]] i8 to_dpad(i32 value) noexcept {
+  return static_cast<i8>(std::clamp(value, -1, 1));
+}
+
+} // namespace
+
+template <typename Sink>
+BasicPassthrough<Sink>::BasicPassthrough(BasicPassthrough&& other) noexcept
+    : pending(other.pending),
+      latency(other.latency),
+      dropped(other.dropped),
+      fd(other.fd),
+      owned(other.owned),
+      grabbed(other.grabbed),
+      primed(other.primed),
+      dropping(other.dropping) {
+  other.fd = -1;
+  other.owned = false;
+  other.grabbed = false;
+}
+
+template <typename Sink>
+BasicPassthrough<Sink>&
+BasicPassthrough<Sink>::operator=(BasicPassthrough&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close_fd();
+
+  this->pending = rhs.pending;
+  this->latency = rhs.latency;
+  this->dropped = rhs.dropped;
+  this->fd = rhs.fd;
+  this->owned = rhs.owned;
+  this->grabbed = rhs.grabbed;
+  this->primed = rhs.primed;
+  this->dropping = rhs.dropping;
+  rhs.fd = -1;
+  rhs.owned = false;
+  rhs.grabbed = false;
+
+  return *this;
+}
+
+template <typename Sink>
+BasicPassthrough<Sink>::~BasicPassthrough() noexcept {
+  this->close_fd();
+}
+
+template <typename Sink>
+error_code BasicPassthrough<Sink>::open(const c8* path, bool grab) noexcept {
+  this->close_fd();
+
+  this->fd = ::open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (this->fd == -1) {
+    return error::PASSTHROUGH_OPEN;
+  }
+  this->owned = true;
+
+  i32 clock = CLOCK_MONOTONIC;
+  if (ioctl(this->fd, EVIOCSCLOCKID, &clock) == -1) {
+    this->close_fd();
+    return error::PASSTHROUGH_OPEN;
+  }
+
+  if (grab) {
+    if (ioctl(this->fd, EVIOCGRAB, 1) == -1) {
+      this->close_fd();
+      return error::PASSTHROUGH_OPEN;
+    }
+    this->grabbed = true;
+  }
+
+  this->primed = false;
+  this->dropping = false;
+  return error::OK;
+}
+
+template <typename Sink> void BasicPassthrough<Sink>::set_fd(i32 fd) noexcept {
+  this->close_fd();
+  this->fd = fd;
+  this->primed = false;
+  this->dropping = false;
+}
+
+template <typename Sink>
+bool BasicPassthrough<Sink>::wait(i32 timeout_ms) const noexcept {
+  pollfd request{.fd = this->fd, .events = POLLIN, .revents = 0};
+  return poll(&request, 1U, timeout_ms) > 0 && (request.revents & POLLIN);
+}
+
+template <typename Sink>
+usize BasicPassthrough<Sink>::pump(BasicPS4Controller<Sink>& controller
+) noexcept {
+  if (!this->primed) {
+    this->pending = controller.get_state();
+    this->primed = true;
+  }
+
+  usize forwarded = 0U;
+  while (true) {
+    // evdev and pipes written by a sink only ever hand out whole events
+    isize size = read(this->fd, this->buffer.data(), sizeof(this->buffer));
+    if (size <= 0) {
+      break;
+    }
+
+    i64 read_time = timing::now_ns();
+    usize count = size / sizeof(input_event);
+    for (usize i = 0U; i < count; ++i) {
+      const input_event& event = this->buffer[i];
+
+      if (this->dropping) {
+        if (event.type == EV_SYN && event.code == SYN_REPORT) {
+          this->dropping = false;
+          this->resync(controller.get_state());
+          controller.apply(this->pending);
+        }
+        continue;
+      }
+
+      if (event.type != EV_SYN) {
+        this->handle_event(event);
+        continue;
+      }
+
+      if (event.code == SYN_DROPPED) {
+        ++this->dropped;
+        this->dropping = true;
+        continue;
+      }
+
+      if (event.code != SYN_REPORT) {
+        continue;
+      }
+
+      controller.apply(this->pending);
+      ++forwarded;
+
+      // Only evdev nodes have timestamps on our clock
+      i64 start = this->owned ? event.input_event_sec * timing::NS_PER_S +
+                                    event.input_event_usec * timing::NS_PER_US
+                              : read_time;
+      this->latency.record(timing::now_ns() - start);
+    }
+
+    if (count < this->buffer.size()) {
+      break;
+    }
+  }
+
+  return forwarded;
+}
+
+template <typename Sink>
+const timing::Histogram& BasicPassthrough<Sink>::get_latency() const noexcept {
+  return this->latency;
+}
+
+template <typename Sink>
+u64 BasicPassthrough<Sink>::get_dropped() const noexcept {
+  return this->dropped;
+}
+
+template <typename Sink>
+void BasicPassthrough<Sink>::handle_event(const input_event& event) noexcept {
+  switch (event.type) {
+  case EV_KEY: {
+    u8 button = to_button(event.code);
+    if (button != NO_BUTTON) {
+      // 2 is an autorepeat, still pressed
+      this->pending.set_button(static_cast<PS4Button>(button), event.value);
+    }
+    break;
+  }
+
+  case EV_ABS:
+    switch (event.code) {
+    case PS4Stick::LEFT_X:
+    case PS4Stick::LEFT_Y:
+    case PS4Stick::RIGHT_X:
+    case PS4Stick::RIGHT_Y:
+      this->pending.set_stick(
+          static_cast<PS4Stick>(event.code), std::clamp(event.value, 0, 0xff)
+      );
+      break;
+
+    case PS4DPad::X:
+    case PS4DPad::Y:
+      this->pending.set_dpad(
+          static_cast<PS4DPad>(event.code), to_dpad(event.value)
+      );
+      break;
+
+    default:
+      break;
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+template <typename Sink>
+void BasicPassthrough<Sink>::resync(const PS4State& fallback) noexcept {
+  this->pending = fallback;
+  if (!this->owned) {
+    // Not an evdev node, the next frames will have to correct the state
+    return;
+  }
+
+  std::array<u8, KEY_MAX / 8 + 1> keys{};
+  if (ioctl(this->fd, EVIOCGKEY(keys.size()), keys.data()) != -1) {
+    for (u16 code = BTN_SOUTH; code <= BTN_THUMBR; ++code) {
+      u8 button = to_button(code);
+      if (button != NO_BUTTON) {
+        this->pending.set_button(
+            static_cast<PS4Button>(button), (keys[code / 8] >> (code % 8)) & 1U
+        );
+      }
+    }
+  }
+
+  for (const auto& stick : {
+           PS4Stick::LEFT_X,
+           PS4Stick::LEFT_Y,
+           PS4Stick::RIGHT_X,
+           PS4Stick::RIGHT_Y,
+       }) {
+    input_absinfo info{};
+    if (ioctl(this->fd, EVIOCGABS(stick), &info) != -1) {
+      this->pending.set_stick(stick, std::clamp(info.value, 0, 0xff));
+    }
+  }
+
+  for (const auto& dpad : {PS4DPad::X, PS4DPad::Y}) {
+    input_absinfo info{};
+    if (ioctl(this->fd, EVIOCGABS(dpad), &info) != -1) {
+      this->pending.set_dpad(dpad, to_dpad(info.value));
+    }
+  }
+}
+
+template <typename Sink> void BasicPassthrough<Sink>::close_fd() noexcept {
+  if (this->fd == -1) {
+    return;
+  }
+
+  if (this->owned) {
+    if (this->grabbed) {
+      ioctl(this->fd, EVIOCGRAB, 0);
+    }
+    close(this->fd);
+  }
+
+  this->fd = -1;
+  this->owned = false;
+  this->grabbed = false;
+}
+
+template class BasicPassthrough<uinput::UinputSink>;
+template class BasicPassthrough<uinput::NullSink>;
+template class BasicPassthrough<uinput::RingSink>;
+template class BasicPassthrough<uinput::FileSink>;
+
+} // namespace vc
@@ -0,0 +1,101 @@
+#ifndef VC_CONTROLLER_PASSTHROUGH_HPP
+#define VC_CONTROLLER_PASSTHROUGH_HPP
+
+#include "../timing/histogram.hpp"
+#include "../types.hpp"
+#include "./ps4.hpp"
+#include <array>
+#include <linux/input.h>
+
+namespace vc {
+
+/**
+ * Proxies a physical pad into a virtual controller so its remapping applies
+ * to a real device too.
+ * Events are read in bulk into a reusable buffer and folded into a PS4State,
+ * every SYN_REPORT applies it to the controller, so a source frame becomes
+ * one write of only the changed codes (mapped through the controller).
+ *
+ * (void)proxy.open("/dev/input/event5", true);
+ * while (running) {
+ *   if (proxy.wait(100)) {
+ *     proxy.pump(controller);
+ *   }
+ * }
+ *
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicPassthrough {
+public:
+  BasicPassthrough() noexcept = default;
+  BasicPassthrough(const BasicPassthrough&) = delete;
+  BasicPassthrough& operator=(const BasicPassthrough&) = delete;
+
+  BasicPassthrough(BasicPassthrough&& other) noexcept;
+  BasicPassthrough& operator=(BasicPassthrough&& rhs) noexcept;
+
+  ~BasicPassthrough() noexcept;
+
+  /**
+   * Opens an evdev node, its timestamps are switched to CLOCK_MONOTONIC so
+   * the forwarding latency can be measured
+   * @param grab - other readers of the node won't see its events anymore,
+   *   avoids games seeing both the physical and the virtual pad
+   */
+  [[nodiscard]] error_code open(const c8* path, bool grab) noexcept;
+
+  /**
+   * Reads raw input_event structs from an fd not owned by the passthrough,
+   * ie. a pipe fed by a FileSink or another process. Should be non blocking
+   */
+  void set_fd(i32 fd) noexcept;
+
+  // Blocks until there is something to read, false on timeout or error
+  [[nodiscard]] bool wait(i32 timeout_ms) const noexcept;
+
+  /**
+   * Reads everything available without blocking and forwards every complete
+   * frame to the controller
+   * @return number of frames forwarded
+   */
+  usize pump(BasicPS4Controller<Sink>& controller) noexcept;
+
+  /**
+   * Time from the kernel timestamp of a frame until it was written. For fds
+   * that are not evdev nodes, the time from the read until it was written
+   */
+  [[nodiscard]] const timing::Histogram& get_latency() const noexcept;
+  // Number of times the kernel dropped events because we read too slowly
+  [[nodiscard]] u64 get_dropped() const noexcept;
+
+private:
+  static constexpr usize BUFFER_SIZE = 256U;
+
+  std::array<input_event, BUFFER_SIZE> buffer{};
+  PS4State pending{};
+  timing::Histogram latency{};
+  u64 dropped = 0U;
+
+  i32 fd = -1;
+  bool owned = false;
+  bool grabbed = false;
+  bool primed = false;
+  // Events are discarded until the next SYN_REPORT after a SYN_DROPPED
+  bool dropping = false;
+
+  void handle_event(const input_event& event) noexcept;
+  // Reads the current state of the device after events were dropped
+  void resync(const PS4State& fallback) noexcept;
+  void close_fd() noexcept;
+};
+
+using Passthrough = BasicPassthrough<uinput::UinputSink>;
+
+extern template class BasicPassthrough<uinput::UinputSink>;
+extern template class BasicPassthrough<uinput::NullSink>;
+extern template class BasicPassthrough<uinput::RingSink>;
+extern template class BasicPassthrough<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
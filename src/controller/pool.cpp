@@ -0,0 +1,285 @@
+#include "./pool.hpp"
+#include "../helper.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <utility>
+
+namespace vc {
+
+template <typename Sink>
+BasicControllerPool<Sink>::BasicControllerPool(BasicControllerPool&& other
+) noexcept
+    : controllers(std::move(other.controllers)),
+      keyboards(std::move(other.keyboards)),
+      epoll_fd(other.epoll_fd),
+      timer_fd(other.timer_fd),
+      event_fd(other.event_fd),
+      overruns(other.overruns),
+      dump_file(other.dump_file),
+      dump_interval(other.dump_interval),
+      next_dump(other.next_dump) {
+  other.epoll_fd = -1;
+  other.timer_fd = -1;
+  other.event_fd = -1;
+}
+
+template <typename Sink>
+BasicControllerPool<Sink>&
+BasicControllerPool<Sink>::operator=(BasicControllerPool&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close_fds();
+
+  this->controllers = std::move(rhs.controllers);
+  this->keyboards = std::move(rhs.keyboards);
+  this->epoll_fd = rhs.epoll_fd;
+  this->timer_fd = rhs.timer_fd;
+  this->event_fd = rhs.event_fd;
+  this->overruns = rhs.overruns;
+  this->dump_file = rhs.dump_file;
+  this->dump_interval = rhs.dump_interval;
+  this->next_dump = rhs.next_dump;
+  rhs.epoll_fd = -1;
+  rhs.timer_fd = -1;
+  rhs.event_fd = -1;
+
+  return *this;
+}
+
+template <typename Sink>
+BasicControllerPool<Sink>::~BasicControllerPool() noexcept {
+  this->close_fds();
+}
+
+template <typename Sink>
+void BasicControllerPool<Sink>::close_fds() noexcept {
+  for (i32* fd : {&this->epoll_fd, &this->timer_fd, &this->event_fd}) {
+    if (*fd != -1) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+template <typename Sink>
+error_code BasicControllerPool<Sink>::init(
+    usize controllers, usize keyboards, const c8* name, bool is_pro,
+    bool motion_sensors
+) noexcept {
+  // Sized upfront so the devices never move once created
+  this->controllers.resize(controllers);
+  this->keyboards.resize(keyboards);
+
+  std::array<c8, UINPUT_MAX_NAME_SIZE> device_name{};
+  for (usize i = 0U; i < controllers; ++i) {
+    snprintf(device_name.data(), device_name.size(), "%s %zu", name, i);
+    TRY_CODE(this->controllers[i].init(
+        device_name.data(), is_pro, false, motion_sensors
+    ));
+  }
+
+  for (auto& keyboard : this->keyboards) {
+    TRY_CODE(keyboard.init());
+  }
+
+  return error::OK;
+}
+
+template <typename Sink>
+error_code BasicControllerPool<Sink>::wait_ready(i32 timeout_ms) noexcept {
+  i64 deadline = timing::now_ns() + timeout_ms * timing::NS_PER_MS;
+  auto remaining = [deadline] {
+    return static_cast<i32>(
+        std::max<i64>(deadline - timing::now_ns(), 0) / timing::NS_PER_MS
+    );
+  };
+
+  for (auto& controller : this->controllers) {
+    TRY_CODE(controller.wait_ready(remaining()));
+  }
+  for (auto& keyboard : this->keyboards) {
+    TRY_CODE(keyboard.wait_ready(remaining()));
+  }
+
+  return error::OK;
+}
+
+template <typename Sink>
+error_code BasicControllerPool<Sink>::start(u32 hz) noexcept {
+  if (hz == 0U || hz > 1'000U) {
+    return error::SCHEDULER_RATE;
+  }
+
+  // Restarting replaces the timer of the previous start
+  this->close_fds();
+  this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  this->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  this->event_fd = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (this->epoll_fd == -1 || this->timer_fd == -1 || this->event_fd == -1) {
+    return error::WORKER_CREATE;
+  }
+
+  for (i32 fd : {this->timer_fd, this->event_fd}) {
+    epoll_event event{.events = EPOLLIN, .data = {.fd = fd}};
+    if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      return error::WORKER_CREATE;
+    }
+  }
+
+  timespec period = timing::to_timespec(timing::NS_PER_S / hz);
+  itimerspec timer{.it_interval = period, .it_value = period};
+  if (timerfd_settime(this->timer_fd, 0, &timer, nullptr) == -1) {
+    return error::WORKER_CREATE;
+  }
+
+  this->overruns = 0U;
+  return error::OK;
+}
+
+template <typename Sink> usize BasicControllerPool<Sink>::flush() noexcept {
+  usize flushed = 0U;
+  i64 now = 0;
+  for (auto& controller : this->controllers) {
+    if (controller.has_pending()) {
+      controller.sync();
+      ++flushed;
+    }
+
+    auto* sensors = controller.get_motion_sensors();
+    if (sensors != nullptr) {
+      now = now == 0 ? timing::now_ns() : now;
+      flushed += sensors->update(now) != 0U;
+    }
+  }
+
+  for (auto& keyboard : this->keyboards) {
+    if (keyboard.has_pending()) {
+      keyboard.sync();
+      ++flushed;
+    }
+  }
+
+  return flushed;
+}
+
+template <typename Sink> u64 BasicControllerPool<Sink>::wait() noexcept {
+  std::array<epoll_event, 2> events{};
+  i32 count = -1;
+  do {
+    count = epoll_wait(this->epoll_fd, events.data(), events.size(), -1);
+  } while (count == -1 && errno == EINTR);
+
+  u64 ticks = 0U;
+  for (i32 i = 0; i < count; ++i) {
+    u64 value = 0U;
+    if (read(events[i].data.fd, &value, sizeof(value)) == -1) {
+      continue;
+    }
+
+    if (events[i].data.fd == this->timer_fd) {
+      ticks = value;
+    }
+  }
+
+  if (ticks > 1U) {
+    this->overruns += ticks - 1U;
+  }
+
+  if (this->dump_file != nullptr && ticks != 0U) {
+    i64 now = timing::now_ns();
+    if (now >= this->next_dump) {
+      this->dump_stats(this->dump_file, false);
+      this->next_dump = now + this->dump_interval;
+    }
+  }
+
+  return ticks;
+}
+
+template <typename Sink> void BasicControllerPool<Sink>::wake() const noexcept {
+  u64 one = 1U;
+  (void)write(this->event_fd, &one, sizeof(one));
+}
+
+template <typename Sink>
+uinput::StatsSnapshot BasicControllerPool<Sink>::get_stats() const noexcept {
+  uinput::StatsSnapshot total{};
+  for (const auto& controller : this->controllers) {
+    total.merge(controller.get_stats());
+  }
+  for (const auto& keyboard : this->keyboards) {
+    total.merge(keyboard.get_stats());
+  }
+  return total;
+}
+
+template <typename Sink>
+void BasicControllerPool<Sink>::dump_stats(FILE* file, bool detailed)
+    const noexcept {
+  if (detailed) {
+    std::array<c8, 32> name{};
+    for (usize i = 0U; i < this->controllers.size(); ++i) {
+      snprintf(name.data(), name.size(), "controller %zu", i);
+      this->controllers[i].get_stats().print(file, name.data());
+    }
+    for (usize i = 0U; i < this->keyboards.size(); ++i) {
+      snprintf(name.data(), name.size(), "keyboard %zu", i);
+      this->keyboards[i].get_stats().print(file, name.data());
+    }
+  }
+
+  this->get_stats().print(file, "total");
+  fflush(file);
+}
+
+template <typename Sink>
+void BasicControllerPool<Sink>::set_stats_dump(
+    FILE* file, i64 interval_ns
+) noexcept {
+  this->dump_file = interval_ns > 0 ? file : nullptr;
+  this->dump_interval = interval_ns;
+  this->next_dump = timing::now_ns() + interval_ns;
+}
+
+template <typename Sink>
+BasicPS4Controller<Sink>&
+BasicControllerPool<Sink>::get_controller(usize index) noexcept {
+  return this->controllers[index];
+}
+
+template <typename Sink>
+BasicKeyboard<Sink>& BasicControllerPool<Sink>::get_keyboard(usize index
+) noexcept {
+  return this->keyboards[index];
+}
+
+template <typename Sink>
+usize BasicControllerPool<Sink>::get_controller_count() const noexcept {
+  return this->controllers.size();
+}
+
+template <typename Sink>
+usize BasicControllerPool<Sink>::get_keyboard_count() const noexcept {
+  return this->keyboards.size();
+}
+
+template <typename Sink>
+u64 BasicControllerPool<Sink>::get_overruns() const noexcept {
+  return this->overruns;
+}
+
+template class BasicControllerPool<uinput::UinputSink>;
+template class BasicControllerPool<uinput::NullSink>;
+template class BasicControllerPool<uinput::RingSink>;
+template class BasicControllerPool<uinput::FileSink>;
+
+} // namespace vc
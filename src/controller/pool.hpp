@@ -0,0 +1,123 @@
+#ifndef VC_CONTROLLER_POOL_HPP
+#define VC_CONTROLLER_POOL_HPP
+
+#include "../types.hpp"
+#include "./keyboard.hpp"
+#include "./ps4.hpp"
+#include <cstdio>
+#include <vector>
+
+namespace vc {
+
+/**
+ * Owns many devices and flushes them from a single thread.
+ * The devices are stored contiguously along with their frame buffers, each
+ * tick every device with pending events costs exactly one write.
+ *
+ * (void)pool.init(256U, 0U, "Simulated PS4 Controller", true);
+ * (void)pool.wait_ready(5'000);
+ * (void)pool.start(250U);
+ * while (running) {
+ *   pool.get_controller(i).press_button(...);
+ *   pool.flush();
+ *   pool.wait();
+ * }
+ *
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicControllerPool {
+public:
+  BasicControllerPool() noexcept = default;
+  BasicControllerPool(const BasicControllerPool&) = delete;
+  BasicControllerPool& operator=(const BasicControllerPool&) = delete;
+
+  BasicControllerPool(BasicControllerPool&& other) noexcept;
+  BasicControllerPool& operator=(BasicControllerPool&& rhs) noexcept;
+
+  ~BasicControllerPool() noexcept;
+
+  /**
+   * Creates the devices, controllers are named "<name> <index>"
+   * @param controllers - number of PS4 controllers
+   * @param keyboards - number of keyboards
+   * @param motion_sensors - gives every controller its motion sensor node
+   */
+  [[nodiscard]] error_code init(
+      usize controllers, usize keyboards, const c8* name, bool is_pro,
+      bool motion_sensors = false
+  ) noexcept;
+
+  /**
+   * Waits until every device can be opened by readers. The devices were all
+   * created by init, so they come up in parallel and the timeout is shared
+   */
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+
+  // Starts the tick timer, hz in [1, 1000]. Calling it again restarts it
+  [[nodiscard]] error_code start(u32 hz) noexcept;
+
+  /**
+   * Syncs every device with pending events and writes the motion samples
+   * that are due, see controller/motion_sensor.hpp
+   * @return number of devices flushed
+   */
+  usize flush() noexcept;
+
+  /**
+   * Blocks until the next tick or a wake call
+   * @return number of ticks elapsed since the last wait, more than 1 means
+   *   ticks were missed, 0 if woken up by wake
+   */
+  u64 wait() noexcept;
+
+  // Unblocks wait, can be called from any thread
+  void wake() const noexcept;
+
+  [[nodiscard]] BasicPS4Controller<Sink>& get_controller(usize index) noexcept;
+  [[nodiscard]] BasicKeyboard<Sink>& get_keyboard(usize index) noexcept;
+  [[nodiscard]] usize get_controller_count() const noexcept;
+  [[nodiscard]] usize get_keyboard_count() const noexcept;
+  // Number of ticks that were missed since start
+  [[nodiscard]] u64 get_overruns() const noexcept;
+
+  // Counters of every device added together
+  [[nodiscard]] uinput::StatsSnapshot get_stats() const noexcept;
+
+  /**
+   * Prints the counters of every device, then their total
+   * @param detailed - false to only print the total
+   */
+  void dump_stats(FILE* file, bool detailed) const noexcept;
+
+  /**
+   * Makes wait dump the stats (totals only) once every interval, nullptr or
+   * an interval of 0 to stop
+   */
+  void set_stats_dump(FILE* file, i64 interval_ns) noexcept;
+
+private:
+  std::vector<BasicPS4Controller<Sink>> controllers{};
+  std::vector<BasicKeyboard<Sink>> keyboards{};
+
+  i32 epoll_fd = -1;
+  i32 timer_fd = -1;
+  i32 event_fd = -1;
+  u64 overruns = 0U;
+
+  FILE* dump_file = nullptr;
+  i64 dump_interval = 0;
+  i64 next_dump = 0;
+
+  void close_fds() noexcept;
+};
+
+using ControllerPool = BasicControllerPool<uinput::UinputSink>;
+
+extern template class BasicControllerPool<uinput::UinputSink>;
+extern template class BasicControllerPool<uinput::NullSink>;
+extern template class BasicControllerPool<uinput::RingSink>;
+extern template class BasicControllerPool<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef VC_CONTROLLER_PROFILE_HPP
+#define VC_CONTROLLER_PROFILE_HPP
+
+#include "../types.hpp"
+#include <array>
+#include <limits>
+#include <linux/input-event-codes.h>
+#include <type_traits>
+
+/**
+ * A device profile describes a gamepad at compile time, BasicGamepad
+ * generates its uinput setup, code tables and state layout from it:
+ *   using Button, Stick, Hat            - enums of the public API, Button
+ *                                         values are indices into BUTTONS,
+ *                                         Stick and Hat values are ABS codes
+ *   u16 VENDOR, PRODUCT, PRO_PRODUCT    - PRO_PRODUCT is used when init is
+ *                                         called with is_pro
+ *   std::array<u16, N> BUTTONS          - default code of every Button
+ *   std::array<AxisRange, N> STICKS     - sticks and analog triggers
+ *   std::array<AxisRange, N> HATS       - d-pads, [-1, 1]
+ *   std::array<u16, N> FF_EFFECTS       - advertised force feedback effects
+ */
+
+namespace vc {
+
+struct AxisRange {
+  u16 code;
+  i32 min;
+  i32 max;
+  i32 neutral;
+};
+
+namespace profile {
+
+// Smallest unsigned type with a bit per button
+template <usize N>
+using bits_t = std::conditional_t<
+    N <= 8U, u8,
+    std::conditional_t<
+        N <= 16U, u16, std::conditional_t<N <= 32U, u32, u64>>>;
+
+template <typename T, usize N>
+[[nodiscard]] constexpr bool
+fits(const std::array<AxisRange, N>& ranges) noexcept {
+  for (const auto& range : ranges) {
+    if (range.min < static_cast<i32>(std::numeric_limits<T>::min()) ||
+        range.max > static_cast<i32>(std::numeric_limits<T>::max())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Smallest type holding every value of the ranges
+template <const auto& RANGES>
+using axis_t = std::conditional_t<
+    fits<u8>(RANGES), u8,
+    std::conditional_t<
+        fits<i8>(RANGES), i8,
+        std::conditional_t<
+            fits<u16>(RANGES), u16,
+            std::conditional_t<fits<i16>(RANGES), i16, i32>>>>;
+
+/**
+ * ABS code of the ranges to its position, by arithmetic like a hand written
+ * mapping: the distance to the first code minus the gaps below the code.
+ * Built at compile time from increasing codes, gaps of 0 never change it
+ */
+template <usize N> struct CodeMap {
+  u16 first = 0U;
+  // First code after each gap and the number of codes skipped
+  std::array<u16, N> after{};
+  std::array<u16, N> gap{};
+
+  [[nodiscard]] constexpr usize operator()(u16 code) const noexcept {
+    usize index = code - this->first;
+    for (usize i = 0U; i < N; ++i) {
+      index -= code >= this->after[i] ? this->gap[i] : 0U;
+    }
+    return index;
+  }
+};
+
+template <usize N>
+[[nodiscard]] constexpr bool
+is_increasing(const std::array<AxisRange, N>& ranges) noexcept {
+  for (usize i = 1U; i < N; ++i) {
+    if (ranges[i].code <= ranges[i - 1U].code) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <usize N>
+[[nodiscard]] constexpr CodeMap<N>
+map_of(const std::array<AxisRange, N>& ranges) noexcept {
+  CodeMap<N> map{.first = ranges[0].code};
+  for (usize i = 1U; i < N; ++i) {
+    map.after[i] = ranges[i].code;
+    map.gap[i] = static_cast<u16>(ranges[i].code - ranges[i - 1U].code - 1U);
+  }
+  return map;
+}
+
+template <typename T, usize N>
+[[nodiscard]] constexpr std::array<T, N>
+neutral_of(const std::array<AxisRange, N>& ranges) noexcept {
+  std::array<T, N> values{};
+  for (usize i = 0U; i < N; ++i) {
+    values[i] = static_cast<T>(ranges[i].neutral);
+  }
+  return values;
+}
+
+} // namespace profile
+
+/**
+ * Packed snapshot of a gamepad of the profile.
+ * Buttons are stored as a bitset indexed by Button, the axes in the order of
+ * the profile with the smallest type fitting their ranges
+ */
+template <typename Profile> struct PadState {
+  using Button = typename Profile::Button;
+  using Stick = typename Profile::Stick;
+  using Hat = typename Profile::Hat;
+  using Buttons = profile::bits_t<Profile::BUTTONS.size()>;
+  using Axis = profile::axis_t<Profile::STICKS>;
+
+  static_assert(
+      profile::is_increasing(Profile::STICKS) &&
+          profile::is_increasing(Profile::HATS),
+      "The codes of the sticks and hats must be increasing"
+  );
+  static constexpr auto STICK_MAP = profile::map_of(Profile::STICKS);
+  static constexpr auto HAT_MAP = profile::map_of(Profile::HATS);
+
+  Buttons buttons = 0U;
+  std::array<Axis, Profile::STICKS.size()> sticks =
+      profile::neutral_of<Axis>(Profile::STICKS);
+  std::array<i8, Profile::HATS.size()> hats{};
+
+  // PS4 maps LEFT_X, LEFT_Y, RIGHT_X, RIGHT_Y to 0, 1, 2, 3 as stick - 1
+  // past LEFT_Y, contiguous codes are only an offset
+  [[nodiscard]] static constexpr usize stick_index(Stick stick) noexcept {
+    return STICK_MAP(stick);
+  }
+
+  [[nodiscard]] static constexpr usize hat_index(Hat hat) noexcept {
+    return HAT_MAP(hat);
+  }
+
+  void set_button(Button button, bool press) noexcept {
+    auto bit = static_cast<Buttons>(Buttons{1U} << button);
+    this->buttons = press ? this->buttons | bit : this->buttons & ~bit;
+  }
+
+  [[nodiscard]] bool is_button_pressed(Button button) const noexcept {
+    return (this->buttons >> button) & 1U;
+  }
+
+  void set_stick(Stick stick, Axis value) noexcept {
+    this->sticks[stick_index(stick)] = value;
+  }
+
+  [[nodiscard]] Axis get_stick(Stick stick) const noexcept {
+    return this->sticks[stick_index(stick)];
+  }
+
+  void set_dpad(Hat hat, i8 value) noexcept {
+    this->hats[hat_index(hat)] = value;
+  }
+
+  [[nodiscard]] i8 get_dpad(Hat hat) const noexcept {
+    return this->hats[hat_index(hat)];
+  }
+
+  [[nodiscard]] bool operator==(const PadState& rhs) const noexcept {
+    return this->buttons == rhs.buttons && this->sticks == rhs.sticks &&
+           this->hats == rhs.hats;
+  }
+
+  [[nodiscard]] bool operator!=(const PadState& rhs) const noexcept {
+    return !(*this == rhs);
+  }
+};
+
+} // namespace vc
+
+#endif
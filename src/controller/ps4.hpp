@@ -2,6 +2,9 @@
 #define VC_CONTROLLER_PS4_HPP
 
 #include "../types.hpp"
+#include "../uinput/sink.hpp"
+#include "./gamepad.hpp"
+#include "./profile.hpp"
 #include <array>
 #include <linux/input-event-codes.h>
 
@@ -55,89 +58,60 @@ enum PS4DPad : u8 {
   Y = ABS_HAT0Y,
 };
 
-class PS4Controller {
-public:
-  PS4Controller() noexcept = default;
-  PS4Controller(const PS4Controller&) = delete;
-  PS4Controller& operator=(const PS4Controller&) = delete;
-
-  PS4Controller(PS4Controller&& other) noexcept;
-  PS4Controller& operator=(PS4Controller&& rhs) noexcept;
-
-  ~PS4Controller() noexcept;
-
-  [[nodiscard]] error_code init(const c8* name, bool is_pro) noexcept;
-
-  // Needs to be called everytime an action is called
-  void sync() const noexcept;
-
-  void remap(PS4Button button, u16 code) noexcept;
-
-  // Call sync to register the button press
-  void press_button(PS4Button button) noexcept;
-  // Call sync to register the button release
-  void release_button(PS4Button button) noexcept;
-
-  // Call sync to register the button press
-  void press_up() noexcept;
-  // Call sync to register the button press
-  void press_down() noexcept;
-  // Call sync to register the button press
-  void press_left() noexcept;
-  // Call sync to register the button press
-  void press_right() noexcept;
-
-  // Call sync to register the button release
-  void release_up() noexcept;
-  // Call sync to register the button release
-  void release_down() noexcept;
-  // Call sync to register the button release
-  void release_left() noexcept;
-  // Call sync to register the button release
-  void release_right() noexcept;
-
-  /**
-   * Call sync to register the move stick action
-   * @param stick
-   * @param value - default set to the neutral value position
-   */
-  void move_stick(PS4Stick stick, u8 value = 0x7f) noexcept;
-
-  /**
-   * Call sync to register the move stick action
-   * @param stick
-   * @param value - [0.0F, 1.0F], will clamp the value if it exceeds the value
-   */
-  void move_stickf(PS4Stick stick, float value) noexcept;
-
-  [[nodiscard]] bool is_button_pressed(PS4Button button) const noexcept;
-  [[nodiscard]] u8 get_stick_u8(PS4Stick stick) const noexcept;
-  [[nodiscard]] f32 get_stick_f32(PS4Stick stick) const noexcept;
-  [[nodiscard]] u8 get_dpad(PS4DPad dpad) const noexcept;
-
-  void print() const noexcept;
-
-private:
-  i32 fd = -1;
-
-  std::array<u16, 13> mapping{
+struct PS4Profile {
+  using Button = PS4Button;
+  using Stick = PS4Stick;
+  using Hat = PS4DPad;
+
+  static constexpr u16 VENDOR = 0x054c;
+  static constexpr u16 PRODUCT = 0x05c4;
+  static constexpr u16 PRO_PRODUCT = 0x09cc;
+
+  // Codes emitted for each PS4Button before any remap
+  static constexpr std::array<u16, 13> BUTTONS{
       BTN_SOUTH,  BTN_EAST,   BTN_WEST, BTN_NORTH,  BTN_TL,
       BTN_TR,     BTN_TL2,    BTN_TR2,  BTN_SELECT, BTN_START,
       BTN_THUMBR, BTN_THUMBL, BTN_MODE,
   };
-  std::array<bool, 13> buttons{false};
 
-  u8 left_x = 0x7f;
-  u8 left_y = 0x7f;
-  u8 right_x = 0x7f;
-  u8 right_y = 0x7f;
-  u8 dpad_x = 0x7f;
-  u8 dpad_y = 0x7f;
+  static constexpr std::array<AxisRange, 4> STICKS{
+      AxisRange{
+          .code = PS4Stick::LEFT_X, .min = 0, .max = 0xff, .neutral = 0x7f
+      },
+      AxisRange{
+          .code = PS4Stick::LEFT_Y, .min = 0, .max = 0xff, .neutral = 0x7f
+      },
+      AxisRange{
+          .code = PS4Stick::RIGHT_X, .min = 0, .max = 0xff, .neutral = 0x7f
+      },
+      AxisRange{
+          .code = PS4Stick::RIGHT_Y, .min = 0, .max = 0xff, .neutral = 0x7f
+      },
+  };
+
+  static constexpr std::array<AxisRange, 2> HATS{
+      AxisRange{.code = PS4DPad::X, .min = -1, .max = 1, .neutral = 0},
+      AxisRange{.code = PS4DPad::Y, .min = -1, .max = 1, .neutral = 0},
+  };
 
-  void handle_button(u16 button, bool press) const noexcept;
-  void handle_analog(u16 type, u8 value) const noexcept;
+  static constexpr std::array<u16, 6> FF_EFFECTS{
+      FF_RUMBLE, FF_PERIODIC, FF_SQUARE, FF_TRIANGLE, FF_SINE, FF_GAIN,
+  };
 };
 
+// Fits in 8 bytes, buttons are a bitset indexed by PS4Button
+using PS4State = PadState<PS4Profile>;
+static_assert(sizeof(PS4State) == 8U);
+
+template <typename Sink>
+using BasicPS4Controller = BasicGamepad<PS4Profile, Sink>;
+using PS4Controller = BasicPS4Controller<uinput::UinputSink>;
+
+extern template class BasicGamepad<PS4Profile, uinput::UinputSink>;
+extern template class BasicGamepad<PS4Profile, uinput::NullSink>;
+extern template class BasicGamepad<PS4Profile, uinput::RingSink>;
+extern template class BasicGamepad<PS4Profile, uinput::FileSink>;
+
 } // namespace vc
 
 // evtest info of r
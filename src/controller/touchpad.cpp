@@ -0,0 +1,333 @@
+#include "./touchpad.hpp"
+#include "../helper.hpp"
+#include "./ps4.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <linux/input-event-codes.h>
+#include <linux/uinput.h>
+#include <utility>
+
+namespace vc {
+
+namespace {
+
+// Tool reported for 1 to 5 fingers
+constexpr std::array<u16, 5> TOOLS{
+    BTN_TOOL_FINGER, BTN_TOOL_DOUBLETAP, BTN_TOOL_TRIPLETAP,
+    BTN_TOOL_QUADTAP, BTN_TOOL_QUINTTAP,
+};
+
+[[nodiscard]] uinput_abs_setup to_abs_setup(u16 code, i32 max) noexcept {
+  return uinput_abs_setup{
+      .code = code,
+      .absinfo =
+          {
+              .value = 0,
+              .minimum = 0,
+              .maximum = max,
+              .fuzz = 0,
+              .flat = 0,
+              .resolution = 0,
+          },
+  };
+}
+
+// Position written for a coordinate, clamped to the surface
+[[nodiscard]] i32 to_unit(f32 value, i32 size) noexcept {
+  return std::clamp(static_cast<i32>(std::lround(value)), 0, size - 1);
+}
+
+} // namespace
+
+template <typename Sink>
+BasicTouchpad<Sink>::BasicTouchpad(BasicTouchpad&& other) noexcept
+    : sink(std::move(other.sink)),
+      size(other.size),
+      frame(other.frame),
+      contacts(other.contacts),
+      pressed(other.pressed),
+      next_tracking(other.next_tracking),
+      reported(other.reported),
+      backpressure(other.backpressure),
+      stats(other.stats) {
+  other.frame.clear();
+}
+
+template <typename Sink>
+BasicTouchpad<Sink>& BasicTouchpad<Sink>::operator=(BasicTouchpad&& rhs
+) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->sink = std::move(rhs.sink);
+  this->size = rhs.size;
+  this->frame = rhs.frame;
+  this->contacts = rhs.contacts;
+  this->pressed = rhs.pressed;
+  this->next_tracking = rhs.next_tracking;
+  this->reported = rhs.reported;
+  this->backpressure = rhs.backpressure;
+  this->stats = rhs.stats;
+  rhs.frame.clear();
+
+  return *this;
+}
+
+template <typename Sink>
+error_code
+BasicTouchpad<Sink>::init(const c8* name, const TouchpadSize& size) noexcept {
+  this->size = size;
+  this->size.slots = std::clamp<u8>(size.slots, 1U, SLOTS_MAX);
+
+  TRY_CODE(this->sink.open());
+
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_KEY));
+  TRY_CODE(this->sink.enable(UI_SET_KEYBIT, BTN_LEFT));
+  TRY_CODE(this->sink.enable(UI_SET_KEYBIT, BTN_TOUCH));
+  for (usize i = 0U; i < this->size.slots; ++i) {
+    TRY_CODE(this->sink.enable(UI_SET_KEYBIT, TOOLS[i]));
+  }
+
+  i32 max_x = this->size.width - 1;
+  i32 max_y = this->size.height - 1;
+  const std::array<uinput_abs_setup, 6> axes{
+      to_abs_setup(ABS_X, max_x),
+      to_abs_setup(ABS_Y, max_y),
+      to_abs_setup(ABS_MT_SLOT, this->size.slots - 1),
+      to_abs_setup(ABS_MT_TRACKING_ID, 0xffff),
+      to_abs_setup(ABS_MT_POSITION_X, max_x),
+      to_abs_setup(ABS_MT_POSITION_Y, max_y),
+  };
+  TRY_CODE(this->sink.enable(UI_SET_EVBIT, EV_ABS));
+  for (const auto& axis : axes) {
+    TRY_CODE(this->sink.enable(UI_SET_ABSBIT, axis.code));
+    TRY_CODE(this->sink.setup_abs(axis));
+  }
+
+  TRY_CODE(this->sink.enable(UI_SET_PROPBIT, INPUT_PROP_POINTER));
+  TRY_CODE(this->sink.enable(UI_SET_PROPBIT, INPUT_PROP_BUTTONPAD));
+
+  uinput_setup setup{
+      .id =
+          {
+              .bustype = BUS_USB,
+              .vendor = PS4Profile::VENDOR,
+              .product = PS4Profile::PRODUCT,
+              .version = 1,
+          },
+      .name = {},
+      .ff_effects_max = 0U,
+  };
+  std::strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1U);
+
+  TRY_CODE(this->sink.create(setup));
+
+  return error::OK;
+}
+
+template <typename Sink>
+error_code BasicTouchpad<Sink>::wait_ready(i32 timeout_ms) noexcept {
+  return this->sink.wait_ready(timeout_ms);
+}
+
+template <typename Sink>
+void BasicTouchpad<Sink>::touch(u8 slot, f32 x, f32 y) noexcept {
+  if (slot >= this->size.slots) {
+    return;
+  }
+
+  auto& contact = this->contacts[slot];
+  contact.x = x;
+  contact.y = y;
+  if (contact.tracking == NO_CONTACT) {
+    contact.tracking = this->next_tracking++;
+  }
+}
+
+template <typename Sink>
+void BasicTouchpad<Sink>::move(u8 slot, f32 x, f32 y) noexcept {
+  if (slot >= this->size.slots) {
+    return;
+  }
+
+  auto& contact = this->contacts[slot];
+  if (contact.tracking != NO_CONTACT) {
+    contact.x += x;
+    contact.y += y;
+  }
+}
+
+template <typename Sink> void BasicTouchpad<Sink>::lift(u8 slot) noexcept {
+  if (slot < this->size.slots) {
+    this->contacts[slot].tracking = NO_CONTACT;
+  }
+}
+
+template <typename Sink>
+bool BasicTouchpad<Sink>::is_touching(u8 slot) const noexcept {
+  return slot < this->size.slots &&
+         this->contacts[slot].tracking != NO_CONTACT;
+}
+
+template <typename Sink> void BasicTouchpad<Sink>::press() noexcept {
+  this->pressed = true;
+}
+
+template <typename Sink> void BasicTouchpad<Sink>::release() noexcept {
+  this->pressed = false;
+}
+
+template <typename Sink> void BasicTouchpad<Sink>::sync() noexcept {
+  Reported target = this->get_target();
+  const Reported& current = this->reported;
+
+  for (u8 slot = 0U; slot < this->size.slots; ++slot) {
+    const auto& next = target.contacts[slot];
+    const auto& previous = current.contacts[slot];
+    if (next.tracking == previous.tracking && next.x == previous.x &&
+        next.y == previous.y) {
+      continue;
+    }
+
+    if (target.slot != slot) {
+      this->queue_event(EV_ABS, ABS_MT_SLOT, slot);
+      target.slot = slot;
+    }
+    if (next.tracking != previous.tracking) {
+      this->queue_event(EV_ABS, ABS_MT_TRACKING_ID, next.tracking);
+    }
+    if (next.x != previous.x) {
+      this->queue_event(EV_ABS, ABS_MT_POSITION_X, next.x);
+    }
+    if (next.y != previous.y) {
+      this->queue_event(EV_ABS, ABS_MT_POSITION_Y, next.y);
+    }
+  }
+
+  if ((target.fingers != 0U) != (current.fingers != 0U)) {
+    this->queue_event(EV_KEY, BTN_TOUCH, target.fingers != 0U);
+  }
+  if (target.fingers != current.fingers) {
+    if (current.fingers != 0U) {
+      this->queue_event(EV_KEY, TOOLS[current.fingers - 1U], 0);
+    }
+    if (target.fingers != 0U) {
+      this->queue_event(EV_KEY, TOOLS[target.fingers - 1U], 1);
+    }
+  }
+
+  if (target.x != current.x) {
+    this->queue_event(EV_ABS, ABS_X, target.x);
+  }
+  if (target.y != current.y) {
+    this->queue_event(EV_ABS, ABS_Y, target.y);
+  }
+  if (target.pressed != current.pressed) {
+    this->queue_event(EV_KEY, BTN_LEFT, target.pressed);
+  }
+
+  this->stats.record_frame();
+  this->queue_event(EV_SYN, SYN_REPORT, 0);
+  auto result = this->frame.flush(this->sink, this->stats, this->backpressure);
+  if (result == uinput::FlushResult::WRITTEN) {
+    this->reported = target;
+  } else {
+    // Carried events would interleave with the slots of the next frame,
+    // diffing against what was last fully written covers them instead
+    this->frame.reset();
+    this->reported.slot = NO_CONTACT;
+  }
+}
+
+template <typename Sink>
+bool BasicTouchpad<Sink>::has_pending() const noexcept {
+  Reported target = this->get_target();
+  const Reported& current = this->reported;
+
+  for (u8 slot = 0U; slot < this->size.slots; ++slot) {
+    const auto& next = target.contacts[slot];
+    const auto& previous = current.contacts[slot];
+    if (next.tracking != previous.tracking || next.x != previous.x ||
+        next.y != previous.y) {
+      return true;
+    }
+  }
+
+  return target.pressed != current.pressed;
+}
+
+template <typename Sink>
+void BasicTouchpad<Sink>::set_backpressure(
+    const uinput::BackpressurePolicy& policy
+) noexcept {
+  this->backpressure = policy;
+  this->stats.set_policy(policy.mode);
+}
+
+template <typename Sink>
+const uinput::BackpressurePolicy&
+BasicTouchpad<Sink>::get_backpressure() const noexcept {
+  return this->backpressure;
+}
+
+template <typename Sink>
+uinput::StatsSnapshot BasicTouchpad<Sink>::get_stats() const noexcept {
+  return this->stats.snapshot();
+}
+
+template <typename Sink> void BasicTouchpad<Sink>::reset_stats() noexcept {
+  this->stats.reset();
+}
+
+template <typename Sink> Sink& BasicTouchpad<Sink>::get_sink() noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+const Sink& BasicTouchpad<Sink>::get_sink() const noexcept {
+  return this->sink;
+}
+
+template <typename Sink>
+typename BasicTouchpad<Sink>::Reported
+BasicTouchpad<Sink>::get_target() const noexcept {
+  // Lifted slots and the pointer keep their last positions, like the kernel
+  Reported target = this->reported;
+  target.fingers = 0U;
+  bool pointer = false;
+
+  for (u8 slot = 0U; slot < this->size.slots; ++slot) {
+    const auto& contact = this->contacts[slot];
+    auto& next = target.contacts[slot];
+    next.tracking = contact.tracking;
+    if (contact.tracking == NO_CONTACT) {
+      continue;
+    }
+
+    next.x = to_unit(contact.x, this->size.width);
+    next.y = to_unit(contact.y, this->size.height);
+    ++target.fingers;
+    if (!pointer) {
+      target.x = next.x;
+      target.y = next.y;
+      pointer = true;
+    }
+  }
+
+  target.pressed = this->pressed;
+  return target;
+}
+
+template <typename Sink>
+void BasicTouchpad<Sink>::queue_event(u16 type, u16 code, i32 value) noexcept {
+  (void)this->frame.push(type, code, value);
+}
+
+template class BasicTouchpad<uinput::UinputSink>;
+template class BasicTouchpad<uinput::NullSink>;
+template class BasicTouchpad<uinput::RingSink>;
+template class BasicTouchpad<uinput::FileSink>;
+
+} // namespace vc
@@ -0,0 +1,143 @@
+#ifndef VC_CONTROLLER_TOUCHPAD_HPP
+#define VC_CONTROLLER_TOUCHPAD_HPP
+
+#include "../types.hpp"
+#include "../uinput/frame.hpp"
+#include "../uinput/sink.hpp"
+#include "../uinput/stats.hpp"
+#include <array>
+
+namespace vc {
+
+struct TouchpadSize {
+  // Surface of the DualShock 4 touchpad, positions are in [0, size - 1]
+  i32 width = 1920;
+  i32 height = 942;
+  // Fingers tracked at once, at most SLOTS_MAX
+  u8 slots = 2U;
+};
+
+/**
+ * Multitouch touchpad using type B slots, like the touchpad node of a
+ * DualShock 4. Positions are kept as floats and only the contacts that
+ * moved by a whole unit since the last frame are written, so any number of
+ * updates between two syncs becomes one frame with at most one
+ * ABS_MT_POSITION_X/Y per slot. The first finger down is also reported
+ * through ABS_X/ABS_Y for single touch readers.
+ *
+ * touchpad.touch(0U, 100.0F, 200.0F);
+ * touchpad.sync();
+ * touchpad.move(0U, 0.3F, 0.0F); // many times per tick
+ * touchpad.sync();               // once per tick
+ * touchpad.lift(0U);
+ * touchpad.sync();
+ *
+ * A finger that touches and lifts before a sync is never seen, sync in
+ * between for a tap.
+ * Sink is where the events are written to, see uinput/sink.hpp.
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicTouchpad {
+public:
+  static constexpr u8 SLOTS_MAX = 5U;
+
+  BasicTouchpad() noexcept = default;
+  BasicTouchpad(const BasicTouchpad&) = delete;
+  BasicTouchpad& operator=(const BasicTouchpad&) = delete;
+
+  BasicTouchpad(BasicTouchpad&& other) noexcept;
+  BasicTouchpad& operator=(BasicTouchpad&& rhs) noexcept;
+
+  ~BasicTouchpad() noexcept = default;
+
+  [[nodiscard]] error_code
+  init(const c8* name, const TouchpadSize& size = {}) noexcept;
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+
+  // Puts a finger down at the position, or moves it there if it is down
+  void touch(u8 slot, f32 x, f32 y) noexcept;
+  // Moves a finger that is down, fractions are kept for the next frames
+  void move(u8 slot, f32 x, f32 y) noexcept;
+  void lift(u8 slot) noexcept;
+  [[nodiscard]] bool is_touching(u8 slot) const noexcept;
+
+  // Clicks the whole pad, the button of a button pad
+  void press() noexcept;
+  void release() noexcept;
+
+  /**
+   * Writes what changed since the last frame the sink took in one frame.
+   * A frame that didn't fully reach the kernel is discarded and its
+   * changes are written again by the next sync
+   */
+  void sync() noexcept;
+
+  // Whether a sync would write something
+  [[nodiscard]] bool has_pending() const noexcept;
+
+  void set_backpressure(const uinput::BackpressurePolicy& policy) noexcept;
+  [[nodiscard]] const uinput::BackpressurePolicy&
+  get_backpressure() const noexcept;
+
+  // Counters of the writes so far, can be called from any thread
+  [[nodiscard]] uinput::StatsSnapshot get_stats() const noexcept;
+  void reset_stats() noexcept;
+
+  // Sinks may need to be configured before init
+  [[nodiscard]] Sink& get_sink() noexcept;
+  [[nodiscard]] const Sink& get_sink() const noexcept;
+
+private:
+  static constexpr i32 NO_CONTACT = -1;
+
+  struct Contact {
+    f32 x = 0.0F;
+    f32 y = 0.0F;
+    i32 tracking = NO_CONTACT;
+  };
+
+  struct ReportedContact {
+    i32 x = NO_CONTACT;
+    i32 y = NO_CONTACT;
+    i32 tracking = NO_CONTACT;
+  };
+
+  // What readers of the device see
+  struct Reported {
+    std::array<ReportedContact, SLOTS_MAX> contacts{};
+    // Slot the kernel routes ABS_MT_* to, NO_CONTACT if unknown
+    i32 slot = NO_CONTACT;
+    u8 fingers = 0U;
+    i32 x = NO_CONTACT;
+    i32 y = NO_CONTACT;
+    bool pressed = false;
+  };
+
+  Sink sink{};
+  TouchpadSize size{};
+  uinput::Frame<32> frame{};
+
+  std::array<Contact, SLOTS_MAX> contacts{};
+  bool pressed = false;
+  u16 next_tracking = 0U;
+  Reported reported{};
+
+  uinput::BackpressurePolicy backpressure{};
+  uinput::DeviceStats stats{};
+
+  // What readers should see once the current changes are written
+  [[nodiscard]] Reported get_target() const noexcept;
+  // Sized for a whole frame, never needs a flush in the middle
+  void queue_event(u16 type, u16 code, i32 value) noexcept;
+};
+
+using Touchpad = BasicTouchpad<uinput::UinputSink>;
+
+extern template class BasicTouchpad<uinput::UinputSink>;
+extern template class BasicTouchpad<uinput::NullSink>;
+extern template class BasicTouchpad<uinput::RingSink>;
+extern template class BasicTouchpad<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
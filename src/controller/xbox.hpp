@@ -0,0 +1,103 @@
+#ifndef VC_CONTROLLER_XBOX_HPP
+#define VC_CONTROLLER_XBOX_HPP
+
+#include "../types.hpp"
+#include "../uinput/sink.hpp"
+#include "./gamepad.hpp"
+#include "./profile.hpp"
+#include <array>
+#include <linux/input-event-codes.h>
+
+namespace vc {
+
+enum XboxButton : u16 {
+  // With their default values
+  // BUTTON_A = BTN_SOUTH,
+  // BUTTON_B = BTN_EAST,
+  // BUTTON_X = BTN_NORTH,
+  // BUTTON_Y = BTN_WEST,
+  BUTTON_A = 0,
+  BUTTON_B,
+  BUTTON_X,
+  BUTTON_Y,
+
+  // LB = BTN_TL,
+  // RB = BTN_TR,
+  LB,
+  RB,
+
+  // VIEW = BTN_SELECT,
+  // MENU = BTN_START,
+  // GUIDE = BTN_MODE,
+  // LS = BTN_THUMBL,
+  // RS = BTN_THUMBR,
+  VIEW,
+  MENU,
+  GUIDE,
+  LS,
+  RS,
+};
+
+enum XboxStick : u8 {
+  LEFT_STICK_X = ABS_X,
+  LEFT_STICK_Y = ABS_Y,
+  LEFT_TRIGGER = ABS_Z,
+
+  RIGHT_STICK_X = ABS_RX,
+  RIGHT_STICK_Y = ABS_RY,
+  RIGHT_TRIGGER = ABS_RZ,
+};
+
+enum XboxDPad : u8 {
+  DPAD_X = ABS_HAT0X,
+  DPAD_Y = ABS_HAT0Y,
+};
+
+// Same codes and ranges as the xpad driver reports for an Xbox One pad
+struct XboxProfile {
+  using Button = XboxButton;
+  using Stick = XboxStick;
+  using Hat = XboxDPad;
+
+  static constexpr u16 VENDOR = 0x045e;
+  static constexpr u16 PRODUCT = 0x02ea;
+  // Series X|S controller
+  static constexpr u16 PRO_PRODUCT = 0x0b12;
+
+  // xpad swaps the codes of X and Y compared to their position
+  static constexpr std::array<u16, 11> BUTTONS{
+      BTN_SOUTH,  BTN_EAST,  BTN_NORTH, BTN_WEST,   BTN_TL,     BTN_TR,
+      BTN_SELECT, BTN_START, BTN_MODE,  BTN_THUMBL, BTN_THUMBR,
+  };
+
+  static constexpr std::array<AxisRange, 6> STICKS{
+      AxisRange{.code = ABS_X, .min = -32768, .max = 32767, .neutral = 0},
+      AxisRange{.code = ABS_Y, .min = -32768, .max = 32767, .neutral = 0},
+      AxisRange{.code = ABS_Z, .min = 0, .max = 1023, .neutral = 0},
+      AxisRange{.code = ABS_RX, .min = -32768, .max = 32767, .neutral = 0},
+      AxisRange{.code = ABS_RY, .min = -32768, .max = 32767, .neutral = 0},
+      AxisRange{.code = ABS_RZ, .min = 0, .max = 1023, .neutral = 0},
+  };
+
+  static constexpr std::array<AxisRange, 2> HATS{
+      AxisRange{.code = XboxDPad::DPAD_X, .min = -1, .max = 1, .neutral = 0},
+      AxisRange{.code = XboxDPad::DPAD_Y, .min = -1, .max = 1, .neutral = 0},
+  };
+
+  static constexpr std::array<u16, 1> FF_EFFECTS{FF_RUMBLE};
+};
+
+using XboxState = PadState<XboxProfile>;
+
+template <typename Sink>
+using BasicXboxController = BasicGamepad<XboxProfile, Sink>;
+using XboxController = BasicXboxController<uinput::UinputSink>;
+
+extern template class BasicGamepad<XboxProfile, uinput::UinputSink>;
+extern template class BasicGamepad<XboxProfile, uinput::NullSink>;
+extern template class BasicGamepad<XboxProfile, uinput::RingSink>;
+extern template class BasicGamepad<XboxProfile, uinput::FileSink>;
+
+} // namespace vc
+
+#endif
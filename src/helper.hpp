@@ -10,16 +10,21 @@
     return error::CONTROLLER_CREATE;                                           \
   }
 
+#define TRY_CODE(expression)                                                   \
+  if (vc::error_code code_ = (expression); code_ != vc::error::OK) {           \
+    return code_;                                                              \
+  }
 
 namespace vc::uinput {
 
-static i32 emit(i32 fd, u16 type, u16 code, i32 value) noexcept {
+template <typename Sink>
+static isize emit(Sink& sink, u16 type, u16 code, i32 value) noexcept {
   input_event event{
       .type = type,
       .code = code,
       .value = value,
   };
-  return write(fd, &event, sizeof(event));
+  return sink.write(&event, 1U);
 }
 
 } // namespace vc::uinput
@@ -0,0 +1,148 @@
+#include "./client.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace vc::ipc {
+
+Client::Client(Client&& other) noexcept
+    : fd(other.fd),
+      broken(other.broken),
+      count(other.count),
+      records(other.records) {
+  other.fd = -1;
+  other.count = 0U;
+}
+
+Client& Client::operator=(Client&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close();
+
+  this->fd = rhs.fd;
+  this->broken = rhs.broken;
+  this->count = rhs.count;
+  this->records = rhs.records;
+  rhs.fd = -1;
+  rhs.count = 0U;
+
+  return *this;
+}
+
+Client::~Client() noexcept {
+  this->close();
+}
+
+error_code Client::connect(const c8* path) noexcept {
+  this->close();
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    return error::DAEMON_OPEN;
+  }
+  strcpy(address.sun_path, path);
+
+  this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (this->fd == -1) {
+    return error::DAEMON_OPEN;
+  }
+
+  auto* generic = reinterpret_cast<sockaddr*>(&address);
+  if (::connect(this->fd, generic, sizeof(address)) == -1) {
+    this->close();
+    return error::DAEMON_OPEN;
+  }
+
+  this->broken = false;
+  return error::OK;
+}
+
+void Client::close() noexcept {
+  if (this->fd != -1) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+  this->count = 0U;
+}
+
+void Client::push(const Record& record) noexcept {
+  if (this->count == RECORDS_MAX) {
+    (void)this->flush();
+  }
+  this->records[this->count++] = record;
+}
+
+void Client::press_button(u16 device, PS4Button button) noexcept {
+  this->push(Record{
+      .op = Op::BUTTON, .device = device, .code = button, .value = 1
+  });
+}
+
+void Client::release_button(u16 device, PS4Button button) noexcept {
+  this->push(Record{
+      .op = Op::BUTTON, .device = device, .code = button, .value = 0
+  });
+}
+
+void Client::move_stick(u16 device, PS4Stick stick, u8 value) noexcept {
+  this->push(Record{
+      .op = Op::STICK, .device = device, .code = stick, .value = value
+  });
+}
+
+void Client::set_dpad(u16 device, PS4DPad hat, i8 value) noexcept {
+  this->push(Record{
+      .op = Op::DPAD, .device = device, .code = hat, .value = value
+  });
+}
+
+void Client::sync_controller(u16 device) noexcept {
+  this->push(Record{.op = Op::CONTROLLER_SYNC, .device = device});
+}
+
+void Client::press_key(u16 device, u16 code) noexcept {
+  this->push(Record{.op = Op::KEY, .device = device, .code = code, .value = 1});
+}
+
+void Client::release_key(u16 device, u16 code) noexcept {
+  this->push(Record{.op = Op::KEY, .device = device, .code = code, .value = 0});
+}
+
+void Client::sync_keyboard(u16 device) noexcept {
+  this->push(Record{.op = Op::KEYBOARD_SYNC, .device = device});
+}
+
+error_code Client::flush() noexcept {
+  const auto* data = reinterpret_cast<const u8*>(this->records.data());
+  usize size = this->count * sizeof(Record);
+  this->count = 0U;
+  if (this->broken || this->fd == -1) {
+    return error::DAEMON_SEND;
+  }
+
+  usize sent = 0U;
+  while (sent < size) {
+    isize bytes = send(this->fd, data + sent, size - sent, MSG_NOSIGNAL);
+    if (bytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      this->broken = true;
+      return error::DAEMON_SEND;
+    }
+    sent += static_cast<usize>(bytes);
+  }
+
+  return error::OK;
+}
+
+usize Client::get_pending() const noexcept {
+  return this->count;
+}
+
+} // namespace vc::ipc
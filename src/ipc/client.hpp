@@ -0,0 +1,73 @@
+#ifndef VC_IPC_CLIENT_HPP
+#define VC_IPC_CLIENT_HPP
+
+#include "../controller/ps4.hpp"
+#include "../types.hpp"
+#include "./protocol.hpp"
+#include <array>
+
+namespace vc::ipc {
+
+/**
+ * Connection to a daemon, see daemon.hpp. Records are queued locally and
+ * sent with one send per flush, the daemon applies what one send carries as
+ * a single batch.
+ *
+ * (void)client.connect("/tmp/vcontroller.sock");
+ * client.press_button(0U, PS4Button::CROSS);
+ * client.move_stick(0U, PS4Stick::LEFT_X, 0xff);
+ * (void)client.flush();
+ *
+ * The socket is blocking, a flush waits while the daemon is behind
+ */
+class Client {
+public:
+  Client() noexcept = default;
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+
+  Client(Client&& other) noexcept;
+  Client& operator=(Client&& rhs) noexcept;
+
+  ~Client() noexcept;
+
+  [[nodiscard]] error_code connect(const c8* path) noexcept;
+  // Drops the records that were not flushed
+  void close() noexcept;
+
+  // Queues a record, flushes first when the queue is full
+  void push(const Record& record) noexcept;
+
+  void press_button(u16 device, PS4Button button) noexcept;
+  void release_button(u16 device, PS4Button button) noexcept;
+  void move_stick(u16 device, PS4Stick stick, u8 value) noexcept;
+  void set_dpad(u16 device, PS4DPad hat, i8 value) noexcept;
+  // Ends the current frame of the controller
+  void sync_controller(u16 device) noexcept;
+
+  void press_key(u16 device, u16 code) noexcept;
+  void release_key(u16 device, u16 code) noexcept;
+  // Ends the current frame of the keyboard
+  void sync_keyboard(u16 device) noexcept;
+
+  /**
+   * Sends every queued record
+   * @return DAEMON_SEND if this or an earlier flush failed, the connection
+   *   is unusable then
+   */
+  [[nodiscard]] error_code flush() noexcept;
+
+  [[nodiscard]] usize get_pending() const noexcept;
+
+private:
+  static constexpr usize RECORDS_MAX = 1024U;
+
+  i32 fd = -1;
+  bool broken = false;
+  usize count = 0U;
+  std::array<Record, RECORDS_MAX> records{};
+};
+
+} // namespace vc::ipc
+
+#endif
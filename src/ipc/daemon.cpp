@@ -0,0 +1,363 @@
+#include "./daemon.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <linux/input-event-codes.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+namespace vc::ipc {
+
+namespace {
+
+[[nodiscard]] bool is_stick(u16 code) noexcept {
+  return code == PS4Stick::LEFT_X || code == PS4Stick::LEFT_Y ||
+         code == PS4Stick::RIGHT_X || code == PS4Stick::RIGHT_Y;
+}
+
+[[nodiscard]] bool is_hat(u16 code) noexcept {
+  return code == PS4DPad::X || code == PS4DPad::Y;
+}
+
+} // namespace
+
+template <typename Sink>
+BasicDaemon<Sink>::BasicDaemon(BasicDaemon&& other) noexcept
+    : pool(other.pool),
+      listen_fd(other.listen_fd),
+      epoll_fd(other.epoll_fd),
+      event_fd(other.event_fd),
+      running(other.running),
+      path(other.path),
+      clients(std::move(other.clients)),
+      client_count(other.client_count),
+      buffer(std::move(other.buffer)),
+      stats(other.stats) {
+  other.pool = nullptr;
+  other.listen_fd = -1;
+  other.epoll_fd = -1;
+  other.event_fd = -1;
+  other.path[0] = '\0';
+  other.client_count = 0U;
+}
+
+template <typename Sink>
+BasicDaemon<Sink>& BasicDaemon<Sink>::operator=(BasicDaemon&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close();
+
+  this->pool = rhs.pool;
+  this->listen_fd = rhs.listen_fd;
+  this->epoll_fd = rhs.epoll_fd;
+  this->event_fd = rhs.event_fd;
+  this->running = rhs.running;
+  this->path = rhs.path;
+  this->clients = std::move(rhs.clients);
+  this->client_count = rhs.client_count;
+  this->buffer = std::move(rhs.buffer);
+  this->stats = rhs.stats;
+  rhs.pool = nullptr;
+  rhs.listen_fd = -1;
+  rhs.epoll_fd = -1;
+  rhs.event_fd = -1;
+  rhs.path[0] = '\0';
+  rhs.client_count = 0U;
+
+  return *this;
+}
+
+template <typename Sink> BasicDaemon<Sink>::~BasicDaemon() noexcept {
+  this->close();
+}
+
+template <typename Sink>
+error_code BasicDaemon<Sink>::listen(
+    const c8* path, BasicControllerPool<Sink>& pool
+) noexcept {
+  this->close();
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    return error::DAEMON_OPEN;
+  }
+  strcpy(address.sun_path, path);
+
+  this->listen_fd =
+      socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (this->listen_fd == -1) {
+    return error::DAEMON_OPEN;
+  }
+
+  // A daemon that crashed leaves its socket file behind
+  unlink(path);
+  auto* generic = reinterpret_cast<sockaddr*>(&address);
+  if (bind(this->listen_fd, generic, sizeof(address)) == -1) {
+    this->close();
+    return error::DAEMON_OPEN;
+  }
+  strcpy(this->path.data(), path);
+
+  if (::listen(this->listen_fd, SOMAXCONN) == -1) {
+    this->close();
+    return error::DAEMON_OPEN;
+  }
+
+  this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  this->event_fd = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (this->epoll_fd == -1 || this->event_fd == -1) {
+    this->close();
+    return error::WORKER_CREATE;
+  }
+
+  for (i32 fd : {this->listen_fd, this->event_fd}) {
+    epoll_event event{.events = EPOLLIN, .data = {.fd = fd}};
+    if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      this->close();
+      return error::WORKER_CREATE;
+    }
+  }
+
+  this->pool = &pool;
+  this->buffer.resize(BUFFER_SIZE);
+  this->stats = DaemonStats{};
+  return error::OK;
+}
+
+template <typename Sink> void BasicDaemon<Sink>::close() noexcept {
+  for (usize fd = 0U; fd < this->clients.size(); ++fd) {
+    if (this->clients[fd].connected) {
+      this->disconnect(static_cast<i32>(fd));
+    }
+  }
+  this->clients.clear();
+
+  for (i32* fd : {&this->listen_fd, &this->epoll_fd, &this->event_fd}) {
+    if (*fd != -1) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+
+  if (this->path[0] != '\0') {
+    unlink(this->path.data());
+    this->path[0] = '\0';
+  }
+  this->pool = nullptr;
+}
+
+template <typename Sink>
+usize BasicDaemon<Sink>::poll(i32 timeout_ms) noexcept {
+  std::array<epoll_event, EVENTS_MAX> events{};
+  i32 count =
+      epoll_wait(this->epoll_fd, events.data(), events.size(), timeout_ms);
+  if (count <= 0) {
+    return 0U;
+  }
+
+  usize applied = 0U;
+  for (i32 i = 0; i < count; ++i) {
+    i32 fd = events[i].data.fd;
+    if (fd == this->listen_fd) {
+      this->accept_clients();
+    } else if (fd == this->event_fd) {
+      u64 value = 0U;
+      (void)read(this->event_fd, &value, sizeof(value));
+      this->running = false;
+    } else if (events[i].events & EPOLLIN) {
+      // Level triggered, one recv per client keeps a busy client from
+      // starving the others, the rest is read on the next poll
+      applied += this->receive(fd);
+    } else {
+      this->disconnect(fd);
+    }
+  }
+
+  // Every device changed by the batch costs one write
+  if (applied != 0U) {
+    this->pool->flush();
+  }
+  return applied;
+}
+
+template <typename Sink> void BasicDaemon<Sink>::run() noexcept {
+  this->running = true;
+  while (this->running) {
+    (void)this->poll(-1);
+  }
+}
+
+template <typename Sink> void BasicDaemon<Sink>::stop() noexcept {
+  u64 one = 1U;
+  (void)write(this->event_fd, &one, sizeof(one));
+}
+
+template <typename Sink> void BasicDaemon<Sink>::accept_clients() noexcept {
+  while (true) {
+    i32 fd = accept4(
+        this->listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC
+    );
+    if (fd == -1) {
+      return;
+    }
+
+    epoll_event event{.events = EPOLLIN | EPOLLRDHUP, .data = {.fd = fd}};
+    if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      ::close(fd);
+      continue;
+    }
+
+    if (static_cast<usize>(fd) >= this->clients.size()) {
+      this->clients.resize(fd + 1U);
+    }
+    this->clients[fd] = Connection{.connected = true};
+    ++this->client_count;
+    ++this->stats.clients;
+  }
+}
+
+template <typename Sink> void BasicDaemon<Sink>::disconnect(i32 fd) noexcept {
+  (void)epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  this->clients[fd].connected = false;
+  --this->client_count;
+}
+
+template <typename Sink> usize BasicDaemon<Sink>::receive(i32 fd) noexcept {
+  Connection& client = this->clients[fd];
+  u8* data = this->buffer.data();
+  memcpy(data, client.partial.data(), client.partial_size);
+
+  isize bytes = -1;
+  do {
+    bytes = recv(
+        fd, data + client.partial_size, BUFFER_SIZE - client.partial_size, 0
+    );
+  } while (bytes == -1 && errno == EINTR);
+
+  if (bytes == 0 || (bytes == -1 && errno != EAGAIN)) {
+    this->disconnect(fd);
+    return 0U;
+  }
+  if (bytes == -1) {
+    return 0U;
+  }
+
+  usize size = client.partial_size + static_cast<usize>(bytes);
+  usize count = size / sizeof(Record);
+  for (usize i = 0U; i < count; ++i) {
+    Record record{};
+    memcpy(&record, data + i * sizeof(Record), sizeof(Record));
+    this->apply(record);
+  }
+
+  client.partial_size = size % sizeof(Record);
+  memcpy(
+      client.partial.data(), data + count * sizeof(Record), client.partial_size
+  );
+
+  if (count != 0U) {
+    ++this->stats.batches;
+    this->stats.records += count;
+  }
+  return count;
+}
+
+template <typename Sink>
+void BasicDaemon<Sink>::apply(const Record& record) noexcept {
+  bool is_controller = record.device < this->pool->get_controller_count();
+  bool is_keyboard = record.device < this->pool->get_keyboard_count();
+
+  switch (record.op) {
+  case Op::BUTTON:
+    if (is_controller && record.code < PS4Profile::BUTTONS.size()) {
+      auto& controller = this->pool->get_controller(record.device);
+      auto button = static_cast<PS4Button>(record.code);
+      if (record.value != 0) {
+        controller.press_button(button);
+      } else {
+        controller.release_button(button);
+      }
+      return;
+    }
+    break;
+
+  case Op::STICK:
+    if (is_controller && is_stick(record.code) && record.value >= 0 &&
+        record.value <= 0xff) {
+      auto& controller = this->pool->get_controller(record.device);
+      auto stick = static_cast<PS4Stick>(record.code);
+      controller.move_stick(stick, static_cast<u8>(record.value));
+      return;
+    }
+    break;
+
+  case Op::DPAD:
+    if (is_controller && is_hat(record.code) && record.value >= -1 &&
+        record.value <= 1) {
+      auto& controller = this->pool->get_controller(record.device);
+      auto hat = static_cast<PS4DPad>(record.code);
+      controller.set_dpad(hat, static_cast<i8>(record.value));
+      return;
+    }
+    break;
+
+  case Op::CONTROLLER_SYNC:
+    if (is_controller) {
+      auto& controller = this->pool->get_controller(record.device);
+      if (controller.has_pending()) {
+        controller.sync();
+      }
+      return;
+    }
+    break;
+
+  case Op::KEY:
+    if (is_keyboard && record.code <= KEY_MAX) {
+      auto& keyboard = this->pool->get_keyboard(record.device);
+      if (record.value != 0) {
+        keyboard.press_key(record.code);
+      } else {
+        keyboard.release_key(record.code);
+      }
+      return;
+    }
+    break;
+
+  case Op::KEYBOARD_SYNC:
+    if (is_keyboard) {
+      auto& keyboard = this->pool->get_keyboard(record.device);
+      if (keyboard.has_pending()) {
+        keyboard.sync();
+      }
+      return;
+    }
+    break;
+  }
+
+  ++this->stats.invalid;
+}
+
+template <typename Sink>
+usize BasicDaemon<Sink>::get_client_count() const noexcept {
+  return this->client_count;
+}
+
+template <typename Sink>
+const DaemonStats& BasicDaemon<Sink>::get_stats() const noexcept {
+  return this->stats;
+}
+
+template class BasicDaemon<uinput::UinputSink>;
+template class BasicDaemon<uinput::NullSink>;
+template class BasicDaemon<uinput::RingSink>;
+template class BasicDaemon<uinput::FileSink>;
+
+} // namespace vc::ipc
@@ -0,0 +1,109 @@
+#ifndef VC_IPC_DAEMON_HPP
+#define VC_IPC_DAEMON_HPP
+
+#include "../controller/pool.hpp"
+#include "../types.hpp"
+#include "./protocol.hpp"
+#include <array>
+#include <vector>
+
+namespace vc::ipc {
+
+struct DaemonStats {
+  u64 clients = 0U;
+  u64 records = 0U;
+  // recv calls that returned records, each one is applied as a batch
+  u64 batches = 0U;
+  // Records with an unknown op or device, they are skipped
+  u64 invalid = 0U;
+};
+
+/**
+ * Serves the devices of a pool to local clients over a Unix domain socket,
+ * see protocol.hpp. Every client is multiplexed with epoll on the thread
+ * calling poll or run. Each recv takes as many records as the buffer holds
+ * and folds them into the devices, then every changed device is written
+ * once for the whole batch.
+ *
+ * (void)pool.init(4U, 1U, "Simulated PS4 Controller", true);
+ * (void)daemon.listen("/tmp/vcontroller.sock", pool);
+ * daemon.run();
+ *
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicDaemon {
+public:
+  BasicDaemon() noexcept = default;
+  BasicDaemon(const BasicDaemon&) = delete;
+  BasicDaemon& operator=(const BasicDaemon&) = delete;
+
+  BasicDaemon(BasicDaemon&& other) noexcept;
+  BasicDaemon& operator=(BasicDaemon&& rhs) noexcept;
+
+  ~BasicDaemon() noexcept;
+
+  /**
+   * Binds the socket, a stale socket file at the path is replaced.
+   * The pool needs to outlive the daemon
+   */
+  [[nodiscard]] error_code
+  listen(const c8* path, BasicControllerPool<Sink>& pool) noexcept;
+  // Disconnects every client and removes the socket file
+  void close() noexcept;
+
+  /**
+   * Accepts, reads and applies whatever is ready
+   * @param timeout_ms - -1 blocks until something happens
+   * @return number of records applied
+   */
+  usize poll(i32 timeout_ms) noexcept;
+  // Polls until stop is called
+  void run() noexcept;
+  // Unblocks run and poll, can be called from any thread
+  void stop() noexcept;
+
+  [[nodiscard]] usize get_client_count() const noexcept;
+  [[nodiscard]] const DaemonStats& get_stats() const noexcept;
+
+private:
+  static constexpr usize BUFFER_SIZE = 64U * 1024U;
+  static constexpr usize EVENTS_MAX = 64U;
+
+  struct Connection {
+    bool connected = false;
+    // Bytes of a record split across two recv calls
+    u8 partial_size = 0U;
+    std::array<u8, sizeof(Record)> partial{};
+  };
+
+  BasicControllerPool<Sink>* pool = nullptr;
+  i32 listen_fd = -1;
+  i32 epoll_fd = -1;
+  i32 event_fd = -1;
+  bool running = false;
+  std::array<c8, 108> path{};
+
+  // Indexed by fd
+  std::vector<Connection> clients{};
+  usize client_count = 0U;
+  std::vector<u8> buffer{};
+  DaemonStats stats{};
+
+  void accept_clients() noexcept;
+  void disconnect(i32 fd) noexcept;
+  // One recv of up to a buffer, epoll is level triggered so the rest comes
+  // with the next poll. Returns the records applied
+  usize receive(i32 fd) noexcept;
+  void apply(const Record& record) noexcept;
+};
+
+using Daemon = BasicDaemon<uinput::UinputSink>;
+
+extern template class BasicDaemon<uinput::UinputSink>;
+extern template class BasicDaemon<uinput::NullSink>;
+extern template class BasicDaemon<uinput::RingSink>;
+extern template class BasicDaemon<uinput::FileSink>;
+
+} // namespace vc::ipc
+
+#endif
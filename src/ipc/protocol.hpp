@@ -0,0 +1,50 @@
+#ifndef VC_IPC_PROTOCOL_HPP
+#define VC_IPC_PROTOCOL_HPP
+
+#include "../types.hpp"
+
+/**
+ * Wire format of the control daemon, a stream of fixed-size 8 byte records
+ * in native endianness, no header and no reply:
+ *   u8  op
+ *   u8  reserved, 0
+ *   u16 device    index of the controller or keyboard in the daemon
+ *   u16 code      depends on the op
+ *   i16 value     depends on the op
+ *
+ * Records only change the state of a device, the daemon writes the devices
+ * that changed once it went through everything it received. Send a sync
+ * record between two changes of a device that need their own frames, ie. a
+ * press and release of the same button
+ */
+
+namespace vc::ipc {
+
+enum class Op : u8 {
+  // code is a PS4Button, value 1 to press and 0 to release
+  BUTTON,
+  // code is a PS4Stick, value [0, 255]
+  STICK,
+  // code is a PS4DPad, value -1, 0 or 1
+  DPAD,
+  // Writes the pending changes of the controller now
+  CONTROLLER_SYNC,
+  // code is a KEY_* code, value 1 to press and 0 to release
+  KEY,
+  // Writes the pending changes of the keyboard now
+  KEYBOARD_SYNC,
+};
+
+struct Record {
+  Op op;
+  u8 reserved;
+  u16 device;
+  u16 code;
+  i16 value;
+};
+
+static_assert(sizeof(Record) == 8U);
+
+} // namespace vc::ipc
+
+#endif
@@ -0,0 +1,309 @@
+#include "./shared_state.hpp"
+#include "../helper.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace vc::ipc {
+
+namespace {
+
+// State bytes of a slot, trivially copyable unlike PS4State
+struct PackedState {
+  u16 buttons;
+  std::array<u8, 4> sticks;
+  std::array<i8, 2> hats;
+};
+
+static_assert(sizeof(PackedState) == sizeof(u64));
+
+[[nodiscard]] u64 pack(const PS4State& state) noexcept {
+  PackedState packed{
+      .buttons = state.buttons,
+      .sticks = state.sticks,
+      .hats = state.hats,
+  };
+  u64 word = 0U;
+  memcpy(&word, &packed, sizeof(word));
+  return word;
+}
+
+[[nodiscard]] PS4State unpack(u64 word) noexcept {
+  PackedState packed{};
+  memcpy(&packed, &word, sizeof(word));
+  PS4State state{};
+  state.buttons = packed.buttons;
+  state.sticks = packed.sticks;
+  state.hats = packed.hats;
+  return state;
+}
+
+} // namespace
+
+SharedStates::SharedStates(SharedStates&& other) noexcept
+    : header(other.header),
+      slots(other.slots),
+      map_size(other.map_size),
+      seen(std::move(other.seen)),
+      name(other.name),
+      owner(other.owner) {
+  other.header = nullptr;
+  other.slots = nullptr;
+  other.map_size = 0U;
+  other.owner = false;
+}
+
+SharedStates& SharedStates::operator=(SharedStates&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close();
+
+  this->header = rhs.header;
+  this->slots = rhs.slots;
+  this->map_size = rhs.map_size;
+  this->seen = std::move(rhs.seen);
+  this->name = rhs.name;
+  this->owner = rhs.owner;
+  rhs.header = nullptr;
+  rhs.slots = nullptr;
+  rhs.map_size = 0U;
+  rhs.owner = false;
+
+  return *this;
+}
+
+SharedStates::~SharedStates() noexcept {
+  this->close();
+}
+
+error_code SharedStates::create(const c8* name, u32 count) noexcept {
+  this->close();
+  snprintf(this->name.data(), this->name.size(), "/%s", name);
+
+  // A daemon that crashed leaves its segment behind
+  shm_unlink(this->name.data());
+  i32 fd = shm_open(
+      this->name.data(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660
+  );
+  if (fd == -1) {
+    return error::SHARED_OPEN;
+  }
+
+  usize size = sizeof(SharedHeader) + count * sizeof(SharedSlot);
+  if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+    ::close(fd);
+    shm_unlink(this->name.data());
+    return error::SHARED_OPEN;
+  }
+
+  error_code code = this->map(fd, size);
+  ::close(fd);
+  if (code != error::OK) {
+    shm_unlink(this->name.data());
+    return code;
+  }
+  this->owner = true;
+
+  // The pages are zeroed, only the state needs its neutral values
+  u64 neutral = pack(PS4State{});
+  for (u32 i = 0U; i < count; ++i) {
+    new (&this->slots[i]) SharedSlot{};
+    this->slots[i].state.store(neutral, std::memory_order_relaxed);
+  }
+  this->seen.assign(count, 0U);
+
+  // Writers check the magic last
+  this->header->version = SHARED_VERSION;
+  this->header->slot_size = sizeof(SharedSlot);
+  this->header->slot_count = count;
+  this->header->frames.store(0U, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  this->header->magic = SHARED_MAGIC;
+  return error::OK;
+}
+
+error_code SharedStates::open(const c8* name) noexcept {
+  this->close();
+  snprintf(this->name.data(), this->name.size(), "/%s", name);
+
+  i32 fd = shm_open(this->name.data(), O_RDWR | O_CLOEXEC, 0);
+  if (fd == -1) {
+    return error::SHARED_OPEN;
+  }
+
+  struct stat info{};
+  if (fstat(fd, &info) == -1 ||
+      static_cast<usize>(info.st_size) < sizeof(SharedHeader)) {
+    ::close(fd);
+    return error::SHARED_FORMAT;
+  }
+
+  error_code code = this->map(fd, info.st_size);
+  ::close(fd);
+  TRY_CODE(code);
+
+  const SharedHeader& header = *this->header;
+  usize needed =
+      sizeof(SharedHeader) + header.slot_count * sizeof(SharedSlot);
+  if (header.magic != SHARED_MAGIC || header.version != SHARED_VERSION ||
+      header.slot_size != sizeof(SharedSlot) || needed > this->map_size) {
+    this->close();
+    return error::SHARED_FORMAT;
+  }
+
+  this->seen.assign(header.slot_count, 0U);
+  return error::OK;
+}
+
+void SharedStates::close() noexcept {
+  if (this->header != nullptr) {
+    munmap(this->header, this->map_size);
+    this->header = nullptr;
+    this->slots = nullptr;
+    this->map_size = 0U;
+  }
+
+  if (this->owner) {
+    shm_unlink(this->name.data());
+    this->owner = false;
+  }
+  this->seen.clear();
+}
+
+void SharedStates::write(u32 index, const PS4State& state) noexcept {
+  SharedSlot& slot = this->slots[index];
+  u32 sequence = slot.sequence.load(std::memory_order_relaxed);
+  while ((sequence & 1U) || !slot.sequence.compare_exchange_weak(
+                                 sequence, sequence + 1U,
+                                 std::memory_order_acquire,
+                                 std::memory_order_relaxed
+                             )) {
+    sequence = slot.sequence.load(std::memory_order_relaxed);
+  }
+
+  slot.state.store(pack(state), std::memory_order_relaxed);
+  slot.sequence.store(sequence + 2U, std::memory_order_release);
+}
+
+bool SharedStates::read(u32 index, PS4State& state) const noexcept {
+  const SharedSlot& slot = this->slots[index];
+  for (u32 i = 0U; i < READ_RETRIES; ++i) {
+    u32 before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1U) {
+      continue;
+    }
+
+    u64 word = slot.state.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == before) {
+      state = unpack(word);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Sink>
+usize SharedStates::apply(
+    BasicPS4Controller<Sink>* controllers, usize count
+) noexcept {
+  if (this->header == nullptr) {
+    return 0U;
+  }
+  this->header->frames.fetch_add(1U, std::memory_order_relaxed);
+
+  usize changed = 0U;
+  count = std::min<usize>(count, this->seen.size());
+  for (usize i = 0U; i < count; ++i) {
+    const SharedSlot& slot = this->slots[i];
+    u32 sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == this->seen[i]) {
+      continue;
+    }
+
+    PS4State state{};
+    u32 before = sequence;
+    if (!(sequence & 1U)) {
+      u64 word = slot.state.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      sequence = slot.sequence.load(std::memory_order_relaxed);
+      state = unpack(word);
+    }
+
+    // Mid update, the next frame picks it up
+    if ((before & 1U) || sequence != before) {
+      continue;
+    }
+
+    // A dropped frame rolls the controller back, the slot stays unseen so
+    // the next frame tries it again
+    controllers[i].apply(state);
+    if (controllers[i].get_state() == state) {
+      this->seen[i] = sequence;
+    }
+    ++changed;
+  }
+  return changed;
+}
+
+template <typename Sink>
+usize SharedStates::apply(BasicControllerPool<Sink>& pool) noexcept {
+  usize count = pool.get_controller_count();
+  return count == 0U ? 0U : this->apply(&pool.get_controller(0U), count);
+}
+
+u32 SharedStates::size() const noexcept {
+  return static_cast<u32>(this->seen.size());
+}
+
+u64 SharedStates::get_frames() const noexcept {
+  return this->header == nullptr
+             ? 0U
+             : this->header->frames.load(std::memory_order_relaxed);
+}
+
+error_code SharedStates::map(i32 fd, usize size) noexcept {
+  void* address =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    return error::SHARED_OPEN;
+  }
+
+  this->header = static_cast<SharedHeader*>(address);
+  this->slots = reinterpret_cast<SharedSlot*>(this->header + 1U);
+  this->map_size = size;
+  return error::OK;
+}
+
+template usize SharedStates::apply(
+    BasicPS4Controller<uinput::UinputSink>*, usize
+) noexcept;
+template usize SharedStates::apply(
+    BasicPS4Controller<uinput::NullSink>*, usize
+) noexcept;
+template usize SharedStates::apply(
+    BasicPS4Controller<uinput::RingSink>*, usize
+) noexcept;
+template usize SharedStates::apply(
+    BasicPS4Controller<uinput::FileSink>*, usize
+) noexcept;
+template usize SharedStates::apply(
+    BasicControllerPool<uinput::UinputSink>&
+) noexcept;
+template usize SharedStates::apply(BasicControllerPool<uinput::NullSink>&
+) noexcept;
+template usize SharedStates::apply(BasicControllerPool<uinput::RingSink>&
+) noexcept;
+template usize SharedStates::apply(BasicControllerPool<uinput::FileSink>&
+) noexcept;
+
+} // namespace vc::ipc
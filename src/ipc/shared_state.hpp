@@ -0,0 +1,144 @@
+#ifndef VC_IPC_SHARED_STATE_HPP
+#define VC_IPC_SHARED_STATE_HPP
+
+#include "../controller/pool.hpp"
+#include "../controller/ps4.hpp"
+#include "../types.hpp"
+#include <array>
+#include <atomic>
+#include <vector>
+
+/**
+ * Shared memory segment holding the desired PS4State of each controller of
+ * a daemon, so other processes drive them without linking this code.
+ * Created with shm_open, so the segment is /dev/shm/<name>.
+ *
+ * Layout, native endianness, every part is one 64 byte cache line
+ *   header
+ *     u32 magic       "VCSM"
+ *     u16 version     1
+ *     u16 slot_size   64
+ *     u32 slot_count
+ *     u32 reserved
+ *     u64 frames      times the daemon sampled the slots, a heartbeat
+ *   slots[slot_count]
+ *     u32 sequence    odd while a writer is in the middle of an update
+ *     u32 reserved
+ *     u8  state[8]    PS4State, see below
+ *
+ * PS4State: u16 buttons (bit per PS4Button), u8 sticks LX LY RX RY
+ * (0x7f neutral), i8 d-pad X Y (-1, 0 or 1)
+ *
+ * A writer updates a slot with a seqlock, no syscall involved:
+ *   1. read the sequence, retry if odd, then compare and swap it to + 1
+ *      (a plain store is enough with a single writer per slot)
+ *   2. write the 8 state bytes, plain writes are fine
+ *   3. store sequence + 2 with release semantics
+ * The daemon skips slots whose sequence did not move since the last frame
+ * it wrote them in. A slot caught mid update is left for the next frame
+ * instead of retried, so a frame costs one cache line per controller
+ */
+
+namespace vc::ipc {
+
+constexpr u32 SHARED_MAGIC = 0x4d534356U; // "VCSM"
+constexpr u16 SHARED_VERSION = 1U;
+
+struct alignas(64) SharedHeader {
+  u32 magic;
+  u16 version;
+  u16 slot_size;
+  u32 slot_count;
+  u32 reserved;
+  std::atomic<u64> frames;
+};
+
+struct alignas(64) SharedSlot {
+  std::atomic<u32> sequence;
+  u32 reserved;
+  // PS4State bytes, read as one word by the daemon
+  std::atomic<u64> state;
+};
+
+static_assert(sizeof(SharedHeader) == 64U);
+static_assert(sizeof(SharedSlot) == 64U);
+static_assert(sizeof(PS4State) == sizeof(u64));
+static_assert(std::atomic<u64>::is_always_lock_free);
+
+/**
+ * Either side of the segment, the daemon creates it and samples it every
+ * frame, writers open it
+ *
+ * // Daemon
+ * (void)states.create("vcontroller", pool.get_controller_count());
+ * while (running) {
+ *   states.apply(pool);
+ *   pool.wait();
+ * }
+ *
+ * // Writer
+ * (void)states.open("vcontroller");
+ * states.write(0U, state);
+ */
+class SharedStates {
+public:
+  SharedStates() noexcept = default;
+  SharedStates(const SharedStates&) = delete;
+  SharedStates& operator=(const SharedStates&) = delete;
+
+  SharedStates(SharedStates&& other) noexcept;
+  SharedStates& operator=(SharedStates&& rhs) noexcept;
+
+  ~SharedStates() noexcept;
+
+  /**
+   * Creates the segment with neutral states, replaces a stale one of the
+   * same name. The segment is removed when this is closed
+   * @param name - without the leading '/'
+   */
+  [[nodiscard]] error_code create(const c8* name, u32 count) noexcept;
+  // Maps a segment created by a daemon
+  [[nodiscard]] error_code open(const c8* name) noexcept;
+  void close() noexcept;
+
+  // Publishes the state of a slot, safe with other writers of the slot
+  void write(u32 index, const PS4State& state) noexcept;
+
+  /**
+   * Consistent copy of a slot
+   * @return false if writers kept it busy for too long, try again later
+   */
+  [[nodiscard]] bool read(u32 index, PS4State& state) const noexcept;
+
+  /**
+   * Applies every slot written since the last call to the controller of
+   * the same index, which only emits what differs from its state. Slots
+   * mid update or whose frame was dropped are applied by a later call
+   * @return number of slots that changed
+   */
+  template <typename Sink>
+  usize apply(BasicPS4Controller<Sink>* controllers, usize count) noexcept;
+  template <typename Sink>
+  usize apply(BasicControllerPool<Sink>& pool) noexcept;
+
+  [[nodiscard]] u32 size() const noexcept;
+  // Frames sampled by the daemon so far, stops moving if it died
+  [[nodiscard]] u64 get_frames() const noexcept;
+
+private:
+  static constexpr u32 READ_RETRIES = 64U;
+
+  SharedHeader* header = nullptr;
+  SharedSlot* slots = nullptr;
+  usize map_size = 0U;
+  // Sequence of each slot at the last apply that wrote it
+  std::vector<u32> seen{};
+  std::array<c8, 64> name{};
+  bool owner = false;
+
+  [[nodiscard]] error_code map(i32 fd, usize size) noexcept;
+};
+
+} // namespace vc::ipc
+
+#endif
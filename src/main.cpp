@@ -1,8 +1,17 @@
 #include "./types.hpp"
+#include "controller/pool.hpp"
 #include "controller/ps4.hpp"
+#include "ipc/client.hpp"
+#include "ipc/daemon.hpp"
+#include "ipc/shared_state.hpp"
+#include "script/executor.hpp"
+#include "timing/clock.hpp"
+#include "timing/scheduler.hpp"
+#include "turbo/engine.hpp"
 #include <bits/types/struct_timeval.h>
 #include <csignal>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <linux/input-event-codes.h>
@@ -12,16 +21,188 @@
 #include <unistd.h>
 
 static bool running = true; // NOLINT
+static volatile sig_atomic_t reload = 0; // NOLINT
 // NOLINTNEXTLINE
 static void sigint_callback(vc::i32 _signum) noexcept {
   printf("\nSIGINT received, exiting program\n");
   running = false;
 }
 
-int main() noexcept {
+// NOLINTNEXTLINE
+static void sighup_callback(vc::i32 _signum) noexcept {
+  reload = 1;
+}
+
+/**
+ * Daemon mode, other processes write the states of the controllers into
+ * /dev/shm/<name>, see ipc/shared_state.hpp
+ */
+static vc::i32 run_shared(const vc::c8* name, vc::u32 count) noexcept {
+  printf("Creating %u controllers\n", count);
+  vc::ControllerPool pool{};
+  vc::error_code code = pool.init(count, 0U, "Simulated PS4 Controller", true);
+  if (code == vc::error::OK) {
+    code = pool.wait_ready(5'000);
+  }
+  if (code == vc::error::OK) {
+    code = pool.start(250U);
+  }
+  if (code != vc::error::OK) {
+    printf("Could not initialize controllers: %u\n", code);
+    return 1;
+  }
+
+  vc::ipc::SharedStates states{};
+  code = states.create(name, count);
+  if (code != vc::error::OK) {
+    printf("Could not create /dev/shm/%s: %u\n", name, code);
+    return 1;
+  }
+  printf("Sampling /dev/shm/%s at 250Hz\n", name);
+
+  while (running) {
+    states.apply(pool);
+    pool.wait();
+  }
+
+  pool.get_stats().print(stdout, "Controllers");
+  return 0;
+}
+
+/**
+ * Daemon mode, clients send records over a Unix domain socket, see
+ * ipc/protocol.hpp
+ */
+static vc::i32 run_daemon(
+    const vc::c8* path, vc::u32 controllers, vc::u32 keyboards
+) noexcept {
+  printf("Creating %u controllers and %u keyboards\n", controllers, keyboards);
+  vc::ControllerPool pool{};
+  vc::error_code code =
+      pool.init(controllers, keyboards, "Simulated PS4 Controller", true);
+  if (code == vc::error::OK) {
+    code = pool.wait_ready(5'000);
+  }
+  if (code != vc::error::OK) {
+    printf("Could not initialize devices: %u\n", code);
+    return 1;
+  }
+
+  vc::ipc::Daemon daemon{};
+  code = daemon.listen(path, pool);
+  if (code != vc::error::OK) {
+    printf("Could not listen on %s: %u\n", path, code);
+    return 1;
+  }
+  printf("Listening on %s\n", path);
+
+  // SIGINT interrupts the poll
+  while (running) {
+    (void)daemon.poll(-1);
+  }
+
+  const vc::ipc::DaemonStats& stats = daemon.get_stats();
+  printf(
+      "Clients: %lu ; Records: %lu ; Batches: %lu ; Invalid: %lu\n",
+      stats.clients, stats.records, stats.batches, stats.invalid
+  );
+  pool.get_stats().print(stdout, "Devices");
+  return 0;
+}
+
+// Presses cross on the first controller of a daemon every 2 seconds
+static vc::i32 run_client(const vc::c8* path) noexcept {
+  vc::ipc::Client client{};
+  vc::error_code code = client.connect(path);
+  if (code != vc::error::OK) {
+    printf("Could not connect to %s: %u\n", path, code);
+    return 1;
+  }
+  printf("Connected to %s\n", path);
+
+  bool pressed = false;
+  while (running) {
+    if (pressed) {
+      client.release_button(0U, vc::PS4Button::CROSS);
+    } else {
+      client.press_button(0U, vc::PS4Button::CROSS);
+    }
+    pressed = !pressed;
+
+    if (client.flush() != vc::error::OK) {
+      printf("Daemon closed the connection\n");
+      return 1;
+    }
+    sleep(2U);
+  }
+
+  client.release_button(0U, vc::PS4Button::CROSS);
+  (void)client.flush();
+  return 0;
+}
+
+// Usage: vcontroller [script], SIGHUP reloads the script
+//        vcontroller --shm <name> <count>
+//        vcontroller --daemon <socket> <controllers> <keyboards>
+//        vcontroller --connect <socket>
+int main(int argc, char** argv) noexcept {
+  if (argc > 1 && strcmp(argv[1], "--daemon") == 0) {
+    if (argc != 5) {
+      printf(
+          "Usage: %s --daemon <socket> <controllers> <keyboards>\n", argv[0]
+      );
+      return 1;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = sigint_callback;
+    sigaction(SIGINT, &action, nullptr);
+    return run_daemon(
+        argv[2], static_cast<vc::u32>(atoi(argv[3])),
+        static_cast<vc::u32>(atoi(argv[4]))
+    );
+  }
+
+  if (argc > 1 && strcmp(argv[1], "--connect") == 0) {
+    if (argc != 3) {
+      printf("Usage: %s --connect <socket>\n", argv[0]);
+      return 1;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = sigint_callback;
+    sigaction(SIGINT, &action, nullptr);
+    return run_client(argv[2]);
+  }
+
+  if (argc > 1 && strcmp(argv[1], "--shm") == 0) {
+    if (argc != 4) {
+      printf("Usage: %s --shm <name> <count>\n", argv[0]);
+      return 1;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = sigint_callback;
+    sigaction(SIGINT, &action, nullptr);
+    return run_shared(argv[2], static_cast<vc::u32>(atoi(argv[3])));
+  }
+
+  // Looped instead of the built in cross presses, see script/plan.hpp
+  const vc::c8* script = argc > 1 ? argv[1] : nullptr;
+  vc::PlanSlot slot{vc::PlanTarget::GAMEPAD};
+  vc::PlanExecutor<vc::PS4Controller> executor{};
+  if (script != nullptr) {
+    vc::ScriptError error{};
+    vc::error_code code = slot.load_file(script, &error);
+    if (code != vc::error::OK) {
+      printf("Could not load %s:%u: %s\n", script, error.line, error.message);
+      return 1;
+    }
+  }
+
   printf("Creating controller\n");
   vc::PS4Controller controller{};
-  vc::error_code code = controller.init("Simulated PS4 Controller", true);
+  vc::error_code code = controller.init("Simulated PS4 Controller", true, true);
   if (code != vc::error::OK) {
     printf("Could not initialize controller: %u\n", code);
     return 1;
@@ -31,6 +212,8 @@ int main() noexcept {
   struct sigaction action{};
   action.sa_handler = sigint_callback;
   sigaction(SIGINT, &action, nullptr);
+  action.sa_handler = sighup_callback;
+  sigaction(SIGHUP, &action, nullptr);
 
   // NOTE: Remapping allowed since some games don't align their controls with
   //   real controllers
@@ -39,36 +222,68 @@ int main() noexcept {
   controller.remap(vc::PS4Button::TRIANGLE, BTN_WEST);
   controller.remap(vc::PS4Button::SQUARE, BTN_SOUTH);
 
-  usleep(5'000'000);
+  code = controller.wait_ready(5'000);
+  if (code != vc::error::OK) {
+    printf("Controller did not come up: %u\n", code);
+    return 1;
+  }
   printf("Simulated PS4 Controller created\n");
 
   controller.move_stick(vc::PS4Stick::LEFT_X, 0xff);
   controller.sync();
 
-  // Test repeatedly press the cross button
-  vc::i32 state = 0;
-  vc::PS4Button button = vc::PS4Button::CROSS;
+  vc::FrameScheduler scheduler{};
+  code = scheduler.init(60U);
+  if (code != vc::error::OK) {
+    printf("Could not initialize scheduler: %u\n", code);
+    return 1;
+  }
+
+  // Test repeatedly press the cross button, held 2s then released 2s
+  vc::TurboEngine turbo{};
+  turbo.set(
+      0U, vc::PS4Button::CROSS, vc::TurboPattern{.rate = 0.25F, .duty = 0.5F}
+  );
+  scheduler.start();
+  if (script != nullptr) {
+    (void)executor.start(slot, true);
+  }
   while (running) {
-    switch (state) {
-    case 0:
-      controller.press_button(button);
-      break;
-
-    case 1:
-      controller.release_button(button);
-      break;
-
-    default:
-      state = 0;
-      continue;
+    if (reload && script != nullptr) {
+      reload = 0;
+      vc::ScriptError error{};
+      if (slot.load_file(script, &error) == vc::error::OK) {
+        printf("Reloaded %s, applies on the next loop\n", script);
+      } else {
+        printf(
+            "Could not reload %s:%u: %s\n", script, error.line, error.message
+        );
+      }
     }
 
-    ++state;
-    controller.sync();
+    if (script != nullptr) {
+      running = executor.update(controller, vc::timing::now_ns()) && running;
+    } else if (turbo.update(vc::timing::now_ns(), &controller, 1U) != 0U) {
+      controller.sync();
+    }
+
+    vc::FFEvent effect{};
+    while (controller.get_force_feedback()->poll(effect)) {
+      if (effect.type == vc::FFEventType::PLAY) {
+        printf("Rumble effect %d played\n", effect.id);
+      }
+    }
 
-    usleep(1'000'000 / 60 * 120);
+    scheduler.wait();
   }
 
+  const vc::FrameStats& stats = scheduler.get_stats();
+  printf(
+      "Frames: %lu ; Overruns: %lu ; Max lateness: %ldns\n", stats.frames,
+      stats.overruns, stats.max_lateness
+  );
+  controller.get_stats().print(stdout, "Controller");
+
   controller.release_button(vc::PS4Button::CROSS);
   controller.sync();
 
@@ -0,0 +1,314 @@
+#include "./engine.hpp"
+#include "../controller/pool.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace vc {
+
+namespace {
+
+constexpr usize SINE_BITS = 10U;
+constexpr usize SINE_SIZE = 1U << SINE_BITS;
+
+// One turn of sine, with an extra entry so the interpolation never wraps
+const std::array<f32, SINE_SIZE + 1U> SINE = [] {
+  std::array<f32, SINE_SIZE + 1U> table{};
+  for (usize i = 0U; i <= SINE_SIZE; ++i) {
+    table[i] = static_cast<f32>(std::sin(2.0 * M_PI * i / SINE_SIZE));
+  }
+  return table;
+}();
+
+// Angle in turns, any value
+[[nodiscard]] f32 sine(f32 turns) noexcept {
+  f32 position = (turns - std::floor(turns)) * SINE_SIZE;
+  // Rounding of tiny negative turns can land on the last entry
+  usize index = std::min(static_cast<usize>(position), SINE_SIZE - 1U);
+  f32 fraction = position - static_cast<f32>(index);
+  return SINE[index] + (SINE[index + 1U] - SINE[index]) * fraction;
+}
+
+[[nodiscard]] f32 cosine(f32 turns) noexcept {
+  return sine(turns + 0.25F);
+}
+
+[[nodiscard]] u8 to_axis(f32 value) noexcept {
+  // Same conversion as move_stickf
+  return std::clamp(static_cast<i32>(0xff * value), 0x00, 0xff);
+}
+
+[[nodiscard]] u32 to_key(u32 device, StickPair pair) noexcept {
+  return device * 2U + static_cast<u32>(pair);
+}
+
+// Swaps the last element into the index then pops it
+template <typename T>
+void swap_remove(std::vector<T>& values, u32 index) noexcept {
+  values[index] = values.back();
+  values.pop_back();
+}
+
+} // namespace
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::move(
+    u32 device, StickPair pair, Point from, Point to, i64 duration_ns,
+    Curve curve, i64 start_ns
+) noexcept {
+  // A bezier with evenly spaced control points on the line is the line
+  Point delta{.x = (to.x - from.x) / 3.0F, .y = (to.y - from.y) / 3.0F};
+  this->bezier(
+      device, pair, from,
+      Point{.x = from.x + delta.x, .y = from.y + delta.y},
+      Point{.x = to.x - delta.x, .y = to.y - delta.y}, to, duration_ns, curve,
+      start_ns
+  );
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::bezier(
+    u32 device, StickPair pair, Point p0, Point p1, Point p2, Point p3,
+    i64 duration_ns, Curve curve, i64 start_ns
+) noexcept {
+  u32 key = to_key(device, pair);
+  this->remove(key);
+
+  u32 index = this->add(this->beziers, key, duration_ns, curve, start_ns);
+  this->p0.push_back(p0);
+  this->p1.push_back(p1);
+  this->p2.push_back(p2);
+  this->p3.push_back(p3);
+  this->slots[key] = index;
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::circle(
+    u32 device, StickPair pair, Point center, f32 radius, f32 start,
+    f32 sweep, i64 duration_ns, Curve curve, i64 start_ns
+) noexcept {
+  u32 key = to_key(device, pair);
+  this->remove(key);
+
+  u32 index = this->add(this->circles, key, duration_ns, curve, start_ns);
+  this->centers.push_back(center);
+  this->radii.push_back(radius);
+  this->angles.push_back(start);
+  this->sweeps.push_back(sweep);
+  this->slots[key] = index | CIRCLE_BIT;
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::cancel(u32 device, StickPair pair) noexcept {
+  this->remove(to_key(device, pair));
+}
+
+template <typename Sink> void BasicMotionEngine<Sink>::clear() noexcept {
+  for (Timing* timing : {&this->beziers, &this->circles}) {
+    timing->keys.clear();
+    timing->starts.clear();
+    timing->ends.clear();
+    timing->inv_durations.clear();
+    timing->curves.clear();
+  }
+  this->p0.clear();
+  this->p1.clear();
+  this->p2.clear();
+  this->p3.clear();
+  this->centers.clear();
+  this->radii.clear();
+  this->angles.clear();
+  this->sweeps.clear();
+  std::fill(this->slots.begin(), this->slots.end(), NO_SLOT);
+}
+
+template <typename Sink>
+usize BasicMotionEngine<Sink>::update(
+    i64 now_ns, BasicPS4Controller<Sink>* controllers, usize count
+) noexcept {
+  for (Timing* timing : {&this->beziers, &this->circles}) {
+    usize size = timing->keys.size();
+    timing->progress.resize(size);
+
+    // Branch free so it vectorizes, every curve is evaluated then selected
+    for (usize i = 0U; i < size; ++i) {
+      f32 t = static_cast<f32>(now_ns - timing->starts[i]) *
+              timing->inv_durations[i];
+      t = now_ns >= timing->ends[i] ? 1.0F : std::clamp(t, 0.0F, 1.0F);
+
+      f32 ease_in = t * t;
+      f32 ease_out = t * (2.0F - t);
+      f32 ease_in_out = t * t * (3.0F - 2.0F * t);
+      Curve curve = timing->curves[i];
+      timing->progress[i] = curve == Curve::EASE_IN       ? ease_in
+                            : curve == Curve::EASE_OUT    ? ease_out
+                            : curve == Curve::EASE_IN_OUT ? ease_in_out
+                                                          : t;
+    }
+  }
+
+  usize size = this->beziers.keys.size();
+  this->positions.resize(std::max(size, this->circles.keys.size()));
+  for (usize i = 0U; i < size; ++i) {
+    f32 t = this->beziers.progress[i];
+    f32 u = 1.0F - t;
+    f32 w0 = u * u * u;
+    f32 w1 = 3.0F * u * u * t;
+    f32 w2 = 3.0F * u * t * t;
+    f32 w3 = t * t * t;
+    this->positions[i] = Point{
+        .x = w0 * this->p0[i].x + w1 * this->p1[i].x + w2 * this->p2[i].x +
+             w3 * this->p3[i].x,
+        .y = w0 * this->p0[i].y + w1 * this->p1[i].y + w2 * this->p2[i].y +
+             w3 * this->p3[i].y,
+    };
+  }
+  this->apply(this->beziers, now_ns, controllers, count);
+  for (usize i = this->beziers.keys.size(); i-- > 0U;) {
+    if (now_ns >= this->beziers.ends[i] ||
+        this->beziers.keys[i] / 2U >= count) {
+      this->remove_bezier(i);
+    }
+  }
+
+  size = this->circles.keys.size();
+  for (usize i = 0U; i < size; ++i) {
+    f32 angle = this->angles[i] + this->sweeps[i] * this->circles.progress[i];
+    this->positions[i] = Point{
+        .x = this->centers[i].x + this->radii[i] * cosine(angle),
+        .y = this->centers[i].y + this->radii[i] * sine(angle),
+    };
+  }
+  this->apply(this->circles, now_ns, controllers, count);
+  for (usize i = this->circles.keys.size(); i-- > 0U;) {
+    if (now_ns >= this->circles.ends[i] ||
+        this->circles.keys[i] / 2U >= count) {
+      this->remove_circle(i);
+    }
+  }
+
+  return this->size();
+}
+
+template <typename Sink>
+usize BasicMotionEngine<Sink>::update(
+    i64 now_ns, BasicControllerPool<Sink>& pool
+) noexcept {
+  usize count = pool.get_controller_count();
+  return this->update(
+      now_ns, count == 0U ? nullptr : &pool.get_controller(0U), count
+  );
+}
+
+template <typename Sink>
+usize BasicMotionEngine<Sink>::size() const noexcept {
+  return this->beziers.keys.size() + this->circles.keys.size();
+}
+
+template <typename Sink>
+u32 BasicMotionEngine<Sink>::add(
+    Timing& timing, u32 key, i64 duration_ns, Curve curve, i64 start_ns
+) noexcept {
+  if (start_ns == 0) {
+    start_ns = timing::now_ns();
+  }
+  duration_ns = std::max<i64>(duration_ns, 0);
+
+  if (key >= this->slots.size()) {
+    this->slots.resize(key + 1U, NO_SLOT);
+  }
+
+  timing.keys.push_back(key);
+  timing.starts.push_back(start_ns);
+  timing.ends.push_back(start_ns + duration_ns);
+  // Instant moves are handled by the end time
+  timing.inv_durations.push_back(
+      duration_ns == 0 ? 0.0F : 1.0F / static_cast<f32>(duration_ns)
+  );
+  timing.curves.push_back(curve);
+  return static_cast<u32>(timing.keys.size() - 1U);
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::remove(u32 key) noexcept {
+  if (key >= this->slots.size() || this->slots[key] == NO_SLOT) {
+    return;
+  }
+
+  u32 slot = this->slots[key];
+  if (slot & CIRCLE_BIT) {
+    this->remove_circle(slot & ~CIRCLE_BIT);
+  } else {
+    this->remove_bezier(slot);
+  }
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::remove_bezier(u32 index) noexcept {
+  Timing& timing = this->beziers;
+  this->slots[timing.keys[index]] = NO_SLOT;
+  if (index + 1U != timing.keys.size()) {
+    this->slots[timing.keys.back()] = index;
+  }
+
+  swap_remove(timing.keys, index);
+  swap_remove(timing.starts, index);
+  swap_remove(timing.ends, index);
+  swap_remove(timing.inv_durations, index);
+  swap_remove(timing.curves, index);
+  swap_remove(this->p0, index);
+  swap_remove(this->p1, index);
+  swap_remove(this->p2, index);
+  swap_remove(this->p3, index);
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::remove_circle(u32 index) noexcept {
+  Timing& timing = this->circles;
+  this->slots[timing.keys[index]] = NO_SLOT;
+  if (index + 1U != timing.keys.size()) {
+    this->slots[timing.keys.back()] = index | CIRCLE_BIT;
+  }
+
+  swap_remove(timing.keys, index);
+  swap_remove(timing.starts, index);
+  swap_remove(timing.ends, index);
+  swap_remove(timing.inv_durations, index);
+  swap_remove(timing.curves, index);
+  swap_remove(this->centers, index);
+  swap_remove(this->radii, index);
+  swap_remove(this->angles, index);
+  swap_remove(this->sweeps, index);
+}
+
+template <typename Sink>
+void BasicMotionEngine<Sink>::apply(
+    const Timing& timing, i64 now_ns, BasicPS4Controller<Sink>* controllers,
+    usize count
+) noexcept {
+  for (usize i = 0U; i < timing.keys.size(); ++i) {
+    u32 device = timing.keys[i] / 2U;
+    if (device >= count || now_ns < timing.starts[i]) {
+      continue;
+    }
+
+    // Controllers dedupe, only the axes that changed are emitted
+    auto& controller = controllers[device];
+    const Point& position = this->positions[i];
+    if (timing.keys[i] & 1U) {
+      controller.move_stick(PS4Stick::RIGHT_X, to_axis(position.x));
+      controller.move_stick(PS4Stick::RIGHT_Y, to_axis(position.y));
+    } else {
+      controller.move_stick(PS4Stick::LEFT_X, to_axis(position.x));
+      controller.move_stick(PS4Stick::LEFT_Y, to_axis(position.y));
+    }
+  }
+}
+
+template class BasicMotionEngine<uinput::UinputSink>;
+template class BasicMotionEngine<uinput::NullSink>;
+template class BasicMotionEngine<uinput::RingSink>;
+template class BasicMotionEngine<uinput::FileSink>;
+
+} // namespace vc
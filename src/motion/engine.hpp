@@ -0,0 +1,152 @@
+#ifndef VC_MOTION_ENGINE_HPP
+#define VC_MOTION_ENGINE_HPP
+
+#include "../controller/ps4.hpp"
+#include "../types.hpp"
+#include <vector>
+
+namespace vc {
+
+template <typename Sink> class BasicControllerPool;
+
+enum class Curve : u8 {
+  LINEAR,
+  EASE_IN,
+  EASE_OUT,
+  EASE_IN_OUT,
+};
+
+enum class StickPair : u8 {
+  // LEFT_X and LEFT_Y
+  LEFT,
+  // RIGHT_X and RIGHT_Y
+  RIGHT,
+};
+
+// Position of a stick pair, [0.0F, 1.0F] per axis and 0.5F is neutral
+struct Point {
+  f32 x;
+  f32 y;
+};
+
+/**
+ * Moves sticks along trajectories over time.
+ * Trajectories are kept as structure of arrays per kind, every update
+ * evaluates all of them in tight loops (the bezier pass vectorizes, circles
+ * use a sine table) then moves the sticks of the devices, which only emit
+ * the values that changed. Call it before syncing the devices of the tick.
+ *
+ * A trajectory replaces the previous one of the same device and stick pair,
+ * it is removed once its duration elapsed and its end position was set.
+ *
+ * engine.move(0U, StickPair::LEFT, {0.5F, 0.5F}, {1.0F, 0.5F}, 250'000'000);
+ * while (running) {
+ *   engine.update(timing::now_ns(), pool);
+ *   pool.flush();
+ *   pool.wait();
+ * }
+ *
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicMotionEngine {
+public:
+  /**
+   * Straight line between two positions
+   * @param device - index of the controller passed to update
+   * @param start_ns - CLOCK_MONOTONIC time the motion starts, 0 for now
+   */
+  void move(
+      u32 device, StickPair pair, Point from, Point to, i64 duration_ns,
+      Curve curve = Curve::LINEAR, i64 start_ns = 0
+  ) noexcept;
+
+  // Cubic bezier from p0 to p3, p1 and p2 are the control points
+  void bezier(
+      u32 device, StickPair pair, Point p0, Point p1, Point p2, Point p3,
+      i64 duration_ns, Curve curve = Curve::LINEAR, i64 start_ns = 0
+  ) noexcept;
+
+  /**
+   * Sweeps around a center, angles are in turns starting from +x towards +y
+   * @param sweep - negative turns go the other way, can exceed a full turn
+   */
+  void circle(
+      u32 device, StickPair pair, Point center, f32 radius, f32 start,
+      f32 sweep, i64 duration_ns, Curve curve = Curve::LINEAR,
+      i64 start_ns = 0
+  ) noexcept;
+
+  // Stops the trajectory of the stick pair, the stick stays where it is
+  void cancel(u32 device, StickPair pair) noexcept;
+  void clear() noexcept;
+
+  /**
+   * Moves the sticks of every trajectory to their position at now
+   * @param controllers - contiguous devices, indexed by the device of the
+   *   trajectories. Trajectories of devices past count are dropped
+   * @return number of trajectories still running
+   */
+  usize update(
+      i64 now_ns, BasicPS4Controller<Sink>* controllers, usize count
+  ) noexcept;
+  usize update(i64 now_ns, BasicControllerPool<Sink>& pool) noexcept;
+
+  // Number of trajectories running
+  [[nodiscard]] usize size() const noexcept;
+
+private:
+  static constexpr u32 NO_SLOT = UINT32_MAX;
+  // Set in a slot when it refers to a circle
+  static constexpr u32 CIRCLE_BIT = 1U << 31U;
+
+  // Common to every kind of trajectory
+  struct Timing {
+    std::vector<u32> keys{};
+    std::vector<i64> starts{};
+    std::vector<i64> ends{};
+    std::vector<f32> inv_durations{};
+    std::vector<Curve> curves{};
+    // Scratch, eased progress of the current update
+    std::vector<f32> progress{};
+  };
+
+  Timing beziers{};
+  std::vector<Point> p0{};
+  std::vector<Point> p1{};
+  std::vector<Point> p2{};
+  std::vector<Point> p3{};
+
+  Timing circles{};
+  std::vector<Point> centers{};
+  std::vector<f32> radii{};
+  std::vector<f32> angles{};
+  std::vector<f32> sweeps{};
+
+  // Scratch, evaluated positions of the current update
+  std::vector<Point> positions{};
+
+  // Key (device * 2 + pair) to the index in its kind, NO_SLOT if none
+  std::vector<u32> slots{};
+
+  [[nodiscard]] u32 add(
+      Timing& timing, u32 key, i64 duration_ns, Curve curve, i64 start_ns
+  ) noexcept;
+  void remove(u32 key) noexcept;
+  void remove_bezier(u32 index) noexcept;
+  void remove_circle(u32 index) noexcept;
+  void apply(
+      const Timing& timing, i64 now_ns, BasicPS4Controller<Sink>* controllers,
+      usize count
+  ) noexcept;
+};
+
+using MotionEngine = BasicMotionEngine<uinput::UinputSink>;
+
+extern template class BasicMotionEngine<uinput::UinputSink>;
+extern template class BasicMotionEngine<uinput::NullSink>;
+extern template class BasicMotionEngine<uinput::RingSink>;
+extern template class BasicMotionEngine<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef VC_QUEUE_MPSC_HPP
+#define VC_QUEUE_MPSC_HPP
+
+#include "../types.hpp"
+#include <array>
+#include <atomic>
+
+namespace vc {
+
+/**
+ * Lock free bounded multi producer single consumer ring.
+ * Producers claim a slot by bumping the shared head, every slot carries a
+ * sequence number telling whether it is free or written, so a producer
+ * preempted mid write only stalls the consumer at its slot.
+ * The head, the tail and the slots live on separate cache lines so the
+ * producers don't invalidate the consumer cursor and the other way around.
+ * N needs to be a power of 2
+ */
+template <typename T, usize N> class MpscRing {
+  static_assert((N & (N - 1U)) == 0U, "N needs to be a power of 2");
+
+public:
+  MpscRing() noexcept {
+    for (u64 i = 0U; i < N; ++i) {
+      this->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRing(const MpscRing&) = delete;
+  MpscRing& operator=(const MpscRing&) = delete;
+  MpscRing(MpscRing&&) = delete;
+  MpscRing& operator=(MpscRing&&) = delete;
+
+  ~MpscRing() noexcept = default;
+
+  // Can be called from any thread, returns false if the ring is full
+  [[nodiscard]] bool push(const T& value) noexcept {
+    u64 head = this->head.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = this->slots[head & (N - 1U)];
+      u64 sequence = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<i64>(sequence - head);
+      if (diff == 0) {
+        if (this->head.compare_exchange_weak(
+                head, head + 1U, std::memory_order_relaxed
+            )) {
+          slot.value = value;
+          slot.sequence.store(head + 1U, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // Slot still holds a value from the previous lap
+        return false;
+      } else {
+        head = this->head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Only called by the consumer, returns false if the ring is empty
+  [[nodiscard]] bool pop(T& value) noexcept {
+    Slot& slot = this->slots[this->tail & (N - 1U)];
+    if (slot.sequence.load(std::memory_order_acquire) != this->tail + 1U) {
+      return false;
+    }
+
+    value = slot.value;
+    slot.sequence.store(this->tail + N, std::memory_order_release);
+    ++this->tail;
+    return true;
+  }
+
+private:
+  struct Slot {
+    std::atomic<u64> sequence{0U};
+    T value{};
+  };
+
+  alignas(64) std::atomic<u64> head{0U};
+  // Only touched by the consumer
+  alignas(64) u64 tail = 0U;
+  alignas(64) std::array<Slot, N> slots{};
+};
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef VC_QUEUE_SPSC_HPP
+#define VC_QUEUE_SPSC_HPP
+
+#include "../types.hpp"
+#include <array>
+#include <atomic>
+
+namespace vc {
+
+/**
+ * Lock free single producer single consumer ring.
+ * N needs to be a power of 2. The cursors live on their own cache lines so
+ * the producer and consumer don't invalidate each other
+ */
+template <typename T, usize N> class SpscRing {
+  static_assert((N & (N - 1U)) == 0U, "N needs to be a power of 2");
+
+public:
+  // Returns false if the ring is full
+  [[nodiscard]] bool push(const T& value) noexcept {
+    u64 head = this->head.load(std::memory_order_relaxed);
+    if (head - this->tail.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+
+    this->values[head & (N - 1U)] = value;
+    this->head.store(head + 1U, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false if the ring is empty
+  [[nodiscard]] bool pop(T& value) noexcept {
+    u64 tail = this->tail.load(std::memory_order_relaxed);
+    if (tail == this->head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    value = this->values[tail & (N - 1U)];
+    this->tail.store(tail + 1U, std::memory_order_release);
+    return true;
+  }
+
+  // Oldest value without removing it, nullptr if the ring is empty.
+  // Only the consumer calls it, valid until its next pop
+  [[nodiscard]] const T* peek() const noexcept {
+    u64 tail = this->tail.load(std::memory_order_relaxed);
+    if (tail == this->head.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &this->values[tail & (N - 1U)];
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return this->tail.load(std::memory_order_acquire) ==
+           this->head.load(std::memory_order_acquire);
+  }
+
+private:
+  alignas(64) std::atomic<u64> head{0U};
+  alignas(64) std::atomic<u64> tail{0U};
+  alignas(64) std::array<T, N> values{};
+};
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef VC_RECORD_FORMAT_HPP
+#define VC_RECORD_FORMAT_HPP
+
+#include "../types.hpp"
+#include <array>
+
+/**
+ * Recording file layout, all integers are little endian
+ *
+ * Header (8 bytes): "VCR" + version (u8) + reserved (u32)
+ *
+ * Frames, one per write of a device:
+ *   varint  microseconds since the previous frame
+ *   u8      device index given to the recorder
+ *   varint  number of events
+ *   events:
+ *     u8      type
+ *     varint  code
+ *     varint  zigzag encoded value
+ *
+ * Most frames of a controller take 5 to 10 bytes
+ */
+
+namespace vc::record {
+
+constexpr std::array<u8, 4> MAGIC{'V', 'C', 'R', 1U};
+constexpr usize HEADER_SIZE = 8U;
+
+// Longest encoding of a u64
+constexpr usize VARINT_MAX = 10U;
+
+// Writes the varint into out, returns the number of bytes written
+inline usize encode_varint(u64 value, u8* out) noexcept {
+  usize size = 0U;
+  while (value >= 0x80U) {
+    out[size++] = static_cast<u8>(value) | 0x80U;
+    value >>= 7U;
+  }
+  out[size++] = static_cast<u8>(value);
+  return size;
+}
+
+// Returns nullptr if the varint does not end before end
+inline const u8*
+decode_varint(const u8* in, const u8* end, u64& value) noexcept {
+  value = 0U;
+  for (u32 shift = 0U; in != end && shift < 64U; shift += 7U) {
+    u8 byte = *in++;
+    value |= static_cast<u64>(byte & 0x7fU) << shift;
+    if ((byte & 0x80U) == 0U) {
+      return in;
+    }
+  }
+  return nullptr;
+}
+
+[[nodiscard]] inline u64 zigzag(i32 value) noexcept {
+  return (static_cast<u32>(value) << 1U) ^ static_cast<u32>(value >> 31);
+}
+
+[[nodiscard]] inline i32 unzigzag(u64 value) noexcept {
+  return static_cast<i32>((value >> 1U) ^ (~(value & 1U) + 1U));
+}
+
+} // namespace vc::record
+
+#endif
@@ -0,0 +1,163 @@
+#include "./player.hpp"
+#include "./format.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vc {
+
+Player::Player(Player&& other) noexcept
+    : data(other.data),
+      size(other.size),
+      offset(other.offset),
+      released(other.released),
+      time(other.time),
+      corrupted(other.corrupted) {
+  other.data = nullptr;
+  other.size = 0U;
+}
+
+Player& Player::operator=(Player&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close();
+
+  this->data = rhs.data;
+  this->size = rhs.size;
+  this->offset = rhs.offset;
+  this->released = rhs.released;
+  this->time = rhs.time;
+  this->corrupted = rhs.corrupted;
+  rhs.data = nullptr;
+  rhs.size = 0U;
+
+  return *this;
+}
+
+Player::~Player() noexcept {
+  this->close();
+}
+
+error_code Player::open(const c8* path) noexcept {
+  this->close();
+
+  i32 fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return error::RECORD_OPEN;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) == -1 ||
+      static_cast<usize>(info.st_size) < record::HEADER_SIZE) {
+    ::close(fd);
+    return error::RECORD_FORMAT;
+  }
+
+  void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return error::RECORD_OPEN;
+  }
+
+  this->data = static_cast<const u8*>(mapped);
+  this->size = info.st_size;
+  if (!std::equal(record::MAGIC.begin(), record::MAGIC.end(), this->data)) {
+    this->close();
+    return error::RECORD_FORMAT;
+  }
+
+  madvise(mapped, this->size, MADV_SEQUENTIAL);
+  this->rewind();
+  return error::OK;
+}
+
+void Player::close() noexcept {
+  if (this->data == nullptr) {
+    return;
+  }
+
+  munmap(const_cast<u8*>(this->data), this->size);
+  this->data = nullptr;
+  this->size = 0U;
+}
+
+bool Player::next(ReplayFrame& frame) noexcept {
+  const u8* in = this->data + this->offset;
+  const u8* end = this->data + this->size;
+  if (in == end) {
+    return false;
+  }
+
+  u64 delta = 0U;
+  u64 count = 0U;
+  in = record::decode_varint(in, end, delta);
+  if (in == nullptr || in == end) {
+    this->corrupted = true;
+    return false;
+  }
+  frame.device = *in++;
+  in = record::decode_varint(in, end, count);
+  if (in == nullptr || count > frame.events.size()) {
+    this->corrupted = true;
+    return false;
+  }
+
+  for (u64 i = 0U; i < count; ++i) {
+    u64 code = 0U;
+    u64 value = 0U;
+    if (in == end) {
+      this->corrupted = true;
+      return false;
+    }
+    auto& event = frame.events[i];
+    event.type = *in++;
+    in = record::decode_varint(in, end, code);
+    if (in == nullptr) {
+      this->corrupted = true;
+      return false;
+    }
+    in = record::decode_varint(in, end, value);
+    if (in == nullptr) {
+      this->corrupted = true;
+      return false;
+    }
+    event.code = static_cast<u16>(code);
+    event.value = record::unzigzag(value);
+  }
+
+  this->time += static_cast<i64>(delta) * timing::NS_PER_US;
+  frame.time = this->time;
+  frame.count = count;
+  this->offset = in - this->data;
+
+  // Drop the pages already played so long recordings don't pile up in memory
+  if (this->offset - this->released >= RELEASE_SIZE) {
+    usize page = sysconf(_SC_PAGESIZE);
+    usize until = this->offset / page * page;
+    madvise(
+        const_cast<u8*>(this->data) + this->released, until - this->released,
+        MADV_DONTNEED
+    );
+    this->released = until;
+  }
+
+  return true;
+}
+
+void Player::rewind() noexcept {
+  this->offset = record::HEADER_SIZE;
+  this->released = 0U;
+  this->time = 0;
+  this->corrupted = false;
+}
+
+bool Player::is_corrupted() const noexcept {
+  return this->corrupted;
+}
+
+} // namespace vc
@@ -0,0 +1,87 @@
+#ifndef VC_RECORD_PLAYER_HPP
+#define VC_RECORD_PLAYER_HPP
+
+#include "../timing/clock.hpp"
+#include "../timing/scheduler.hpp"
+#include "../types.hpp"
+#include "../uinput/frame.hpp"
+#include <array>
+#include <linux/input.h>
+
+namespace vc {
+
+struct ReplayFrame {
+  // Time since the start of the recording in ns
+  i64 time = 0;
+  u8 device = 0U;
+  usize count = 0U;
+  std::array<input_event, uinput::FRAME_CAPACITY> events{};
+};
+
+/**
+ * Reads a file written by the Recorder. The file is memory mapped and read
+ * sequentially, pages behind the cursor are released so memory stays bounded
+ * for long recordings. Nothing is allocated after open
+ */
+class Player {
+public:
+  Player() noexcept = default;
+  Player(const Player&) = delete;
+  Player& operator=(const Player&) = delete;
+
+  Player(Player&& other) noexcept;
+  Player& operator=(Player&& rhs) noexcept;
+
+  ~Player() noexcept;
+
+  [[nodiscard]] error_code open(const c8* path) noexcept;
+  void close() noexcept;
+
+  // Decodes the next frame, returns false at the end or on a corrupted frame
+  [[nodiscard]] bool next(ReplayFrame& frame) noexcept;
+  void rewind() noexcept;
+  // Whether the last call to next stopped on a corrupted frame
+  [[nodiscard]] bool is_corrupted() const noexcept;
+
+  /**
+   * Writes every remaining frame to sinks[frame.device] at its recorded time.
+   * Frames of devices without a sink are skipped
+   * @param speed - 2.0 plays twice as fast, 0 plays as fast as possible
+   * @return number of frames played
+   */
+  template <typename Sink>
+  u64 play(
+      Sink* const* sinks, usize sink_count, f64 speed,
+      FrameScheduler& scheduler
+  ) noexcept {
+    ReplayFrame frame{};
+    u64 played = 0U;
+    i64 start = timing::now_ns();
+    while (this->next(frame)) {
+      if (speed > 0.0) {
+        scheduler.wait_until(start + static_cast<i64>(frame.time / speed));
+      }
+
+      if (frame.device < sink_count && sinks[frame.device] != nullptr) {
+        sinks[frame.device]->write(frame.events.data(), frame.count);
+        ++played;
+      }
+    }
+    return played;
+  }
+
+private:
+  // Released every time the cursor moves past this many bytes
+  static constexpr usize RELEASE_SIZE = 1U << 20U;
+
+  const u8* data = nullptr;
+  usize size = 0U;
+  usize offset = 0U;
+  usize released = 0U;
+  i64 time = 0;
+  bool corrupted = false;
+};
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,146 @@
+#include "./recorder.hpp"
+#include "../timing/clock.hpp"
+#include "../uinput/frame.hpp"
+#include "./format.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace vc {
+
+Recorder::Recorder(Recorder&& other) noexcept
+    : buffer(other.buffer),
+      size(other.size),
+      last_time(other.last_time),
+      frames(other.frames),
+      bytes(other.bytes),
+      fd(other.fd) {
+  other.fd = -1;
+  other.size = 0U;
+}
+
+Recorder& Recorder::operator=(Recorder&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close();
+
+  this->buffer = rhs.buffer;
+  this->size = rhs.size;
+  this->last_time = rhs.last_time;
+  this->frames = rhs.frames;
+  this->bytes = rhs.bytes;
+  this->fd = rhs.fd;
+  rhs.fd = -1;
+  rhs.size = 0U;
+
+  return *this;
+}
+
+Recorder::~Recorder() noexcept {
+  this->close();
+}
+
+error_code Recorder::open(const c8* path) noexcept {
+  this->close();
+
+  this->fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (this->fd == -1) {
+    return error::RECORD_OPEN;
+  }
+
+  std::copy(record::MAGIC.begin(), record::MAGIC.end(), this->buffer.begin());
+  std::fill_n(this->buffer.begin() + record::MAGIC.size(), 4U, 0U);
+  this->size = record::HEADER_SIZE;
+  this->bytes = record::HEADER_SIZE;
+  this->frames = 0U;
+  this->last_time = timing::now_ns();
+
+  return error::OK;
+}
+
+error_code Recorder::flush() noexcept {
+  usize offset = 0U;
+  while (offset < this->size) {
+    isize written =
+        write(this->fd, this->buffer.data() + offset, this->size - offset);
+    if (written <= 0) {
+      // The frames are lost either way, don't let them block the next ones
+      this->size = 0U;
+      return error::RECORD_WRITE;
+    }
+    offset += written;
+  }
+
+  this->size = 0U;
+  return error::OK;
+}
+
+void Recorder::close() noexcept {
+  if (this->fd == -1) {
+    return;
+  }
+
+  (void)this->flush();
+  ::close(this->fd);
+  this->fd = -1;
+}
+
+void Recorder::record(
+    u8 device, const input_event* events, usize count
+) noexcept {
+  this->record(device, timing::now_ns(), events, count);
+}
+
+void Recorder::record(
+    u8 device, i64 time_ns, const input_event* events, usize count
+) noexcept {
+  if (this->fd == -1 || count == 0U) {
+    return;
+  }
+
+  // Keeps every frame small enough for the player
+  while (count > uinput::FRAME_CAPACITY) {
+    this->record(device, time_ns, events, uinput::FRAME_CAPACITY);
+    events += uinput::FRAME_CAPACITY;
+    count -= uinput::FRAME_CAPACITY;
+  }
+
+  if (this->size + MAX_HEADER_SIZE + MAX_EVENT_SIZE * count >
+      this->buffer.size()) {
+    (void)this->flush();
+  }
+
+  // Rounded down, the remainder is carried over to the next frame. Times
+  // before the last frame are recorded along with it
+  i64 elapsed = std::max<i64>(time_ns - this->last_time, 0);
+  u64 delta = static_cast<u64>(elapsed) / timing::NS_PER_US;
+  this->last_time += static_cast<i64>(delta) * timing::NS_PER_US;
+
+  usize start = this->size;
+  u8* out = this->buffer.data();
+  this->size += record::encode_varint(delta, out + this->size);
+  out[this->size++] = device;
+  this->size += record::encode_varint(count, out + this->size);
+  for (usize i = 0U; i < count; ++i) {
+    out[this->size++] = static_cast<u8>(events[i].type);
+    this->size += record::encode_varint(events[i].code, out + this->size);
+    this->size += record::encode_varint(
+        record::zigzag(events[i].value), out + this->size
+    );
+  }
+
+  ++this->frames;
+  this->bytes += this->size - start;
+}
+
+u64 Recorder::get_frames() const noexcept {
+  return this->frames;
+}
+
+u64 Recorder::get_bytes() const noexcept {
+  return this->bytes;
+}
+
+} // namespace vc
@@ -0,0 +1,59 @@
+#ifndef VC_RECORD_RECORDER_HPP
+#define VC_RECORD_RECORDER_HPP
+
+#include "../types.hpp"
+#include <array>
+#include <linux/input.h>
+
+namespace vc {
+
+/**
+ * Writes every frame the attached devices emit into a compact binary file,
+ * see record/format.hpp. Attach it with set_recorder on the devices.
+ * Not thread safe, all devices attached to a recorder should be driven by the
+ * same thread
+ */
+class Recorder {
+public:
+  Recorder() noexcept = default;
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+
+  Recorder(Recorder&& other) noexcept;
+  Recorder& operator=(Recorder&& rhs) noexcept;
+
+  // Flushes the remaining frames
+  ~Recorder() noexcept;
+
+  [[nodiscard]] error_code open(const c8* path) noexcept;
+  // Writes the buffered frames to the file
+  [[nodiscard]] error_code flush() noexcept;
+  void close() noexcept;
+
+  // Timestamps the frame with the current time and buffers it
+  void record(u8 device, const input_event* events, usize count) noexcept;
+  // Same with the CLOCK_MONOTONIC time the frame is written at, in ns
+  void record(
+      u8 device, i64 time_ns, const input_event* events, usize count
+  ) noexcept;
+
+  [[nodiscard]] u64 get_frames() const noexcept;
+  [[nodiscard]] u64 get_bytes() const noexcept;
+
+private:
+  static constexpr usize BUFFER_SIZE = 64U * 1024U;
+  // Largest encodings of the frame header and of an event
+  static constexpr usize MAX_HEADER_SIZE = 24U;
+  static constexpr usize MAX_EVENT_SIZE = 16U;
+
+  std::array<u8, BUFFER_SIZE> buffer{};
+  usize size = 0U;
+  i64 last_time = 0;
+  u64 frames = 0U;
+  u64 bytes = 0U;
+  i32 fd = -1;
+};
+
+} // namespace vc
+
+#endif
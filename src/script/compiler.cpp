@@ -0,0 +1,426 @@
+#include "./plan.hpp"
+#include "../controller/ps4.hpp"
+#include "../helper.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fcntl.h>
+#include <linux/input-event-codes.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vc {
+
+namespace {
+
+struct Name {
+  std::string_view name;
+  u16 code;
+};
+
+// NOLINTNEXTLINE
+#define VC_KEY(name) Name{#name, KEY_##name}
+
+// Every key the keyboard enables, KEY_ESC to KEY_KPDOT
+constexpr std::array KEYS{
+    VC_KEY(ESC),        VC_KEY(1),          VC_KEY(2),
+    VC_KEY(3),          VC_KEY(4),          VC_KEY(5),
+    VC_KEY(6),          VC_KEY(7),          VC_KEY(8),
+    VC_KEY(9),          VC_KEY(0),          VC_KEY(MINUS),
+    VC_KEY(EQUAL),      VC_KEY(BACKSPACE),  VC_KEY(TAB),
+    VC_KEY(Q),          VC_KEY(W),          VC_KEY(E),
+    VC_KEY(R),          VC_KEY(T),          VC_KEY(Y),
+    VC_KEY(U),          VC_KEY(I),          VC_KEY(O),
+    VC_KEY(P),          VC_KEY(LEFTBRACE),  VC_KEY(RIGHTBRACE),
+    VC_KEY(ENTER),      VC_KEY(LEFTCTRL),   VC_KEY(A),
+    VC_KEY(S),          VC_KEY(D),          VC_KEY(F),
+    VC_KEY(G),          VC_KEY(H),          VC_KEY(J),
+    VC_KEY(K),          VC_KEY(L),          VC_KEY(SEMICOLON),
+    VC_KEY(APOSTROPHE), VC_KEY(GRAVE),      VC_KEY(LEFTSHIFT),
+    VC_KEY(BACKSLASH),  VC_KEY(Z),          VC_KEY(X),
+    VC_KEY(C),          VC_KEY(V),          VC_KEY(B),
+    VC_KEY(N),          VC_KEY(M),          VC_KEY(COMMA),
+    VC_KEY(DOT),        VC_KEY(SLASH),      VC_KEY(RIGHTSHIFT),
+    VC_KEY(KPASTERISK), VC_KEY(LEFTALT),    VC_KEY(SPACE),
+    VC_KEY(CAPSLOCK),   VC_KEY(F1),         VC_KEY(F2),
+    VC_KEY(F3),         VC_KEY(F4),         VC_KEY(F5),
+    VC_KEY(F6),         VC_KEY(F7),         VC_KEY(F8),
+    VC_KEY(F9),         VC_KEY(F10),        VC_KEY(NUMLOCK),
+    VC_KEY(SCROLLLOCK), VC_KEY(KP7),        VC_KEY(KP8),
+    VC_KEY(KP9),        VC_KEY(KPMINUS),    VC_KEY(KP4),
+    VC_KEY(KP5),        VC_KEY(KP6),        VC_KEY(KPPLUS),
+    VC_KEY(KP1),        VC_KEY(KP2),        VC_KEY(KP3),
+    VC_KEY(KP0),        VC_KEY(KPDOT),
+    // Aliases
+    Name{"SHIFT", KEY_LEFTSHIFT},
+    Name{"CTRL", KEY_LEFTCTRL},
+    Name{"ALT", KEY_LEFTALT},
+};
+
+#undef VC_KEY
+
+constexpr std::array BUTTONS{
+    Name{"CROSS", PS4Button::CROSS},     Name{"CIRCLE", PS4Button::CIRCLE},
+    Name{"SQUARE", PS4Button::SQUARE},   Name{"TRIANGLE", PS4Button::TRIANGLE},
+    Name{"L1", PS4Button::L1},           Name{"R1", PS4Button::R1},
+    Name{"L2", PS4Button::L2},           Name{"R2", PS4Button::R2},
+    Name{"SHARE", PS4Button::SHARE},     Name{"OPTIONS", PS4Button::OPTIONS},
+    Name{"HOME", PS4Button::HOME},       Name{"L3", PS4Button::L3},
+    Name{"R3", PS4Button::R3},
+};
+
+constexpr std::array STICKS{
+    Name{"LX", PS4Stick::LEFT_X},
+    Name{"LY", PS4Stick::LEFT_Y},
+    Name{"RX", PS4Stick::RIGHT_X},
+    Name{"RY", PS4Stick::RIGHT_Y},
+};
+
+struct Direction {
+  std::string_view name;
+  u16 hat;
+  i32 value;
+};
+
+constexpr std::array DIRECTIONS{
+    Direction{"UP", PS4DPad::Y, -1},
+    Direction{"DOWN", PS4DPad::Y, 1},
+    Direction{"LEFT", PS4DPad::X, -1},
+    Direction{"RIGHT", PS4DPad::X, 1},
+};
+
+[[nodiscard]] bool equals(std::string_view lhs, std::string_view rhs) noexcept {
+  return lhs.size() == rhs.size() &&
+         strncasecmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+template <typename Table>
+[[nodiscard]] const typename Table::value_type*
+find(const Table& table, std::string_view name) noexcept {
+  for (const auto& entry : table) {
+    if (equals(entry.name, name)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+[[nodiscard]] bool is_space(c8 c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * Parses a number into a null terminated copy since the source is not.
+ * rest is what follows the number, ie. the unit
+ */
+[[nodiscard]] bool
+parse_number(std::string_view token, f64& value, std::string_view& rest) {
+  std::array<c8, 32> buffer{};
+  if (token.empty() || token.size() >= buffer.size()) {
+    return false;
+  }
+
+  std::copy(token.begin(), token.end(), buffer.begin());
+  c8* end = nullptr;
+  value = strtod(buffer.data(), &end);
+  if (end == buffer.data()) {
+    return false;
+  }
+  rest = token.substr(end - buffer.data());
+  return true;
+}
+
+class Compiler {
+public:
+  Compiler(PlanTarget target, Plan& plan, ScriptError* error) noexcept
+      : target(target), plan(plan), error(error) {}
+
+  [[nodiscard]] error_code compile(std::string_view source) noexcept {
+    this->plan.target = this->target;
+    this->plan.records.clear();
+    this->plan.duration = 0;
+
+    while (!source.empty()) {
+      usize end = std::min(source.find_first_of(";\n"), source.size());
+      std::string_view statement = source.substr(0U, end);
+
+      usize comment = statement.find('#');
+      if (comment != std::string_view::npos) {
+        statement = statement.substr(0U, comment);
+      }
+      TRY_CODE(this->parse_statement(statement));
+
+      if (end == source.size()) {
+        break;
+      }
+      if (source[end] == '\n') {
+        ++this->line;
+      }
+      source.remove_prefix(end + 1U);
+    }
+
+    this->sync();
+    this->plan.duration = this->time;
+    return error::OK;
+  }
+
+private:
+  static constexpr usize MAX_TOKENS = 3U;
+
+  PlanTarget target;
+  Plan& plan;
+  ScriptError* error;
+  u32 line = 1U;
+  i64 time = 0;
+  // Events were added since the last sync
+  bool pending = false;
+
+  [[nodiscard]] error_code fail(const c8* message) noexcept {
+    if (this->error != nullptr) {
+      this->error->line = this->line;
+      this->error->message = message;
+    }
+    return error::SCRIPT_SYNTAX;
+  }
+
+  void add(u16 type, u16 code, i32 value) noexcept {
+    this->plan.records.push_back(PlanRecord{
+        .time = this->time,
+        .type = type,
+        .code = code,
+        .value = value,
+    });
+    this->pending = type != EV_SYN;
+  }
+
+  void sync() noexcept {
+    if (this->pending) {
+      this->add(EV_SYN, SYN_REPORT, 0);
+    }
+  }
+
+  [[nodiscard]] error_code parse_statement(std::string_view statement
+  ) noexcept {
+    std::array<std::string_view, MAX_TOKENS> tokens{};
+    usize count = 0U;
+    usize i = 0U;
+    while (i < statement.size()) {
+      if (is_space(statement[i])) {
+        ++i;
+        continue;
+      }
+
+      usize start = i;
+      while (i < statement.size() && !is_space(statement[i])) {
+        ++i;
+      }
+      if (count == MAX_TOKENS) {
+        return this->fail("too many arguments");
+      }
+      tokens[count++] = statement.substr(start, i - start);
+    }
+
+    if (count == 0U) {
+      return error::OK;
+    }
+
+    if (equals(tokens[0], "sync")) {
+      if (count != 1U) {
+        return this->fail("sync takes no argument");
+      }
+      this->sync();
+      return error::OK;
+    }
+
+    if (equals(tokens[0], "wait")) {
+      if (count != 2U) {
+        return this->fail("wait needs a duration");
+      }
+      return this->parse_wait(tokens[1]);
+    }
+
+    if (count != 2U) {
+      return this->fail("expected a name and a value");
+    }
+    return this->target == PlanTarget::GAMEPAD
+               ? this->parse_gamepad(tokens[0], tokens[1])
+               : this->parse_keyboard(tokens[0], tokens[1]);
+  }
+
+  [[nodiscard]] error_code parse_wait(std::string_view token) noexcept {
+    f64 value = 0.0;
+    std::string_view unit{};
+    if (!parse_number(token, value, unit) || !std::isfinite(value) ||
+        value < 0.0) {
+      return this->fail("invalid duration");
+    }
+
+    f64 scale = 0.0;
+    if (unit.empty() || equals(unit, "ms")) {
+      scale = timing::NS_PER_MS;
+    } else if (equals(unit, "us")) {
+      scale = timing::NS_PER_US;
+    } else if (equals(unit, "ns")) {
+      scale = 1.0;
+    } else if (equals(unit, "s")) {
+      scale = timing::NS_PER_S;
+    } else {
+      return this->fail("unknown unit, expected ns, us, ms or s");
+    }
+
+    // INT64_MAX rounds up to 2^63 as f64, so >= keeps the cast in range
+    f64 ns = value * scale;
+    if (ns >= static_cast<f64>(INT64_MAX) ||
+        static_cast<i64>(ns) > INT64_MAX - this->time) {
+      return this->fail("duration too long");
+    }
+
+    // The frame before the wait goes out at its own time
+    this->sync();
+    this->time += static_cast<i64>(ns);
+    return error::OK;
+  }
+
+  // Returns -1 if the token is neither down nor up
+  [[nodiscard]] static i32 parse_press(std::string_view token) noexcept {
+    if (equals(token, "down")) {
+      return 1;
+    }
+    if (equals(token, "up")) {
+      return 0;
+    }
+    return -1;
+  }
+
+  [[nodiscard]] error_code
+  parse_gamepad(std::string_view name, std::string_view value) noexcept {
+    if (const auto* stick = find(STICKS, name)) {
+      f64 position = 0.0;
+      std::string_view rest{};
+      if (!parse_number(value, position, rest) || !rest.empty() ||
+          !std::isfinite(position)) {
+        return this->fail("invalid stick position");
+      }
+      // Same conversion as move_stickf, clamped before the cast
+      position = std::clamp(position, 0.0, 1.0);
+      this->add(EV_ABS, stick->code, static_cast<i32>(0xff * position));
+      return error::OK;
+    }
+
+    i32 press = parse_press(value);
+    if (press == -1) {
+      return this->fail("expected down or up");
+    }
+
+    if (const auto* button = find(BUTTONS, name)) {
+      this->add(EV_KEY, button->code, press);
+      return error::OK;
+    }
+
+    if (const auto* direction = find(DIRECTIONS, name)) {
+      this->add(EV_ABS, direction->hat, press ? direction->value : 0);
+      return error::OK;
+    }
+
+    return this->fail("unknown button");
+  }
+
+  [[nodiscard]] error_code
+  parse_keyboard(std::string_view name, std::string_view value) noexcept {
+    i32 press = parse_press(value);
+    if (press == -1) {
+      return this->fail("expected down or up");
+    }
+
+    const auto* key = find(KEYS, name);
+    if (key == nullptr) {
+      return this->fail("unknown key");
+    }
+
+    this->add(EV_KEY, key->code, press);
+    return error::OK;
+  }
+};
+
+} // namespace
+
+error_code compile_script(
+    std::string_view source, PlanTarget target, Plan& plan, ScriptError* error
+) noexcept {
+  return Compiler{target, plan, error}.compile(source);
+}
+
+error_code compile_script_file(
+    const c8* path, PlanTarget target, Plan& plan, ScriptError* error
+) noexcept {
+  i32 fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return error::SCRIPT_OPEN;
+  }
+
+  // Files reporting no size (empty, pipes, /proc) can't be read in one go
+  struct stat info{};
+  if (fstat(fd, &info) == -1 || info.st_size <= 0) {
+    close(fd);
+    return error::SCRIPT_OPEN;
+  }
+
+  std::vector<c8> source(info.st_size);
+  usize size = 0U;
+  while (size < source.size()) {
+    isize bytes = read(fd, source.data() + size, source.size() - size);
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes <= 0) {
+      break;
+    }
+    size += bytes;
+  }
+  close(fd);
+
+  // A short read would compile a truncated script
+  if (size != source.size()) {
+    return error::SCRIPT_OPEN;
+  }
+  return compile_script({source.data(), size}, target, plan, error);
+}
+
+PlanSlot::PlanSlot(PlanTarget target) noexcept : target(target) {}
+
+error_code
+PlanSlot::load(std::string_view source, ScriptError* error) noexcept {
+  Plan plan{};
+  TRY_CODE(compile_script(source, this->target, plan, error));
+  this->publish(std::move(plan));
+  return error::OK;
+}
+
+error_code PlanSlot::load_file(const c8* path, ScriptError* error) noexcept {
+  Plan plan{};
+  TRY_CODE(compile_script_file(path, this->target, plan, error));
+  this->publish(std::move(plan));
+  return error::OK;
+}
+
+std::shared_ptr<const Plan> PlanSlot::get() const noexcept {
+  return std::atomic_load(&this->plan);
+}
+
+PlanTarget PlanSlot::get_target() const noexcept {
+  return this->target;
+}
+
+void PlanSlot::publish(Plan&& plan) noexcept {
+  std::atomic_store(
+      &this->plan, std::shared_ptr<const Plan>{
+                       std::make_shared<Plan>(std::move(plan))
+                   }
+  );
+}
+
+} // namespace vc
@@ -0,0 +1,190 @@
+#include "./executor.hpp"
+#include "../helper.hpp"
+#include "../timing/clock.hpp"
+#include <climits>
+#include <linux/input-event-codes.h>
+
+namespace vc {
+
+namespace {
+
+template <typename Sink>
+constexpr PlanTarget target_of(const BasicPS4Controller<Sink>* /*unused*/
+) noexcept {
+  return PlanTarget::GAMEPAD;
+}
+
+template <typename Sink>
+constexpr PlanTarget target_of(const BasicKeyboard<Sink>* /*unused*/
+) noexcept {
+  return PlanTarget::KEYBOARD;
+}
+
+template <typename Sink>
+void emit(BasicPS4Controller<Sink>& controller, const PlanRecord& record
+) noexcept {
+  switch (record.type) {
+  case EV_KEY:
+    if (record.value) {
+      controller.press_button(static_cast<PS4Button>(record.code));
+    } else {
+      controller.release_button(static_cast<PS4Button>(record.code));
+    }
+    break;
+
+  case EV_ABS:
+    if (record.code == PS4DPad::X || record.code == PS4DPad::Y) {
+      controller.set_dpad(
+          static_cast<PS4DPad>(record.code), static_cast<i8>(record.value)
+      );
+    } else {
+      controller.move_stick(
+          static_cast<PS4Stick>(record.code), static_cast<u8>(record.value)
+      );
+    }
+    break;
+
+  case EV_SYN:
+    controller.sync();
+    break;
+
+  default:
+    break;
+  }
+}
+
+template <typename Sink>
+void emit(BasicKeyboard<Sink>& keyboard, const PlanRecord& record) noexcept {
+  switch (record.type) {
+  case EV_KEY:
+    if (record.value) {
+      keyboard.press_key(record.code);
+    } else {
+      keyboard.release_key(record.code);
+    }
+    break;
+
+  case EV_SYN:
+    keyboard.sync();
+    break;
+
+  default:
+    break;
+  }
+}
+
+} // namespace
+
+template <typename Device>
+error_code PlanExecutor<Device>::start(
+    std::shared_ptr<const Plan> plan, i64 start_ns
+) noexcept {
+  if (plan && plan->target != target_of(static_cast<Device*>(nullptr))) {
+    return error::SCRIPT_TARGET;
+  }
+
+  this->plan = std::move(plan);
+  this->slot = nullptr;
+  this->loop = false;
+  this->start_time = start_ns == 0 ? timing::now_ns() : start_ns;
+  this->cursor = 0U;
+  return error::OK;
+}
+
+template <typename Device>
+error_code PlanExecutor<Device>::start(
+    const PlanSlot& slot, bool loop, i64 start_ns
+) noexcept {
+  TRY_CODE(this->start(slot.get(), start_ns));
+  this->slot = &slot;
+  this->loop = loop;
+  return error::OK;
+}
+
+template <typename Device> void PlanExecutor<Device>::stop() noexcept {
+  this->plan.reset();
+  this->slot = nullptr;
+}
+
+template <typename Device>
+bool PlanExecutor<Device>::update(Device& device, i64 now_ns) noexcept {
+  while (this->plan) {
+    const auto& records = this->plan->records;
+    while (this->cursor < records.size()) {
+      const PlanRecord& record = records[this->cursor];
+      if (this->start_time + record.time > now_ns) {
+        return true;
+      }
+      emit(device, record);
+      ++this->cursor;
+    }
+
+    // Waits after the last record still count before the plan ends
+    i64 end = this->start_time + this->plan->duration;
+    if (end > now_ns) {
+      return true;
+    }
+    if (!this->restart()) {
+      this->plan.reset();
+      return false;
+    }
+    // A stall of more than a loop starts over from now instead of replaying
+    // the missed loops back to back
+    this->start_time = now_ns - end >= this->plan->duration ? now_ns : end;
+  }
+  return false;
+}
+
+template <typename Device>
+void PlanExecutor<Device>::run(
+    Device& device, FrameScheduler& scheduler
+) noexcept {
+  while (this->update(device, timing::now_ns())) {
+    scheduler.wait_until(this->get_next_time());
+  }
+}
+
+template <typename Device>
+bool PlanExecutor<Device>::is_running() const noexcept {
+  return static_cast<bool>(this->plan);
+}
+
+template <typename Device>
+i64 PlanExecutor<Device>::get_next_time() const noexcept {
+  if (!this->plan) {
+    return INT64_MAX;
+  }
+
+  const auto& records = this->plan->records;
+  return this->cursor < records.size()
+             ? this->start_time + records[this->cursor].time
+             : this->start_time + this->plan->duration;
+}
+
+template <typename Device> bool PlanExecutor<Device>::restart() noexcept {
+  if (!this->loop || this->slot == nullptr) {
+    return false;
+  }
+
+  auto next = this->slot->get();
+  // An empty plan would loop forever on the same instant
+  if (!next || next->duration <= 0 ||
+      next->target != target_of(static_cast<Device*>(nullptr))) {
+    return false;
+  }
+
+  this->plan = std::move(next);
+  this->cursor = 0U;
+  return true;
+}
+
+template class PlanExecutor<BasicPS4Controller<uinput::UinputSink>>;
+template class PlanExecutor<BasicPS4Controller<uinput::NullSink>>;
+template class PlanExecutor<BasicPS4Controller<uinput::RingSink>>;
+template class PlanExecutor<BasicPS4Controller<uinput::FileSink>>;
+template class PlanExecutor<BasicKeyboard<uinput::UinputSink>>;
+template class PlanExecutor<BasicKeyboard<uinput::NullSink>>;
+template class PlanExecutor<BasicKeyboard<uinput::RingSink>>;
+template class PlanExecutor<BasicKeyboard<uinput::FileSink>>;
+
+} // namespace vc
@@ -0,0 +1,86 @@
+#ifndef VC_SCRIPT_EXECUTOR_HPP
+#define VC_SCRIPT_EXECUTOR_HPP
+
+#include "../controller/keyboard.hpp"
+#include "../controller/ps4.hpp"
+#include "../timing/scheduler.hpp"
+#include "../types.hpp"
+#include "./plan.hpp"
+#include <memory>
+
+namespace vc {
+
+/**
+ * Emits the records of a plan into a device at their times. Records are
+ * dispatched with a switch on their type into the usual device calls, so
+ * remaps and state tracking still apply and every frame is one write.
+ * Nothing is parsed or allocated while it runs.
+ *
+ * Either call update from a tick loop or run to block until the plan ends.
+ *
+ * PlanSlot slot{PlanTarget::GAMEPAD};
+ * slot.load("CROSS down; wait 16ms; CROSS up; wait 16ms");
+ * PlanExecutor<PS4Controller> executor{};
+ * executor.start(slot, true);
+ * while (executor.update(controller, timing::now_ns())) {
+ *   scheduler.wait();
+ * }
+ *
+ * Instantiated for PS4 controllers and keyboards of all sinks
+ */
+template <typename Device> class PlanExecutor {
+public:
+  /**
+   * Starts the plan from its first record
+   * @param start_ns - CLOCK_MONOTONIC time of the first record, 0 for now
+   */
+  [[nodiscard]] error_code
+  start(std::shared_ptr<const Plan> plan, i64 start_ns = 0) noexcept;
+
+  /**
+   * Starts the current plan of the slot. A looping executor takes the plan
+   * of the slot again every time it restarts, which is how reloads of the
+   * slot reach it
+   * @param loop - restarts the plan once its duration elapsed
+   */
+  [[nodiscard]] error_code
+  start(const PlanSlot& slot, bool loop, i64 start_ns = 0) noexcept;
+
+  void stop() noexcept;
+
+  /**
+   * Emits every record due at now
+   * @return false once the plan ended
+   */
+  bool update(Device& device, i64 now_ns) noexcept;
+
+  // Sleeps to each record and emits it, until the plan ends or stop
+  void run(Device& device, FrameScheduler& scheduler) noexcept;
+
+  [[nodiscard]] bool is_running() const noexcept;
+  // Time of the next record, INT64_MAX if there is none
+  [[nodiscard]] i64 get_next_time() const noexcept;
+
+private:
+  std::shared_ptr<const Plan> plan{};
+  const PlanSlot* slot = nullptr;
+  bool loop = false;
+  i64 start_time = 0;
+  usize cursor = 0U;
+
+  // Takes the plan of the slot again for the next loop
+  [[nodiscard]] bool restart() noexcept;
+};
+
+extern template class PlanExecutor<BasicPS4Controller<uinput::UinputSink>>;
+extern template class PlanExecutor<BasicPS4Controller<uinput::NullSink>>;
+extern template class PlanExecutor<BasicPS4Controller<uinput::RingSink>>;
+extern template class PlanExecutor<BasicPS4Controller<uinput::FileSink>>;
+extern template class PlanExecutor<BasicKeyboard<uinput::UinputSink>>;
+extern template class PlanExecutor<BasicKeyboard<uinput::NullSink>>;
+extern template class PlanExecutor<BasicKeyboard<uinput::RingSink>>;
+extern template class PlanExecutor<BasicKeyboard<uinput::FileSink>>;
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef VC_SCRIPT_PLAN_HPP
+#define VC_SCRIPT_PLAN_HPP
+
+#include "../types.hpp"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * Scripts are a list of statements separated by ';' or new lines, '#'
+ * comments out the rest of a line. Names and keywords ignore case
+ *
+ *   wait 16ms           - ns, us, ms or s, ms without a unit
+ *   sync                - ends the frame, see below
+ *
+ * Gamepad scripts (PS4Controller)
+ *   CROSS down          - any PS4Button name, down or up
+ *   UP down             - d-pad, UP DOWN LEFT RIGHT, down or up
+ *   LX 0.5              - LX LY RX RY, [0.0, 1.0] like move_stickf
+ *
+ * Keyboard scripts
+ *   A down              - letters, digits and the KEY_* names without the
+ *                         prefix (ENTER, LEFTSHIFT, F1...), down or up
+ *
+ * Events between two syncs are written as one frame. A wait or the end of
+ * the script syncs the pending events, so "CROSS down; wait 16ms; CROSS up"
+ * writes two frames 16ms apart
+ *
+ * CROSS down; LX 1.0; sync
+ * wait 100ms
+ * CROSS up; LX 0.5
+ */
+
+namespace vc {
+
+enum class PlanTarget : u8 {
+  GAMEPAD,
+  KEYBOARD,
+};
+
+/**
+ * Gamepads: EV_KEY with the PS4Button as the code so remaps still apply,
+ * EV_ABS with the stick or hat code and its raw value.
+ * Keyboards: EV_KEY with the KEY_* code.
+ * EV_SYN syncs the device
+ */
+struct PlanRecord {
+  // Since the start of the plan in ns
+  i64 time;
+  u16 type;
+  u16 code;
+  i32 value;
+};
+
+struct Plan {
+  PlanTarget target = PlanTarget::GAMEPAD;
+  std::vector<PlanRecord> records{};
+  // Time of the last wait, a looping plan restarts after it
+  i64 duration = 0;
+};
+
+struct ScriptError {
+  u32 line = 0U;
+  const c8* message = "";
+};
+
+/**
+ * Compiles the whole source into the plan, nothing is kept from the source.
+ * @param error - where the first error is described, can be nullptr
+ */
+[[nodiscard]] error_code compile_script(
+    std::string_view source, PlanTarget target, Plan& plan,
+    ScriptError* error = nullptr
+) noexcept;
+
+// SCRIPT_OPEN if the file is empty or can't be read whole
+[[nodiscard]] error_code compile_script_file(
+    const c8* path, PlanTarget target, Plan& plan, ScriptError* error = nullptr
+) noexcept;
+
+/**
+ * Holds the plan of a script so it can be reloaded while executors run it.
+ * Plans are immutable once published, a reload compiles a new one then
+ * swaps the pointer. Executors only pick the new plan when they (re)start
+ * it, so a plan is never switched half way
+ */
+class PlanSlot {
+public:
+  explicit PlanSlot(PlanTarget target) noexcept;
+
+  // Compiles then publishes the plan, the current one is kept on errors
+  [[nodiscard]] error_code
+  load(std::string_view source, ScriptError* error = nullptr) noexcept;
+  [[nodiscard]] error_code
+  load_file(const c8* path, ScriptError* error = nullptr) noexcept;
+
+  // Can be called from any thread, nullptr until a load succeeds
+  [[nodiscard]] std::shared_ptr<const Plan> get() const noexcept;
+  [[nodiscard]] PlanTarget get_target() const noexcept;
+
+private:
+  PlanTarget target;
+  std::shared_ptr<const Plan> plan{};
+
+  void publish(Plan&& plan) noexcept;
+};
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef VC_TIMING_CLOCK_HPP
+#define VC_TIMING_CLOCK_HPP
+
+#include "../types.hpp"
+#include <ctime>
+
+namespace vc::timing {
+
+constexpr i64 NS_PER_US = 1'000;
+constexpr i64 NS_PER_MS = 1'000'000;
+constexpr i64 NS_PER_S = 1'000'000'000;
+
+[[nodiscard]] inline i64 to_ns(const timespec& time) noexcept {
+  return time.tv_sec * NS_PER_S + time.tv_nsec;
+}
+
+[[nodiscard]] inline timespec to_timespec(i64 ns) noexcept {
+  return timespec{
+      .tv_sec = ns / NS_PER_S,
+      .tv_nsec = ns % NS_PER_S,
+  };
+}
+
+// CLOCK_MONOTONIC in nanoseconds
+[[nodiscard]] inline i64 now_ns() noexcept {
+  timespec time{};
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return to_ns(time);
+}
+
+} // namespace vc::timing
+
+#endif
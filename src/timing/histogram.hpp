@@ -0,0 +1,191 @@
+#ifndef VC_TIMING_HISTOGRAM_HPP
+#define VC_TIMING_HISTOGRAM_HPP
+
+#include "../types.hpp"
+#include <array>
+#include <atomic>
+
+namespace vc::timing {
+
+class AtomicHistogram;
+
+/**
+ * Log-linear histogram of durations in ns. Each power of 2 is split into 8
+ * buckets so the percentiles are within ~12% of the real value.
+ * Recording is a couple of bit operations and an increment, no allocation
+ */
+class Histogram {
+public:
+  static constexpr u32 SUB_BITS = 3U;
+  static constexpr u32 SUB_BUCKETS = 1U << SUB_BITS;
+  // Up to 2^40 ns (~18 minutes), larger values go into the last bucket
+  static constexpr u32 MAX_BITS = 40U;
+  static constexpr usize BUCKETS = (MAX_BITS - SUB_BITS + 1U) * SUB_BUCKETS;
+
+  void record(i64 ns) noexcept {
+    u64 value = ns < 0 ? 0U : static_cast<u64>(ns);
+    ++this->buckets[index(value)];
+    ++this->count;
+    this->max = value > this->max ? value : this->max;
+    this->total += value;
+  }
+
+  void reset() noexcept {
+    this->buckets.fill(0U);
+    this->count = 0U;
+    this->max = 0U;
+    this->total = 0U;
+  }
+
+  // Adds the values of the other histogram into this one
+  void merge(const Histogram& other) noexcept {
+    for (usize i = 0U; i < BUCKETS; ++i) {
+      this->buckets[i] += other.buckets[i];
+    }
+    this->count += other.count;
+    this->max = other.max > this->max ? other.max : this->max;
+    this->total += other.total;
+  }
+
+  /**
+   * @param percentile - [0.0, 100.0]
+   * @return upper bound of the bucket the percentile falls in, in ns
+   */
+  [[nodiscard]] u64 percentile(f64 percentile) const noexcept {
+    if (this->count == 0U) {
+      return 0U;
+    }
+
+    auto rank = static_cast<u64>(percentile / 100.0 * this->count);
+    rank = rank == 0U ? 1U : rank;
+    u64 seen = 0U;
+    for (usize i = 0U; i < BUCKETS; ++i) {
+      seen += this->buckets[i];
+      if (seen >= rank) {
+        u64 bound = upper_bound(i);
+        return bound < this->max ? bound : this->max;
+      }
+    }
+    return this->max;
+  }
+
+  [[nodiscard]] u64 get_count() const noexcept {
+    return this->count;
+  }
+
+  [[nodiscard]] u64 get_max() const noexcept {
+    return this->max;
+  }
+
+  [[nodiscard]] f64 get_mean() const noexcept {
+    return this->count == 0U ? 0.0
+                             : static_cast<f64>(this->total) / this->count;
+  }
+
+private:
+  friend class AtomicHistogram;
+
+  std::array<u64, BUCKETS> buckets{};
+  u64 count = 0U;
+  u64 max = 0U;
+  u64 total = 0U;
+
+  // Values below SUB_BUCKETS get their own bucket
+  [[nodiscard]] static usize index(u64 value) noexcept {
+    if (value < SUB_BUCKETS) {
+      return value;
+    }
+
+    u32 bits = 63U - __builtin_clzll(value);
+    if (bits >= MAX_BITS) {
+      return BUCKETS - 1U;
+    }
+    u32 shift = bits - SUB_BITS;
+    return (shift + 1U) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1U));
+  }
+
+  [[nodiscard]] static u64 upper_bound(usize index) noexcept {
+    if (index < SUB_BUCKETS) {
+      return index;
+    }
+
+    u32 shift = index / SUB_BUCKETS - 1U;
+    u64 sub = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1U) << shift) - 1U;
+  }
+};
+
+/**
+ * Same buckets as Histogram, recorded by a single thread while any other
+ * thread can take a snapshot. Only relaxed loads and stores, no locked
+ * instructions, a snapshot may be off by the values being recorded
+ */
+class AtomicHistogram {
+public:
+  AtomicHistogram() noexcept = default;
+  AtomicHistogram(const AtomicHistogram& other) noexcept {
+    *this = other;
+  }
+
+  AtomicHistogram& operator=(const AtomicHistogram& other) noexcept {
+    for (usize i = 0U; i < Histogram::BUCKETS; ++i) {
+      store(this->buckets[i], load(other.buckets[i]));
+    }
+    store(this->count, load(other.count));
+    store(this->max, load(other.max));
+    store(this->total, load(other.total));
+    return *this;
+  }
+
+  ~AtomicHistogram() noexcept = default;
+
+  // Only one thread may record at a time
+  void record(i64 ns) noexcept {
+    u64 value = ns < 0 ? 0U : static_cast<u64>(ns);
+    auto& bucket = this->buckets[Histogram::index(value)];
+    store(bucket, load(bucket) + 1U);
+    store(this->count, load(this->count) + 1U);
+    if (value > load(this->max)) {
+      store(this->max, value);
+    }
+    store(this->total, load(this->total) + value);
+  }
+
+  void reset() noexcept {
+    for (auto& bucket : this->buckets) {
+      store(bucket, 0U);
+    }
+    store(this->count, 0U);
+    store(this->max, 0U);
+    store(this->total, 0U);
+  }
+
+  [[nodiscard]] Histogram snapshot() const noexcept {
+    Histogram histogram{};
+    for (usize i = 0U; i < Histogram::BUCKETS; ++i) {
+      histogram.buckets[i] = load(this->buckets[i]);
+    }
+    histogram.count = load(this->count);
+    histogram.max = load(this->max);
+    histogram.total = load(this->total);
+    return histogram;
+  }
+
+private:
+  std::array<std::atomic<u64>, Histogram::BUCKETS> buckets{};
+  std::atomic<u64> count{0U};
+  std::atomic<u64> max{0U};
+  std::atomic<u64> total{0U};
+
+  [[nodiscard]] static u64 load(const std::atomic<u64>& value) noexcept {
+    return value.load(std::memory_order_relaxed);
+  }
+
+  static void store(std::atomic<u64>& value, u64 next) noexcept {
+    value.store(next, std::memory_order_relaxed);
+  }
+};
+
+} // namespace vc::timing
+
+#endif
@@ -0,0 +1,78 @@
+#include "./scheduler.hpp"
+#include "./clock.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+
+namespace vc {
+
+error_code FrameScheduler::init(u32 hz, u32 spin_ns) noexcept {
+  if (hz == 0U || hz > 1'000U) {
+    return error::SCHEDULER_RATE;
+  }
+
+  this->hz = hz;
+  this->period = timing::NS_PER_S / hz;
+  this->spin = std::min<i64>(spin_ns, this->period);
+  return error::OK;
+}
+
+void FrameScheduler::start() noexcept {
+  this->stats = {};
+  this->deadline = timing::now_ns() + this->period;
+}
+
+void FrameScheduler::set_spin(u32 spin_ns) noexcept {
+  this->spin =
+      this->period == 0 ? spin_ns : std::min<i64>(spin_ns, this->period);
+}
+
+i64 FrameScheduler::wait() noexcept {
+  i64 lateness = this->wait_until(this->deadline);
+
+  // Keep the deadlines aligned to the start, skipping the missed ones
+  i64 missed = lateness / this->period;
+  this->stats.overruns += missed;
+  this->deadline += (missed + 1) * this->period;
+
+  return lateness;
+}
+
+i64 FrameScheduler::wait_until(i64 deadline) noexcept {
+  timespec sleep_until = timing::to_timespec(deadline - this->spin);
+  while (clock_nanosleep(
+             CLOCK_MONOTONIC, TIMER_ABSTIME, &sleep_until, nullptr
+         ) == EINTR) {
+  }
+
+  i64 now = timing::now_ns();
+  while (now < deadline) {
+    now = timing::now_ns();
+  }
+
+  i64 lateness = now - deadline;
+  ++this->stats.frames;
+  this->stats.last_lateness = lateness;
+  this->stats.max_lateness = std::max(this->stats.max_lateness, lateness);
+  this->stats.total_lateness += lateness;
+
+  return lateness;
+}
+
+u32 FrameScheduler::get_hz() const noexcept {
+  return this->hz;
+}
+
+i64 FrameScheduler::get_period() const noexcept {
+  return this->period;
+}
+
+i64 FrameScheduler::get_deadline() const noexcept {
+  return this->deadline;
+}
+
+const FrameStats& FrameScheduler::get_stats() const noexcept {
+  return this->stats;
+}
+
+} // namespace vc
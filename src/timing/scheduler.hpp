@@ -0,0 +1,75 @@
+#ifndef VC_TIMING_SCHEDULER_HPP
+#define VC_TIMING_SCHEDULER_HPP
+
+#include "../types.hpp"
+
+namespace vc {
+
+struct FrameStats {
+  u64 frames = 0U;
+  // Number of deadlines that were missed entirely and skipped
+  u64 overruns = 0U;
+  // How late the wake up was compared to the deadline, in ns
+  i64 last_lateness = 0;
+  i64 max_lateness = 0;
+  i64 total_lateness = 0;
+};
+
+/**
+ * Paces a loop at a fixed rate using absolute deadlines, so wake up latency
+ * of one frame does not push back the next ones.
+ *
+ * scheduler.start();
+ * while (running) {
+ *   controller.press_button(...);
+ *   controller.sync();
+ *   scheduler.wait();
+ * }
+ */
+class FrameScheduler {
+public:
+  /**
+   * @param hz - frames per second, [1, 1000]
+   * @param spin_ns - sleep until this many ns before the deadline then
+   *   busy-wait the rest, trades cpu time for less jitter. 0 to disable
+   */
+  [[nodiscard]] error_code init(u32 hz, u32 spin_ns = 0U) noexcept;
+
+  // Sets the first deadline one period from now and resets the stats
+  void start() noexcept;
+
+  // Same as the spin_ns of init, can be used without init for wait_until
+  void set_spin(u32 spin_ns) noexcept;
+
+  /**
+   * Blocks until the next deadline.
+   * If whole periods were missed, their deadlines are skipped and counted as
+   * overruns instead of firing back to back.
+   * @return lateness of the wake up in ns
+   */
+  i64 wait() noexcept;
+
+  /**
+   * Blocks until an arbitrary absolute CLOCK_MONOTONIC deadline in ns, for
+   * callers with irregular timings like replays. Does not need init
+   * @return lateness of the wake up in ns
+   */
+  i64 wait_until(i64 deadline) noexcept;
+
+  [[nodiscard]] u32 get_hz() const noexcept;
+  [[nodiscard]] i64 get_period() const noexcept;
+  // Absolute CLOCK_MONOTONIC time of the next deadline in ns
+  [[nodiscard]] i64 get_deadline() const noexcept;
+  [[nodiscard]] const FrameStats& get_stats() const noexcept;
+
+private:
+  i64 period = 0;
+  i64 deadline = 0;
+  i64 spin = 0;
+  u32 hz = 0U;
+  FrameStats stats{};
+};
+
+} // namespace vc
+
+#endif
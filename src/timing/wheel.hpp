@@ -0,0 +1,182 @@
+#ifndef VC_TIMING_WHEEL_HPP
+#define VC_TIMING_WHEEL_HPP
+
+#include "../types.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vc::timing {
+
+/**
+ * Hierarchical timer wheel, LEVELS wheels of SLOTS lists each. A timer
+ * goes into the lowest level its deadline fits in and moves down a level
+ * when the wheel above turns, so scheduling, cancelling and advancing by a
+ * tick are O(1) no matter how many timers there are, plus the timers that
+ * expire.
+ *
+ * Time is counted in ticks of whatever length the caller picks. Timers are
+ * the indexes [0, size), their lists are linked through them so nothing is
+ * allocated past resize. Deadlines further than RANGE ticks are clamped.
+ *
+ * wheel.resize(2U);
+ * wheel.schedule(0U, 10U);
+ * wheel.advance(tick, [&](u32 timer) { wheel.schedule(timer, tick + 10U); });
+ */
+class TimerWheel {
+public:
+  static constexpr u32 SLOT_BITS = 6U;
+  static constexpr u32 SLOTS = 1U << SLOT_BITS;
+  static constexpr u32 LEVELS = 4U;
+  static constexpr u64 RANGE = 1ULL << (SLOT_BITS * LEVELS);
+
+  TimerWheel() noexcept {
+    this->heads.fill(NONE);
+  }
+
+  // New timers are not scheduled, shrinking cancels the ones dropped
+  void resize(usize timers) noexcept {
+    for (usize timer = timers; timer < this->nodes.size(); ++timer) {
+      this->cancel(static_cast<u32>(timer));
+    }
+    this->nodes.resize(timers);
+  }
+
+  [[nodiscard]] usize size() const noexcept {
+    return this->nodes.size();
+  }
+
+  /**
+   * Replaces the deadline of the timer, a tick already advanced past
+   * expires on the next one
+   */
+  void schedule(u32 timer, u64 tick) noexcept {
+    this->cancel(timer);
+    this->link(timer, tick);
+  }
+
+  void cancel(u32 timer) noexcept {
+    if (this->nodes[timer].slot != NONE) {
+      this->unlink(timer);
+    }
+  }
+
+  [[nodiscard]] bool is_scheduled(u32 timer) const noexcept {
+    return this->nodes[timer].slot != NONE;
+  }
+
+  // First tick the next advance expires, the callbacks of advance run at
+  // get_next() - 1
+  [[nodiscard]] u64 get_next() const noexcept {
+    return this->next;
+  }
+
+  /**
+   * Expires every tick up to and including tick, oldest first.
+   * fn(u32 timer) may schedule or cancel any timer
+   * @return number of timers expired
+   */
+  template <typename Fn> usize advance(u64 tick, Fn&& fn) noexcept {
+    usize expired = 0U;
+    while (this->next <= tick) {
+      u32 index = this->next & (SLOTS - 1U);
+      // The upper wheels turn once every lower one wrapped around
+      for (u32 level = 1U; index == 0U && level < LEVELS; ++level) {
+        u32 upper = (this->next >> (SLOT_BITS * level)) & (SLOTS - 1U);
+        this->cascade(level * SLOTS + upper);
+        if (upper != 0U) {
+          break;
+        }
+      }
+
+      // Fired from their own list, callbacks can unlink any of them
+      u32 timer = this->heads[index];
+      this->heads[index] = NONE;
+      this->heads[EXPIRED] = timer;
+      for (; timer != NONE; timer = this->nodes[timer].next) {
+        this->nodes[timer].slot = EXPIRED;
+      }
+      ++this->next;
+
+      while (this->heads[EXPIRED] != NONE) {
+        timer = this->heads[EXPIRED];
+        this->unlink(timer);
+        fn(timer);
+        ++expired;
+      }
+    }
+    return expired;
+  }
+
+private:
+  static constexpr u32 NONE = UINT32_MAX;
+  // List of the tick being expired
+  static constexpr u32 EXPIRED = LEVELS * SLOTS;
+
+  struct Node {
+    u32 prev = NONE;
+    u32 next = NONE;
+    u32 slot = NONE;
+    u64 expires = 0U;
+  };
+
+  std::vector<Node> nodes{};
+  std::array<u32, LEVELS * SLOTS + 1U> heads{};
+  u64 next = 0U;
+
+  void link(u32 timer, u64 tick) noexcept {
+    tick = tick < this->next ? this->next : tick;
+    u64 delta = tick - this->next;
+    if (delta >= RANGE) {
+      delta = RANGE - 1U;
+      tick = this->next + delta;
+    }
+
+    u32 level = 0U;
+    while (delta >= (1ULL << (SLOT_BITS * (level + 1U)))) {
+      ++level;
+    }
+    u32 slot = level * SLOTS +
+               static_cast<u32>((tick >> (SLOT_BITS * level)) & (SLOTS - 1U));
+
+    auto& node = this->nodes[timer];
+    node.expires = tick;
+    node.slot = slot;
+    node.prev = NONE;
+    node.next = this->heads[slot];
+    if (node.next != NONE) {
+      this->nodes[node.next].prev = timer;
+    }
+    this->heads[slot] = timer;
+  }
+
+  void unlink(u32 timer) noexcept {
+    auto& node = this->nodes[timer];
+    if (node.prev == NONE) {
+      this->heads[node.slot] = node.next;
+    } else {
+      this->nodes[node.prev].next = node.next;
+    }
+    if (node.next != NONE) {
+      this->nodes[node.next].prev = node.prev;
+    }
+    node.prev = NONE;
+    node.next = NONE;
+    node.slot = NONE;
+  }
+
+  // Moves the timers of an upper slot to the levels below
+  void cascade(u32 slot) noexcept {
+    u32 timer = this->heads[slot];
+    this->heads[slot] = NONE;
+    while (timer != NONE) {
+      u32 following = this->nodes[timer].next;
+      this->link(timer, this->nodes[timer].expires);
+      timer = following;
+    }
+  }
+};
+
+} // namespace vc::timing
+
+#endif
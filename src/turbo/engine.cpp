@@ -0,0 +1,238 @@
+#include "./engine.hpp"
+#include "../controller/pool.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace vc {
+
+namespace {
+
+constexpr f32 MAX_RATE = 500.0F;
+// Lowest rate kept within the range of the wheel
+constexpr f32 MIN_RATE = 0.001F;
+
+} // namespace
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::set(
+    u32 device, PS4Button button, const TurboPattern& pattern, i64 start_ns
+) noexcept {
+  if (button >= BUTTONS) {
+    return;
+  }
+
+  this->add(
+      this->button_slots, device * BUTTONS + button,
+      Pattern{.device = device, .code = button, .is_key = false}, pattern,
+      start_ns
+  );
+}
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::set_key(
+    u32 device, u16 code, const TurboPattern& pattern, i64 start_ns
+) noexcept {
+  if (code >= KEYS) {
+    return;
+  }
+
+  this->add(
+      this->key_slots, device * KEYS + code,
+      Pattern{.device = device, .code = code, .is_key = true}, pattern,
+      start_ns
+  );
+}
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::cancel(u32 device, PS4Button button) noexcept {
+  this->stop(this->button_slots, device * BUTTONS + button);
+}
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::cancel_key(u32 device, u16 code) noexcept {
+  this->stop(this->key_slots, device * KEYS + code);
+}
+
+template <typename Sink> void BasicTurboEngine<Sink>::clear() noexcept {
+  for (u32 key = 0U; key < this->button_slots.size(); ++key) {
+    this->stop(this->button_slots, key);
+  }
+  for (u32 key = 0U; key < this->key_slots.size(); ++key) {
+    this->stop(this->key_slots, key);
+  }
+}
+
+template <typename Sink>
+bool BasicTurboEngine<Sink>::is_set(u32 device, PS4Button button)
+    const noexcept {
+  u32 key = device * BUTTONS + button;
+  return key < this->button_slots.size() &&
+         this->button_slots[key] != NO_SLOT &&
+         !this->patterns[this->button_slots[key]].stopping;
+}
+
+template <typename Sink>
+bool BasicTurboEngine<Sink>::is_key_set(u32 device, u16 code) const noexcept {
+  u32 key = device * KEYS + code;
+  return key < this->key_slots.size() && this->key_slots[key] != NO_SLOT &&
+         !this->patterns[this->key_slots[key]].stopping;
+}
+
+template <typename Sink>
+usize BasicTurboEngine<Sink>::update(
+    i64 now_ns, BasicPS4Controller<Sink>* controllers, usize count,
+    BasicKeyboard<Sink>* keyboards, usize keyboard_count
+) noexcept {
+  usize toggles = 0U;
+  (void)this->wheel.advance(this->to_tick(now_ns), [&](u32 index) {
+    Pattern& pattern = this->patterns[index];
+    if (pattern.device >= (pattern.is_key ? keyboard_count : count)) {
+      this->remove(index);
+      return;
+    }
+    if (pattern.stopping && !pattern.pressed) {
+      this->remove(index);
+      return;
+    }
+
+    pattern.pressed = !pattern.pressed;
+    ++toggles;
+    if (pattern.is_key) {
+      auto& keyboard = keyboards[pattern.device];
+      if (pattern.pressed) {
+        keyboard.press_key(pattern.code);
+      } else {
+        keyboard.release_key(pattern.code);
+      }
+    } else {
+      auto& controller = controllers[pattern.device];
+      auto button = static_cast<PS4Button>(pattern.code);
+      if (pattern.pressed) {
+        controller.press_button(button);
+      } else {
+        controller.release_button(button);
+      }
+    }
+
+    if (pattern.stopping) {
+      this->remove(index);
+      return;
+    }
+    // Callbacks run at the tick expiring
+    u64 tick = this->wheel.get_next() - 1U;
+    this->wheel.schedule(
+        index, tick + (pattern.pressed ? pattern.down_ticks : pattern.up_ticks)
+    );
+  });
+  return toggles;
+}
+
+template <typename Sink>
+usize BasicTurboEngine<Sink>::update(
+    i64 now_ns, BasicControllerPool<Sink>& pool
+) noexcept {
+  usize count = pool.get_controller_count();
+  usize keyboard_count = pool.get_keyboard_count();
+  return this->update(
+      now_ns, count == 0U ? nullptr : &pool.get_controller(0U), count,
+      keyboard_count == 0U ? nullptr : &pool.get_keyboard(0U), keyboard_count
+  );
+}
+
+template <typename Sink> usize BasicTurboEngine<Sink>::size() const noexcept {
+  return this->running;
+}
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::add(
+    std::vector<u32>& slots, u32 key, Pattern pattern,
+    const TurboPattern& timing, i64 start_ns
+) noexcept {
+  f32 rate = std::clamp(timing.rate, MIN_RATE, MAX_RATE);
+  auto period = std::max<long>(
+      std::lround(static_cast<f32>(timing::NS_PER_S / TICK_NS) / rate), 2
+  );
+  auto down = std::clamp<long>(
+      std::lround(static_cast<f32>(period) * timing.duty), 1, period - 1
+  );
+  pattern.down_ticks = static_cast<u32>(down);
+  pattern.up_ticks = static_cast<u32>(period - down);
+
+  if (key >= slots.size()) {
+    slots.resize(key + 1U, NO_SLOT);
+  }
+
+  if (u32 index = slots[key]; index != NO_SLOT) {
+    // Keeps its phase, the new timings apply from its next toggle
+    auto& current = this->patterns[index];
+    current.down_ticks = pattern.down_ticks;
+    current.up_ticks = pattern.up_ticks;
+    current.stopping = false;
+    return;
+  }
+
+  u32 index = 0U;
+  if (this->free.empty()) {
+    index = static_cast<u32>(this->patterns.size());
+    this->patterns.push_back(pattern);
+    this->wheel.resize(this->patterns.size());
+  } else {
+    index = this->free.back();
+    this->free.pop_back();
+    this->patterns[index] = pattern;
+  }
+
+  slots[key] = index;
+  ++this->running;
+  this->wheel.schedule(
+      index, this->to_tick(start_ns == 0 ? timing::now_ns() : start_ns)
+  );
+}
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::stop(std::vector<u32>& slots, u32 key) noexcept {
+  if (key >= slots.size() || slots[key] == NO_SLOT) {
+    return;
+  }
+
+  u32 index = slots[key];
+  if (!this->patterns[index].pressed) {
+    this->remove(index);
+    return;
+  }
+
+  // The release goes through the next update, within the frame it flushes
+  this->patterns[index].stopping = true;
+  this->wheel.schedule(index, this->wheel.get_next());
+}
+
+template <typename Sink>
+void BasicTurboEngine<Sink>::remove(u32 index) noexcept {
+  const Pattern& pattern = this->patterns[index];
+  if (pattern.is_key) {
+    this->key_slots[pattern.device * KEYS + pattern.code] = NO_SLOT;
+  } else {
+    this->button_slots[pattern.device * BUTTONS + pattern.code] = NO_SLOT;
+  }
+
+  this->wheel.cancel(index);
+  this->free.push_back(index);
+  --this->running;
+}
+
+template <typename Sink>
+u64 BasicTurboEngine<Sink>::to_tick(i64 time_ns) noexcept {
+  if (this->epoch == -1) {
+    this->epoch = time_ns;
+  }
+  return time_ns <= this->epoch
+             ? 0U
+             : static_cast<u64>(time_ns - this->epoch) / TICK_NS;
+}
+
+template class BasicTurboEngine<uinput::UinputSink>;
+template class BasicTurboEngine<uinput::NullSink>;
+template class BasicTurboEngine<uinput::RingSink>;
+template class BasicTurboEngine<uinput::FileSink>;
+
+} // namespace vc
@@ -0,0 +1,135 @@
+#ifndef VC_TURBO_ENGINE_HPP
+#define VC_TURBO_ENGINE_HPP
+
+#include "../controller/keyboard.hpp"
+#include "../controller/ps4.hpp"
+#include "../timing/clock.hpp"
+#include "../timing/wheel.hpp"
+#include "../types.hpp"
+#include <vector>
+
+namespace vc {
+
+template <typename Sink> class BasicControllerPool;
+
+struct TurboPattern {
+  // Presses per second, (0, 500]
+  f32 rate = 10.0F;
+  // Part of each period the button is held down, (0, 1)
+  f32 duty = 0.5F;
+};
+
+/**
+ * Autofire, presses and releases buttons and keys in a loop at their own
+ * rate and duty cycle. Every pattern is a timer on a timing::TimerWheel
+ * ticking each ms, an update only touches the patterns toggling and the
+ * devices only emit the changes, so it can run before the sync of the tick
+ * and its toggles are written in the same frames as the rest of the input.
+ *
+ * A toggle needs a frame of its own, rates above half the flush rate merge
+ * presses with their releases. Only the thread calling update may call the
+ * other functions.
+ *
+ * turbo.set(0U, PS4Button::CROSS, TurboPattern{.rate = 15.0F});
+ * while (running) {
+ *   turbo.update(timing::now_ns(), pool);
+ *   pool.flush();
+ *   pool.wait();
+ * }
+ *
+ * Instantiated for all sinks in uinput/sink.hpp
+ */
+template <typename Sink> class BasicTurboEngine {
+public:
+  // Length of a tick of the wheel, rates are rounded to whole ticks
+  static constexpr i64 TICK_NS = timing::NS_PER_MS;
+
+  /**
+   * Starts pressing the button of the controller, replaces the pattern it
+   * already had without restarting it
+   * @param device - index of the controller passed to update
+   * @param start_ns - CLOCK_MONOTONIC time of the first press, 0 for now
+   */
+  void set(
+      u32 device, PS4Button button, const TurboPattern& pattern,
+      i64 start_ns = 0
+  ) noexcept;
+  // Same as set for the keyboards passed to update, code is a KEY_* code
+  void set_key(
+      u32 device, u16 code, const TurboPattern& pattern, i64 start_ns = 0
+  ) noexcept;
+
+  // Stops the pattern, a button left pressed is released by the next update
+  void cancel(u32 device, PS4Button button) noexcept;
+  void cancel_key(u32 device, u16 code) noexcept;
+  void clear() noexcept;
+
+  [[nodiscard]] bool is_set(u32 device, PS4Button button) const noexcept;
+  [[nodiscard]] bool is_key_set(u32 device, u16 code) const noexcept;
+
+  /**
+   * Toggles the buttons and keys due up to now, without syncing
+   * @param controllers - contiguous devices, indexed by the device of the
+   *   patterns. Patterns of devices past count are dropped, same for the
+   *   keyboards
+   * @return number of toggles
+   */
+  usize update(
+      i64 now_ns, BasicPS4Controller<Sink>* controllers, usize count,
+      BasicKeyboard<Sink>* keyboards = nullptr, usize keyboard_count = 0U
+  ) noexcept;
+  usize update(i64 now_ns, BasicControllerPool<Sink>& pool) noexcept;
+
+  // Number of patterns running
+  [[nodiscard]] usize size() const noexcept;
+
+private:
+  static constexpr u32 NO_SLOT = UINT32_MAX;
+  // Codes a keyboard can press, KEY_MAX included
+  static constexpr u32 KEYS = 0x300U;
+  static constexpr u32 BUTTONS = PS4Button::R3 + 1U;
+
+  struct Pattern {
+    u32 device = 0U;
+    u16 code = 0U;
+    bool is_key = false;
+    bool pressed = false;
+    // Released by the next update then removed
+    bool stopping = false;
+    u32 down_ticks = 0U;
+    u32 up_ticks = 0U;
+  };
+
+  // Indexed by the timers of the wheel
+  std::vector<Pattern> patterns{};
+  std::vector<u32> free{};
+  timing::TimerWheel wheel{};
+  usize running = 0U;
+
+  // Time of tick 0 of the wheel, set by the first set or update
+  i64 epoch = -1;
+
+  // Key (device * BUTTONS + button) to the pattern, NO_SLOT if none
+  std::vector<u32> button_slots{};
+  // Key (device * KEYS + code) to the pattern, NO_SLOT if none
+  std::vector<u32> key_slots{};
+
+  void add(
+      std::vector<u32>& slots, u32 key, Pattern pattern,
+      const TurboPattern& timing, i64 start_ns
+  ) noexcept;
+  void stop(std::vector<u32>& slots, u32 key) noexcept;
+  void remove(u32 index) noexcept;
+  [[nodiscard]] u64 to_tick(i64 time_ns) noexcept;
+};
+
+using TurboEngine = BasicTurboEngine<uinput::UinputSink>;
+
+extern template class BasicTurboEngine<uinput::UinputSink>;
+extern template class BasicTurboEngine<uinput::NullSink>;
+extern template class BasicTurboEngine<uinput::RingSink>;
+extern template class BasicTurboEngine<uinput::FileSink>;
+
+} // namespace vc
+
+#endif
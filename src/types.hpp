@@ -30,6 +30,31 @@ enum error : u32 {
 
   CONTROLLER_OPEN,
   CONTROLLER_CREATE,
+  CONTROLLER_TIMEOUT,
+
+  SCHEDULER_RATE,
+  WORKER_CREATE,
+
+  RECORD_OPEN,
+  RECORD_WRITE,
+  RECORD_FORMAT,
+
+  PASSTHROUGH_OPEN,
+
+  SCRIPT_OPEN,
+  SCRIPT_SYNTAX,
+  SCRIPT_TARGET,
+
+  CALIBRATION_OPEN,
+  CALIBRATION_FAILED,
+  PROFILE_OPEN,
+  PROFILE_FORMAT,
+
+  SHARED_OPEN,
+  SHARED_FORMAT,
+
+  DAEMON_OPEN,
+  DAEMON_SEND,
 
   UNKNOWN = UINT32_MAX,
 };
@@ -0,0 +1,52 @@
+#ifndef VC_UINPUT_BACKPRESSURE_HPP
+#define VC_UINPUT_BACKPRESSURE_HPP
+
+#include "../types.hpp"
+
+namespace vc::uinput {
+
+/**
+ * What a frame flush does when the sink doesn't take the whole frame before
+ * the deadline of the policy. The events of a frame only become visible to
+ * readers at its SYN_REPORT, so a frame is either dropped before any of it
+ * reached the sink or it is completed, never left half written
+ */
+enum class Backpressure : u8 {
+  /**
+   * Discards the whole frame. Once part of a frame was written the rest is
+   * coalesced instead, the kernel already holds that part.
+   * Gamepads roll their state back to the last written frame
+   */
+  DROP,
+  /**
+   * Keeps the unwritten events (without their SYN_REPORT) in the frame, the
+   * next events of the same code replace their value and everything is
+   * written with the next frame. Only the latest value of a code survives,
+   * so a press and release of the same key in between can be lost
+   */
+  COALESCE,
+  // Waits until the sink took the whole frame, past the deadline if needed
+  BLOCK,
+};
+
+struct BackpressurePolicy {
+  Backpressure mode = Backpressure::COALESCE;
+  // How long a flush polls the fd for space before applying the mode
+  i32 timeout_ms = 2;
+};
+
+[[nodiscard]] inline const c8* to_string(Backpressure mode) noexcept {
+  switch (mode) {
+  case Backpressure::DROP:
+    return "drop";
+  case Backpressure::COALESCE:
+    return "coalesce";
+  case Backpressure::BLOCK:
+    return "block";
+  }
+  return "unknown";
+}
+
+} // namespace vc::uinput
+
+#endif
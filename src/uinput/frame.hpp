@@ -0,0 +1,258 @@
+#ifndef VC_UINPUT_FRAME_HPP
+#define VC_UINPUT_FRAME_HPP
+
+#include "../timing/clock.hpp"
+#include "../types.hpp"
+#include "./backpressure.hpp"
+#include "./stats.hpp"
+#include <array>
+#include <cerrno>
+#include <linux/input.h>
+#include <poll.h>
+
+namespace vc::uinput {
+
+// Enough for every code of a full PS4 frame plus the SYN_REPORT
+constexpr usize FRAME_CAPACITY = 64;
+
+enum class FlushResult : u8 {
+  // Every event reached the sink, also returned for empty frames
+  WRITTEN,
+  // Some events are kept in the frame for the next flush, see COALESCE
+  CARRIED,
+  // The frame was discarded, none of it reached the sink
+  DROPPED,
+};
+
+/**
+ * Fixed-size buffer of events that gets written with a single write() call.
+ * Events are only visible to evdev readers after the SYN_REPORT, so the whole
+ * frame can be handed to the kernel at once.
+ */
+template <usize N = FRAME_CAPACITY> class Frame {
+public:
+  /**
+   * Returns false if the frame is full, flush it first before retrying.
+   * Events carried from a failed flush take the value of a new event of the
+   * same code instead of growing the frame
+   */
+  [[nodiscard]] bool push(u16 type, u16 code, i32 value) noexcept {
+    for (usize i = 0U; i < this->carry; ++i) {
+      auto& event = this->events[i];
+      if (event.type == type && event.code == code) {
+        event.value = value;
+        return true;
+      }
+    }
+
+    if (this->count == N) {
+      return false;
+    }
+
+    auto& event = this->events[this->count++];
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return true;
+  }
+
+  // Writes all buffered events in one call to the sink and clears the frame
+  template <typename Sink> isize flush(Sink& sink) noexcept {
+    if (this->count == 0) {
+      return 0;
+    }
+
+    isize written = sink.write(this->events.data(), this->count);
+    this->count = 0;
+    return written;
+  }
+
+  /**
+   * Same as flush but short writes and EAGAIN are retried, polling the fd of
+   * the sink until the deadline of the policy, then its mode is applied.
+   * Every write is recorded into the stats
+   */
+  template <typename Sink>
+  FlushResult flush(
+      Sink& sink, DeviceStats& stats, const BackpressurePolicy& policy
+  ) noexcept {
+    if (this->count == 0) {
+      this->last_written = 0U;
+      return FlushResult::WRITTEN;
+    }
+
+    const auto& last = this->events[this->count - 1U];
+    bool ends_frame = last.type == EV_SYN && last.code == SYN_REPORT;
+
+    // An earlier part of the frame was dropped, so is the rest of it
+    if (this->dropping) {
+      this->dropping = !ends_frame;
+      this->last_written = 0U;
+      this->clear();
+      return FlushResult::DROPPED;
+    }
+
+    bool broken = false;
+    usize written = this->write(sink, stats, policy, broken);
+    this->last_written = written;
+    if (written == this->count) {
+      this->started = !ends_frame;
+      this->clear();
+      return FlushResult::WRITTEN;
+    }
+
+    bool untouched = written == 0U && !this->started;
+    if (broken || (policy.mode == Backpressure::DROP && untouched)) {
+      stats.record_drop();
+      this->dropping = !ends_frame;
+      this->started = false;
+      this->clear();
+      return FlushResult::DROPPED;
+    }
+
+    // The kernel holds the written part, the rest waits for the next frame
+    stats.record_coalesce();
+    this->started = this->started || written != 0U;
+    usize kept = 0U;
+    for (usize i = written; i < this->count; ++i) {
+      const auto& event = this->events[i];
+      if (event.type != EV_SYN || event.code != SYN_REPORT) {
+        this->events[kept++] = event;
+      }
+    }
+    this->count = kept;
+    this->carry = kept;
+    return FlushResult::CARRIED;
+  }
+
+  // Empties the frame, a frame flush left half written is still tracked
+  void clear() noexcept {
+    this->count = 0;
+    this->carry = 0;
+  }
+
+  /**
+   * Empties the frame and forgets what the earlier flushes left, for callers
+   * discarding a carried frame to send a whole new one instead
+   */
+  void reset() noexcept {
+    this->clear();
+    this->started = false;
+    this->dropping = false;
+  }
+
+  [[nodiscard]] const input_event* data() const noexcept {
+    return this->events.data();
+  }
+
+  [[nodiscard]] usize size() const noexcept {
+    return this->count;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return this->count == 0;
+  }
+
+  [[nodiscard]] static constexpr usize capacity() noexcept {
+    return N;
+  }
+
+  // Events the last flush with stats handed to the sink, from the front
+  [[nodiscard]] usize get_written() const noexcept {
+    return this->last_written;
+  }
+
+private:
+  std::array<input_event, N> events{};
+  usize count = 0;
+  // Events at the front kept from a flush that didn't finish
+  usize carry = 0;
+  usize last_written = 0;
+  // Part of the current frame already reached the sink
+  bool started = false;
+  // Part of the current frame was dropped, drop until its SYN_REPORT
+  bool dropping = false;
+
+  /**
+   * Returns the number of events the sink took. Stops at the deadline unless
+   * the policy blocks, broken is set if the sink can't take the rest at all
+   */
+  template <typename Sink>
+  usize write(
+      Sink& sink, DeviceStats& stats, const BackpressurePolicy& policy,
+      bool& broken
+  ) noexcept {
+    usize done = 0U;
+    i64 deadline = 0;
+    bool stalled = false;
+
+    while (true) {
+      isize written = write_events(
+          sink, this->events.data() + done, this->count - done, stats
+      );
+      if (written > 0) {
+        // The rest of a torn event can't be written again
+        if (written % sizeof(input_event) != 0) {
+          broken = true;
+          return done;
+        }
+
+        done += written / sizeof(input_event);
+        if (done == this->count) {
+          return done;
+        }
+        // Short write, retry right away and only wait on EAGAIN
+        continue;
+      }
+
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written < 0 && errno != EAGAIN) {
+        broken = true;
+        return done;
+      }
+
+      i32 fd = sink.get_fd();
+      if (fd == -1) {
+        // Nothing to wait on
+        return done;
+      }
+
+      i64 now = timing::now_ns();
+      if (deadline == 0) {
+        deadline = now + policy.timeout_ms * timing::NS_PER_MS;
+      }
+
+      i32 timeout_ms = -1;
+      if (now < deadline) {
+        timeout_ms = static_cast<i32>(
+            (deadline - now + timing::NS_PER_MS - 1) / timing::NS_PER_MS
+        );
+      } else {
+        if (!stalled) {
+          stats.record_stall();
+          stalled = true;
+        }
+        if (policy.mode != Backpressure::BLOCK) {
+          return done;
+        }
+      }
+
+      stats.record_poll();
+      pollfd target{.fd = fd, .events = POLLOUT, .revents = 0};
+      if (poll(&target, 1, timeout_ms) == -1 && errno != EINTR) {
+        broken = true;
+        return done;
+      }
+      if (target.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        broken = true;
+        return done;
+      }
+    }
+  }
+};
+
+} // namespace vc::uinput
+
+#endif
@@ -0,0 +1,311 @@
+#include "./sink.hpp"
+#include "../helper.hpp"
+#include "../timing/clock.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace vc::uinput {
+
+// === UinputSink === //
+
+UinputSink::UinputSink(UinputSink&& other) noexcept
+    : fd(other.fd), writes(other.writes), node(other.node) {
+  other.fd = -1;
+}
+
+UinputSink& UinputSink::operator=(UinputSink&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  // The device being replaced would be left behind
+  this->close();
+
+  this->fd = rhs.fd;
+  this->writes = rhs.writes;
+  this->node = rhs.node;
+  rhs.fd = -1;
+
+  return *this;
+}
+
+UinputSink::~UinputSink() noexcept {
+  this->close();
+}
+
+error_code UinputSink::open() noexcept {
+  // Read/write so force feedback requests can be answered
+  this->fd = ::open("/dev/uinput", O_RDWR | O_NONBLOCK);
+  if (this->fd == -1) {
+    return error::CONTROLLER_OPEN;
+  }
+  return error::OK;
+}
+
+error_code UinputSink::enable(u32 request, i32 bit) noexcept {
+  TRY_IOCTL(this->fd, request, bit);
+  return error::OK;
+}
+
+error_code UinputSink::setup_abs(const uinput_abs_setup& setup) noexcept {
+  TRY_IOCTL(this->fd, UI_ABS_SETUP, &setup);
+  return error::OK;
+}
+
+error_code UinputSink::create(const uinput_setup& setup) noexcept {
+  TRY_IOCTL(this->fd, UI_DEV_SETUP, &setup);
+  TRY_IOCTL(this->fd, UI_DEV_CREATE, nullptr);
+  return error::OK;
+}
+
+error_code UinputSink::wait_ready(i32 timeout_ms) noexcept {
+  // Watch before the first check so a node created in between is not missed
+  i32 watcher = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (watcher != -1) {
+    // Fails if there was no input device yet, the node is polled instead
+    (void)inotify_add_watch(watcher, "/dev/input", IN_CREATE | IN_ATTRIB);
+  }
+
+  i64 deadline = timing::now_ns() + timeout_ms * timing::NS_PER_MS;
+  error_code code = error::CONTROLLER_TIMEOUT;
+  std::array<c8, 4096> buffer{};
+  while (true) {
+    if (this->node[0] != '\0' || this->find_node()) {
+      i32 reader = ::open(this->node.data(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+      if (reader != -1) {
+        ::close(reader);
+        code = error::OK;
+        break;
+      }
+    }
+
+    i64 remaining = deadline - timing::now_ns();
+    if (remaining <= 0) {
+      break;
+    }
+
+    // Capped so missed events (ie. no watch) only cost a few ms
+    pollfd request{.fd = watcher, .events = POLLIN, .revents = 0};
+    (void)poll(
+        &request, 1U,
+        static_cast<i32>(std::min<i64>(remaining / timing::NS_PER_MS + 1, 10))
+    );
+    while (watcher != -1 && read(watcher, buffer.data(), buffer.size()) > 0) {
+    }
+  }
+
+  if (watcher != -1) {
+    ::close(watcher);
+  }
+  if (code != error::OK) {
+    this->node[0] = '\0';
+  }
+  return code;
+}
+
+bool UinputSink::find_node() noexcept {
+  std::array<c8, 64> sysname{};
+  if (ioctl(this->fd, UI_GET_SYSNAME(sysname.size()), sysname.data()) == -1) {
+    return false;
+  }
+
+  std::array<c8, 128> path{};
+  snprintf(
+      path.data(), path.size(), "/sys/devices/virtual/input/%s",
+      sysname.data()
+  );
+  DIR* directory = opendir(path.data());
+  if (directory == nullptr) {
+    return false;
+  }
+
+  bool found = false;
+  while (const dirent* entry = readdir(directory)) {
+    if (std::strncmp(entry->d_name, "event", 5U) != 0) {
+      continue;
+    }
+    // Names too long for the node are skipped instead of cut
+    i32 length = snprintf(
+        this->node.data(), this->node.size(), "/dev/input/%s", entry->d_name
+    );
+    if (length > 0 && static_cast<usize>(length) < this->node.size()) {
+      found = true;
+      break;
+    }
+  }
+  closedir(directory);
+  return found;
+}
+
+isize UinputSink::write(const input_event* events, usize count) noexcept {
+  ++this->writes;
+  return ::write(this->fd, events, count * sizeof(input_event));
+}
+
+i32 UinputSink::get_fd() const noexcept {
+  return this->fd;
+}
+
+u64 UinputSink::get_writes() const noexcept {
+  return this->writes;
+}
+
+const c8* UinputSink::get_node() const noexcept {
+  return this->node.data();
+}
+
+void UinputSink::close() noexcept {
+  if (this->fd == -1) {
+    return;
+  }
+
+  ioctl(this->fd, UI_DEV_DESTROY);
+  ::close(this->fd);
+  this->fd = -1;
+  this->node[0] = '\0';
+}
+
+// === RingSink === //
+
+void RingSink::set_capacity(usize capacity) noexcept {
+  this->requested = capacity;
+}
+
+error_code RingSink::open() noexcept {
+  usize capacity = 1U;
+  while (capacity < this->requested) {
+    capacity <<= 1U;
+  }
+
+  this->events.resize(capacity);
+  this->mask = capacity - 1U;
+  this->clear();
+  return error::OK;
+}
+
+isize RingSink::write(const input_event* events, usize count) noexcept {
+  ++this->writes;
+  for (usize i = 0U; i < count; ++i) {
+    if (this->head - this->tail == this->events.size()) {
+      ++this->tail;
+      ++this->overwritten;
+    }
+    this->events[this->head++ & this->mask] = events[i];
+  }
+  return static_cast<isize>(count * sizeof(input_event));
+}
+
+bool RingSink::pop(input_event& event) noexcept {
+  if (this->head == this->tail) {
+    return false;
+  }
+
+  event = this->events[this->tail++ & this->mask];
+  return true;
+}
+
+void RingSink::clear() noexcept {
+  this->head = 0U;
+  this->tail = 0U;
+  this->overwritten = 0U;
+}
+
+usize RingSink::size() const noexcept {
+  return this->head - this->tail;
+}
+
+usize RingSink::capacity() const noexcept {
+  return this->events.size();
+}
+
+usize RingSink::get_overwritten() const noexcept {
+  return this->overwritten;
+}
+
+u64 RingSink::get_writes() const noexcept {
+  return this->writes;
+}
+
+// === FileSink === //
+
+FileSink::FileSink(FileSink&& other) noexcept
+    : path(other.path),
+      fd(other.fd),
+      owned(other.owned),
+      writes(other.writes) {
+  other.fd = -1;
+  other.owned = false;
+}
+
+FileSink& FileSink::operator=(FileSink&& rhs) noexcept {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  this->close();
+
+  this->path = rhs.path;
+  this->fd = rhs.fd;
+  this->owned = rhs.owned;
+  this->writes = rhs.writes;
+  rhs.fd = -1;
+  rhs.owned = false;
+
+  return *this;
+}
+
+FileSink::~FileSink() noexcept {
+  this->close();
+}
+
+void FileSink::set_path(const c8* path) noexcept {
+  this->path = path;
+}
+
+void FileSink::set_fd(i32 fd) noexcept {
+  this->fd = fd;
+  this->owned = false;
+}
+
+error_code FileSink::open() noexcept {
+  if (this->path == nullptr) {
+    return this->fd == -1 ? error::CONTROLLER_OPEN : error::OK;
+  }
+
+  this->fd = ::open(this->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (this->fd == -1) {
+    return error::CONTROLLER_OPEN;
+  }
+  this->owned = true;
+  return error::OK;
+}
+
+isize FileSink::write(const input_event* events, usize count) noexcept {
+  ++this->writes;
+  return ::write(this->fd, events, count * sizeof(input_event));
+}
+
+i32 FileSink::get_fd() const noexcept {
+  return this->fd;
+}
+
+void FileSink::close() noexcept {
+  if (this->owned && this->fd != -1) {
+    ::close(this->fd);
+  }
+  this->fd = -1;
+  this->owned = false;
+}
+
+u64 FileSink::get_writes() const noexcept {
+  return this->writes;
+}
+
+} // namespace vc::uinput
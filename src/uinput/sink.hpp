@@ -0,0 +1,231 @@
+#ifndef VC_UINPUT_SINK_HPP
+#define VC_UINPUT_SINK_HPP
+
+#include "../types.hpp"
+#include <linux/input.h>
+#include <array>
+#include <linux/uinput.h>
+#include <vector>
+
+/**
+ * Sinks are where the controllers write their events to. They are passed as a
+ * template parameter so the emit path has no virtual calls. A sink needs:
+ *   error_code open()                       - acquire the underlying resource
+ *   error_code enable(u32 request, i32 bit) - UI_SET_*BIT equivalent
+ *   error_code setup_abs(const uinput_abs_setup&) - range of an ABS code
+ *   error_code create(const uinput_setup&)  - create the device
+ *   error_code wait_ready(i32 timeout_ms)   - until readers can open it
+ *   isize write(const input_event*, usize)  - write events, returns bytes
+ *   i32 get_fd() const                      - -1 if there is no fd
+ *   u64 get_writes() const                  - number of write calls so far
+ *
+ * Sinks that don't represent a real device accept every setup call.
+ */
+
+namespace vc::uinput {
+
+// Writes the events into a device created through /dev/uinput
+class UinputSink {
+public:
+  UinputSink() noexcept = default;
+  UinputSink(const UinputSink&) = delete;
+  UinputSink& operator=(const UinputSink&) = delete;
+
+  UinputSink(UinputSink&& other) noexcept;
+  UinputSink& operator=(UinputSink&& rhs) noexcept;
+
+  ~UinputSink() noexcept;
+
+  [[nodiscard]] error_code open() noexcept;
+  [[nodiscard]] error_code enable(u32 request, i32 bit) noexcept;
+  [[nodiscard]] error_code setup_abs(const uinput_abs_setup& setup) noexcept;
+  [[nodiscard]] error_code create(const uinput_setup& setup) noexcept;
+
+  /**
+   * Blocks until the event node of the created device can be opened, udev
+   * may still be setting up its permissions right after create.
+   * The node is found through UI_GET_SYSNAME and watched with inotify, so
+   * this returns as soon as it is usable instead of sleeping a fixed time
+   */
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept;
+
+  isize write(const input_event* events, usize count) noexcept;
+
+  [[nodiscard]] i32 get_fd() const noexcept;
+  [[nodiscard]] u64 get_writes() const noexcept;
+  // /dev/input/eventN of the device, empty until wait_ready succeeds
+  [[nodiscard]] const c8* get_node() const noexcept;
+
+private:
+  i32 fd = -1;
+  u64 writes = 0U;
+  std::array<c8, 32> node{};
+
+  // Looks up the eventN of the device in sysfs
+  [[nodiscard]] bool find_node() noexcept;
+  // Destroys the device and closes the fd
+  void close() noexcept;
+};
+
+// Discards every event, used for measuring the cost of the emit path
+class NullSink {
+public:
+  [[nodiscard]] error_code open() noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code enable(u32 request, i32 bit) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code setup_abs(const uinput_abs_setup& setup
+  ) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code create(const uinput_setup& setup) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept {
+    return error::OK;
+  }
+
+  isize write(const input_event* events, usize count) noexcept {
+    ++this->writes;
+    return static_cast<isize>(count * sizeof(input_event));
+  }
+
+  [[nodiscard]] i32 get_fd() const noexcept {
+    return -1;
+  }
+
+  [[nodiscard]] u64 get_writes() const noexcept {
+    return this->writes;
+  }
+
+private:
+  u64 writes = 0U;
+};
+
+/**
+ * Keeps the latest events in memory so the event stream can be checked.
+ * Once full, the oldest events are overwritten.
+ */
+class RingSink {
+public:
+  RingSink() noexcept = default;
+  RingSink(const RingSink&) = delete;
+  RingSink& operator=(const RingSink&) = delete;
+
+  RingSink(RingSink&& other) noexcept = default;
+  RingSink& operator=(RingSink&& rhs) noexcept = default;
+
+  ~RingSink() noexcept = default;
+
+  // Needs to be called before open, rounded up to a power of 2
+  void set_capacity(usize capacity) noexcept;
+
+  [[nodiscard]] error_code open() noexcept;
+
+  [[nodiscard]] error_code enable(u32 request, i32 bit) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code setup_abs(const uinput_abs_setup& setup
+  ) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code create(const uinput_setup& setup) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept {
+    return error::OK;
+  }
+
+  isize write(const input_event* events, usize count) noexcept;
+
+  [[nodiscard]] i32 get_fd() const noexcept {
+    return -1;
+  }
+
+  [[nodiscard]] u64 get_writes() const noexcept;
+
+  // Returns false if there are no events left
+  [[nodiscard]] bool pop(input_event& event) noexcept;
+  void clear() noexcept;
+
+  [[nodiscard]] usize size() const noexcept;
+  [[nodiscard]] usize capacity() const noexcept;
+  // Number of events lost because the ring was full
+  [[nodiscard]] usize get_overwritten() const noexcept;
+
+private:
+  std::vector<input_event> events{};
+  usize mask = 0;
+  usize head = 0;
+  usize tail = 0;
+  usize overwritten = 0;
+  usize requested = 4096;
+  u64 writes = 0U;
+};
+
+/**
+ * Writes the raw input_event structs into a file or a pipe.
+ * Either set the path (opened by the sink) or an fd (owned by the caller).
+ */
+class FileSink {
+public:
+  FileSink() noexcept = default;
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+
+  FileSink(FileSink&& other) noexcept;
+  FileSink& operator=(FileSink&& rhs) noexcept;
+
+  ~FileSink() noexcept;
+
+  // Needs to be called before open, path needs to outlive the open call
+  void set_path(const c8* path) noexcept;
+  // Needs to be called before open, the fd will not be closed by the sink
+  void set_fd(i32 fd) noexcept;
+
+  [[nodiscard]] error_code open() noexcept;
+
+  [[nodiscard]] error_code enable(u32 request, i32 bit) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code setup_abs(const uinput_abs_setup& setup
+  ) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code create(const uinput_setup& setup) noexcept {
+    return error::OK;
+  }
+
+  [[nodiscard]] error_code wait_ready(i32 timeout_ms) noexcept {
+    return error::OK;
+  }
+
+  isize write(const input_event* events, usize count) noexcept;
+
+  [[nodiscard]] i32 get_fd() const noexcept;
+  [[nodiscard]] u64 get_writes() const noexcept;
+
+private:
+  const c8* path = nullptr;
+  i32 fd = -1;
+  bool owned = false;
+  u64 writes = 0U;
+
+  // Closes the fd if the sink opened it
+  void close() noexcept;
+};
+
+} // namespace vc::uinput
+
+#endif
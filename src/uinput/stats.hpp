@@ -0,0 +1,233 @@
+#ifndef VC_UINPUT_STATS_HPP
+#define VC_UINPUT_STATS_HPP
+
+#include "../timing/clock.hpp"
+#include "../timing/histogram.hpp"
+#include "../types.hpp"
+#include "./backpressure.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <linux/input.h>
+
+namespace vc::uinput {
+
+struct StatsSnapshot {
+  // Events the sink accepted
+  u64 events = 0U;
+  // sync calls
+  u64 frames = 0U;
+  // write calls, more than frames in immediate mode or on overflows
+  u64 writes = 0U;
+  u64 bytes = 0U;
+  // The sink took only part of the events
+  u64 short_writes = 0U;
+  // EAGAIN, the kernel queue of the device was full
+  u64 would_block = 0U;
+  // Any other failed write
+  u64 errors = 0U;
+
+  // Bit per Backpressure mode used by the devices of the snapshot
+  u8 policies = 0U;
+  // Times a flush waited for the fd to have space
+  u64 polls = 0U;
+  // Frames still not fully written at the deadline, see Backpressure
+  u64 stalls = 0U;
+  u64 dropped = 0U;
+  u64 coalesced = 0U;
+
+  // Duration of the write calls in ns
+  timing::Histogram write_latency{};
+
+  void merge(const StatsSnapshot& other) noexcept {
+    this->events += other.events;
+    this->frames += other.frames;
+    this->writes += other.writes;
+    this->bytes += other.bytes;
+    this->short_writes += other.short_writes;
+    this->would_block += other.would_block;
+    this->errors += other.errors;
+    this->policies |= other.policies;
+    this->polls += other.polls;
+    this->stalls += other.stalls;
+    this->dropped += other.dropped;
+    this->coalesced += other.coalesced;
+    this->write_latency.merge(other.write_latency);
+  }
+
+  void print(FILE* file, const c8* name) const noexcept {
+    fprintf(
+        file,
+        "%s: events %lu ; frames %lu ; writes %lu ; bytes %lu ; short %lu ; "
+        "eagain %lu ; errors %lu ; write p50 %luns p99 %luns max %luns\n",
+        name, this->events, this->frames, this->writes, this->bytes,
+        this->short_writes, this->would_block, this->errors,
+        this->write_latency.percentile(50.0),
+        this->write_latency.percentile(99.0), this->write_latency.get_max()
+    );
+
+    fprintf(file, "%s: policy", name);
+    for (auto mode :
+         {Backpressure::DROP, Backpressure::COALESCE, Backpressure::BLOCK}) {
+      if (this->policies & (1U << static_cast<u8>(mode))) {
+        fprintf(file, " %s", to_string(mode));
+      }
+    }
+    fprintf(
+        file, " ; polls %lu ; stalls %lu ; dropped %lu ; coalesced %lu\n",
+        this->polls, this->stalls, this->dropped, this->coalesced
+    );
+  }
+};
+
+/**
+ * Counters of a device, written by the thread emitting its events and read
+ * by anyone through snapshot. Single writer so the counters only need
+ * relaxed loads and stores, aligned so devices stored next to each other in
+ * a pool don't share cache lines
+ */
+class alignas(64) DeviceStats {
+public:
+  DeviceStats() noexcept = default;
+  explicit DeviceStats(Backpressure policy) noexcept : policy(policy) {}
+  DeviceStats(const DeviceStats& other) noexcept {
+    *this = other;
+  }
+
+  DeviceStats& operator=(const DeviceStats& other) noexcept {
+    for (usize i = 0U; i < COUNTERS; ++i) {
+      store(this->counters[i], load(other.counters[i]));
+    }
+    this->set_policy(other.get_policy());
+    this->write_latency = other.write_latency;
+    return *this;
+  }
+
+  ~DeviceStats() noexcept = default;
+
+  void record_frame() noexcept {
+    this->add(FRAMES, 1U);
+  }
+
+  void record_poll() noexcept {
+    this->add(POLLS, 1U);
+  }
+
+  void record_stall() noexcept {
+    this->add(STALLS, 1U);
+  }
+
+  void record_drop() noexcept {
+    this->add(DROPPED, 1U);
+  }
+
+  void record_coalesce() noexcept {
+    this->add(COALESCED, 1U);
+  }
+
+  // Reported in the snapshots, the device applies the policy itself
+  void set_policy(Backpressure policy) noexcept {
+    this->policy.store(policy, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] Backpressure get_policy() const noexcept {
+    return this->policy.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @param count - number of events passed to the write
+   * @param written - return value of the write, errno is read if -1
+   * @param latency - duration of the write in ns
+   */
+  void record_write(usize count, isize written, i64 latency) noexcept {
+    this->add(WRITES, 1U);
+    this->write_latency.record(latency);
+
+    if (written < 0) {
+      this->add(errno == EAGAIN ? WOULD_BLOCK : ERRORS, 1U);
+      return;
+    }
+
+    this->add(BYTES, written);
+    this->add(EVENTS, written / sizeof(input_event));
+    if (static_cast<usize>(written) < count * sizeof(input_event)) {
+      this->add(SHORT_WRITES, 1U);
+    }
+  }
+
+  void reset() noexcept {
+    for (auto& counter : this->counters) {
+      store(counter, 0U);
+    }
+    this->write_latency.reset();
+  }
+
+  [[nodiscard]] StatsSnapshot snapshot() const noexcept {
+    return StatsSnapshot{
+        .events = load(this->counters[EVENTS]),
+        .frames = load(this->counters[FRAMES]),
+        .writes = load(this->counters[WRITES]),
+        .bytes = load(this->counters[BYTES]),
+        .short_writes = load(this->counters[SHORT_WRITES]),
+        .would_block = load(this->counters[WOULD_BLOCK]),
+        .errors = load(this->counters[ERRORS]),
+        .policies = static_cast<u8>(1U << static_cast<u8>(this->get_policy())),
+        .polls = load(this->counters[POLLS]),
+        .stalls = load(this->counters[STALLS]),
+        .dropped = load(this->counters[DROPPED]),
+        .coalesced = load(this->counters[COALESCED]),
+        .write_latency = this->write_latency.snapshot(),
+    };
+  }
+
+private:
+  enum Counter : u8 {
+    EVENTS,
+    FRAMES,
+    WRITES,
+    BYTES,
+    SHORT_WRITES,
+    WOULD_BLOCK,
+    ERRORS,
+    POLLS,
+    STALLS,
+    DROPPED,
+    COALESCED,
+    COUNTERS,
+  };
+
+  std::array<std::atomic<u64>, COUNTERS> counters{};
+  std::atomic<Backpressure> policy{Backpressure::COALESCE};
+  timing::AtomicHistogram write_latency{};
+
+  [[nodiscard]] static u64 load(const std::atomic<u64>& value) noexcept {
+    return value.load(std::memory_order_relaxed);
+  }
+
+  static void store(std::atomic<u64>& value, u64 next) noexcept {
+    value.store(next, std::memory_order_relaxed);
+  }
+
+  void add(Counter counter, u64 value) noexcept {
+    store(this->counters[counter], load(this->counters[counter]) + value);
+  }
+};
+
+// Writes the events in one call to the sink and records it into the stats
+template <typename Sink>
+isize write_events(
+    Sink& sink, const input_event* events, usize count, DeviceStats& stats
+) noexcept {
+  if (count == 0U) {
+    return 0;
+  }
+
+  i64 start = timing::now_ns();
+  isize written = sink.write(events, count);
+  stats.record_write(count, written, timing::now_ns() - start);
+  return written;
+}
+
+} // namespace vc::uinput
+
+#endif